@@ -0,0 +1,14 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the base board's MMA7455 accelerometer
+ *                driver. Returns the acceleration set on the board model.
+ *
+ ******************************************************************************/
+
+#ifndef __ACC_H
+#define __ACC_H
+
+void acc_init(void);
+void acc_read(int8_t *x, int8_t *y, int8_t *z);
+
+#endif /* end __ACC_H */
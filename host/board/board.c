@@ -0,0 +1,652 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Board model of the host build, see board.h.
+ *
+ ******************************************************************************/
+
+#include "mcu_regs.h"
+#include "type.h"
+#include "gpio.h"
+#include "i2c.h"
+#include "ssp.h"
+#include "timer32.h"
+
+#include "acc.h"
+#include "eeprom.h"
+#include "joystick.h"
+#include "led7seg.h"
+#include "light.h"
+#include "oled.h"
+#include "pca9532.h"
+#include "rgb.h"
+
+#include "fastgpio.h"
+#include "board.h"
+
+#include <string.h>
+
+/* Base board wiring */
+#define OLED_CS_PORT        0
+#define OLED_CS_PIN         2
+#define OLED_DC_PORT        2
+#define OLED_DC_PIN         7
+#define SEG7_CS_PORT        1
+#define SEG7_CS_PIN         11
+#define LIGHT_INT_PORT      2
+#define LIGHT_INT_PIN       5
+
+/* SSD1305: 132 columns of RAM, the panel shows 96 of them from column 18 */
+#define OLED_RAM_COLUMNS    132
+#define OLED_X_OFFSET       18
+#define OLED_PAGES          (OLED_DISPLAY_HEIGHT >> 3)
+
+#define PIN(port, bit)      FASTGPIO_READ(port, bit)
+
+LPC_SYSCON_TypeDef hostSyscon;
+LPC_IOCON_TypeDef hostIocon;
+
+/* GPIO port blocks, one word per masked DATA address (see fastgpio.h) */
+volatile uint32_t hostGpio[4][0x1000];
+
+/* OLED controller */
+static uint8_t oledRam[OLED_PAGES][OLED_RAM_COLUMNS];
+static uint8_t oledPage;
+static uint8_t oledColumn;
+static uint8_t oledOn;
+
+static uint8_t seg7Latch = 0xFF;
+static uint16_t leds;
+
+/* EEPROM cells, stored inverted so the zeroed image reads as erased (0xFF) */
+static uint8_t eepromCells[EEPROM_TOTAL_SIZE];
+
+static int8_t accX, accY, accZ = 64;
+
+/* Light level and interrupt window of the ISL29003 */
+static uint32_t lux = 200;
+static uint32_t loThreshold;
+static uint32_t hiThreshold = 0xFFFF;
+
+/*****************************************************************************
+** Function name:       updateLightInt
+**
+** Description:         Asserts the light sensor's interrupt line (active
+**                      low) while the level is outside the window.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void updateLightInt(void)
+{
+    uint8_t outside = (lux < loThreshold) || (lux > hiThreshold);
+
+    fastgpio_write(LIGHT_INT_PORT, LIGHT_INT_PIN, !outside);
+}
+
+/*****************************************************************************
+** Function name:       oledCommand
+**
+** Description:         Decodes the SSD1305 commands the game sends.
+**
+** Parameters:          command - command byte
+** Returned value:      None
+*****************************************************************************/
+static void oledCommand(uint8_t command)
+{
+    if ((command & 0xF8) == 0xB0) {
+        oledPage = command & 0x07;
+    } else if ((command & 0xF0) == 0x00) {
+        oledColumn = (oledColumn & 0xF0) | (command & 0x0F);
+    } else if ((command & 0xF0) == 0x10) {
+        oledColumn = (uint8_t)((oledColumn & 0x0F) | ((command & 0x0F) << 4));
+    } else if (command == 0xAE) {
+        oledOn = 0;
+    } else if (command == 0xAF) {
+        oledOn = 1;
+    }
+}
+
+/*****************************************************************************
+** Function name:       board_reset
+**
+** Description:         Power-on state: erased EEPROM, blank panel switched
+**                      on, board lying flat in 200 lux.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void board_reset(void)
+{
+    memset((void *)hostGpio, 0, sizeof(hostGpio));
+    memset(oledRam, 0, sizeof(oledRam));
+    memset(eepromCells, 0, sizeof(eepromCells));
+    oledPage = 0;
+    oledColumn = 0;
+    oledOn = 1;
+    seg7Latch = 0xFF;
+    leds = 0;
+    accX = 0;
+    accY = 0;
+    accZ = 64;
+    lux = 200;
+    loThreshold = 0;
+    hiThreshold = 0xFFFF;
+    updateLightInt();
+    fastgpio_write(OLED_CS_PORT, OLED_CS_PIN, 1);
+    fastgpio_write(SEG7_CS_PORT, SEG7_CS_PIN, 1);
+}
+
+/*****************************************************************************
+** Function name:       board_setLux
+**
+** Description:         Changes the light level seen by the sensor.
+**
+** Parameters:          value - light level in lux
+** Returned value:      None
+*****************************************************************************/
+void board_setLux(uint32_t value)
+{
+    lux = value;
+    updateLightInt();
+}
+
+/*****************************************************************************
+** Function name:       board_setAcc
+**
+** Description:         Changes the acceleration seen by the accelerometer.
+**
+** Parameters:          x, y, z - acceleration, 64 per g
+** Returned value:      None
+*****************************************************************************/
+void board_setAcc(int8_t x, int8_t y, int8_t z)
+{
+    accX = x;
+    accY = y;
+    accZ = z;
+}
+
+/*****************************************************************************
+** Function name:       board_panelIsOn
+**
+** Description:         Whether the OLED is switched on.
+**
+** Parameters:          None
+** Returned value:      1 if on, 0 if in sleep mode
+*****************************************************************************/
+uint8_t board_panelIsOn(void)
+{
+    return oledOn;
+}
+
+/*****************************************************************************
+** Function name:       board_panelPixel
+**
+** Description:         A pixel of the controller RAM in the visible area,
+**                      i.e. what the panel shows while it is on.
+**
+** Parameters:          x, y - pixel coordinates
+** Returned value:      1 if the pixel is lit
+*****************************************************************************/
+uint8_t board_panelPixel(uint8_t x, uint8_t y)
+{
+    return (oledRam[y >> 3][x + OLED_X_OFFSET] >> (y & 0x07)) & 1;
+}
+
+/*****************************************************************************
+** Function name:       board_getSeg7
+**
+** Description:         Pattern in the 7-segment latch.
+**
+** Parameters:          None
+** Returned value:      Segment pattern, active low
+*****************************************************************************/
+uint8_t board_getSeg7(void)
+{
+    return seg7Latch;
+}
+
+/*****************************************************************************
+** Function name:       board_getLeds
+**
+** Description:         LEDs of the LED bar that are on.
+**
+** Parameters:          None
+** Returned value:      Bit mask, bit 0 is the rightmost LED
+*****************************************************************************/
+uint16_t board_getLeds(void)
+{
+    return leds;
+}
+
+/* ---- MCU library ---- */
+
+/*****************************************************************************
+** Function name:       GPIOInit
+**
+** Description:         Nothing to set up: pins are words of hostGpio.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void GPIOInit(void)
+{
+}
+
+/*****************************************************************************
+** Function name:       GPIOSetDir
+**
+** Description:         Pin directions are not modelled.
+**
+** Parameters:          portNum - port
+**                      bitPosi - pin
+**                      dir     - 1 for output
+** Returned value:      None
+*****************************************************************************/
+void GPIOSetDir(uint32_t portNum, uint32_t bitPosi, uint32_t dir)
+{
+    (void)portNum;
+    (void)bitPosi;
+    (void)dir;
+}
+
+/*****************************************************************************
+** Function name:       GPIOSetValue
+**
+** Description:         Drives a pin through its masked DATA address, as the
+**                      FASTGPIO macros do.
+**
+** Parameters:          portNum - port
+**                      bitPosi - pin
+**                      bitVal  - level
+** Returned value:      None
+*****************************************************************************/
+void GPIOSetValue(uint32_t portNum, uint32_t bitPosi, uint32_t bitVal)
+{
+    fastgpio_write(portNum, bitPosi, bitVal);
+}
+
+/*****************************************************************************
+** Function name:       GPIOSetInterrupt
+**
+** Description:         Pin interrupts are not modelled; the game polls.
+**
+** Parameters:          portNum, bitPosi - pin
+**                      sense, single, event - trigger settings
+** Returned value:      None
+*****************************************************************************/
+void GPIOSetInterrupt(uint32_t portNum, uint32_t bitPosi, uint32_t sense, uint32_t single,
+                      uint32_t event)
+{
+    (void)portNum;
+    (void)bitPosi;
+    (void)sense;
+    (void)single;
+    (void)event;
+}
+
+/*****************************************************************************
+** Function name:       GPIOIntEnable
+**
+** Description:         Pin interrupts are not modelled; the game polls.
+**
+** Parameters:          portNum, bitPosi - pin
+** Returned value:      None
+*****************************************************************************/
+void GPIOIntEnable(uint32_t portNum, uint32_t bitPosi)
+{
+    (void)portNum;
+    (void)bitPosi;
+}
+
+/*****************************************************************************
+** Function name:       init_timer32
+**
+** Description:         Timers are replaced by the virtual clock.
+**
+** Parameters:          timer_num     - timer
+**                      timerInterval - ticks per interval
+** Returned value:      None
+*****************************************************************************/
+void init_timer32(uint8_t timer_num, uint32_t timerInterval)
+{
+    (void)timer_num;
+    (void)timerInterval;
+}
+
+/*****************************************************************************
+** Function name:       I2CInit
+**
+** Description:         The I2C devices are answered directly by the sensor
+**                      stand-ins below.
+**
+** Parameters:          I2cMode   - I2CMASTER or I2CSLAVE
+**                      slaveAddr - own address in slave mode
+** Returned value:      TRUE
+*****************************************************************************/
+uint32_t I2CInit(uint32_t I2cMode, uint32_t slaveAddr)
+{
+    (void)I2cMode;
+    (void)slaveAddr;
+    return TRUE;
+}
+
+/*****************************************************************************
+** Function name:       SSPInit
+**
+** Description:         Nothing to set up: see SSPSend().
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void SSPInit(void)
+{
+}
+
+/*****************************************************************************
+** Function name:       SSPSend
+**
+** Description:         Delivers bytes to the device whose chip select is
+**                      low: OLED commands or RAM data by its DC line, or
+**                      the 7-segment latch, which keeps the last byte.
+**
+** Parameters:          buf    - bytes sent
+**                      Length - number of bytes
+** Returned value:      None
+*****************************************************************************/
+void SSPSend(uint8_t *buf, uint32_t Length)
+{
+    for (uint32_t i = 0; i < Length; i++) {
+        if (!PIN(OLED_CS_PORT, OLED_CS_PIN)) {
+            if (!PIN(OLED_DC_PORT, OLED_DC_PIN)) {
+                oledCommand(buf[i]);
+            } else if (oledColumn < OLED_RAM_COLUMNS) {
+                oledRam[oledPage][oledColumn++] = buf[i];
+            }
+        }
+        if (!PIN(SEG7_CS_PORT, SEG7_CS_PIN)) {
+            seg7Latch = buf[i];
+        }
+    }
+}
+
+/* ---- Base board library ---- */
+
+/*****************************************************************************
+** Function name:       eeprom_init
+**
+** Description:         Nothing to set up: the cells are RAM.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void eeprom_init(void)
+{
+}
+
+/*****************************************************************************
+** Function name:       eeprom_read
+**
+** Description:         Reads EEPROM cells.
+**
+** Parameters:          buf    - bytes read
+**                      offset - first cell
+**                      len    - number of bytes
+** Returned value:      Number of bytes read
+*****************************************************************************/
+int16_t eeprom_read(uint8_t *buf, uint16_t offset, uint16_t len)
+{
+    for (uint16_t i = 0; (i < len) && (offset + i < EEPROM_TOTAL_SIZE); i++) {
+        buf[i] = (uint8_t)~eepromCells[offset + i];
+    }
+    return (int16_t)len;
+}
+
+/*****************************************************************************
+** Function name:       eeprom_write
+**
+** Description:         Writes EEPROM cells.
+**
+** Parameters:          buf    - bytes to write
+**                      offset - first cell
+**                      len    - number of bytes
+** Returned value:      Number of bytes written
+*****************************************************************************/
+int16_t eeprom_write(uint8_t *buf, uint16_t offset, uint16_t len)
+{
+    for (uint16_t i = 0; (i < len) && (offset + i < EEPROM_TOTAL_SIZE); i++) {
+        eepromCells[offset + i] = (uint8_t)~buf[i];
+    }
+    return (int16_t)len;
+}
+
+/*****************************************************************************
+** Function name:       joystick_init
+**
+** Description:         Nothing to set up.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void joystick_init(void)
+{
+}
+
+/*****************************************************************************
+** Function name:       joystick_read
+**
+** Description:         The host game reads scripted input instead (input.c).
+**
+** Parameters:          None
+** Returned value:      0, nothing held
+*****************************************************************************/
+uint8_t joystick_read(void)
+{
+    return 0;
+}
+
+/*****************************************************************************
+** Function name:       pca9532_init
+**
+** Description:         Nothing to set up.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void pca9532_init(void)
+{
+}
+
+/*****************************************************************************
+** Function name:       pca9532_setLeds
+**
+** Description:         Switches LEDs of the LED bar on and off.
+**
+** Parameters:          ledOnMask  - LEDs to switch on
+**                      ledOffMask - LEDs to switch off
+** Returned value:      None
+*****************************************************************************/
+void pca9532_setLeds(uint16_t ledOnMask, uint16_t ledOffMask)
+{
+    leds = (uint16_t)((leds & ~ledOffMask) | ledOnMask);
+}
+
+/*****************************************************************************
+** Function name:       acc_init
+**
+** Description:         Nothing to set up.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void acc_init(void)
+{
+}
+
+/*****************************************************************************
+** Function name:       acc_read
+**
+** Description:         Acceleration set by board_setAcc().
+**
+** Parameters:          x, y, z - acceleration, 64 per g
+** Returned value:      None
+*****************************************************************************/
+void acc_read(int8_t *x, int8_t *y, int8_t *z)
+{
+    *x = accX;
+    *y = accY;
+    *z = accZ;
+}
+
+/*****************************************************************************
+** Function name:       light_init
+**
+** Description:         Sets the interrupt line from the current window.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void light_init(void)
+{
+    updateLightInt();
+}
+
+/*****************************************************************************
+** Function name:       light_enable
+**
+** Description:         Nothing to set up.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void light_enable(void)
+{
+}
+
+/*****************************************************************************
+** Function name:       light_read
+**
+** Description:         Light level set by board_setLux().
+**
+** Parameters:          None
+** Returned value:      Light level in lux
+*****************************************************************************/
+uint32_t light_read(void)
+{
+    return lux;
+}
+
+/*****************************************************************************
+** Function name:       light_setWidth
+**
+** Description:         Conversion width is not modelled.
+**
+** Parameters:          width - conversion width
+** Returned value:      None
+*****************************************************************************/
+void light_setWidth(light_width_t width)
+{
+    (void)width;
+}
+
+/*****************************************************************************
+** Function name:       light_setRange
+**
+** Description:         Range is not modelled.
+**
+** Parameters:          newRange - lux range
+** Returned value:      None
+*****************************************************************************/
+void light_setRange(light_range_t newRange)
+{
+    (void)newRange;
+}
+
+/*****************************************************************************
+** Function name:       light_setHiThreshold
+**
+** Description:         Sets the top of the interrupt window.
+**
+** Parameters:          luxValue - threshold in lux
+** Returned value:      None
+*****************************************************************************/
+void light_setHiThreshold(uint32_t luxValue)
+{
+    hiThreshold = luxValue;
+}
+
+/*****************************************************************************
+** Function name:       light_setLoThreshold
+**
+** Description:         Sets the bottom of the interrupt window.
+**
+** Parameters:          luxValue - threshold in lux
+** Returned value:      None
+*****************************************************************************/
+void light_setLoThreshold(uint32_t luxValue)
+{
+    loThreshold = luxValue;
+}
+
+/*****************************************************************************
+** Function name:       light_setIrqInCycles
+**
+** Description:         Interrupt persistence is not modelled.
+**
+** Parameters:          cycles - integration cycles
+** Returned value:      None
+*****************************************************************************/
+void light_setIrqInCycles(light_cycle_t cycles)
+{
+    (void)cycles;
+}
+
+/*****************************************************************************
+** Function name:       light_clearIrqStatus
+**
+** Description:         Releases the interrupt line unless the level is
+**                      still outside the window.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void light_clearIrqStatus(void)
+{
+    updateLightInt();
+}
+
+/*****************************************************************************
+** Function name:       oled_init
+**
+** Description:         Switches the panel on, as the library init does.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void oled_init(void)
+{
+    oledOn = 1;
+}
+
+/*****************************************************************************
+** Function name:       rgb_init
+**
+** Description:         Nothing to set up.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void rgb_init(void)
+{
+}
+
+/*****************************************************************************
+** Function name:       led7seg_init
+**
+** Description:         Nothing to set up.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void led7seg_init(void)
+{
+}
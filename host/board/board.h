@@ -0,0 +1,24 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Board model of the host build. Stands in for the MCU and
+ *                base board libraries: GPIO pins are plain words, the
+ *                EEPROM is RAM, the sensors return what a test sets, and
+ *                the OLED controller and 7-segment latch are decoded from
+ *                the bytes sent through SSPSend(). Tests use the functions
+ *                below to set up the board and to read what the panel
+ *                actually shows.
+ *
+ ******************************************************************************/
+
+#ifndef __BOARD_H
+#define __BOARD_H
+
+void board_reset(void);
+void board_setLux(uint32_t lux);
+void board_setAcc(int8_t x, int8_t y, int8_t z);
+uint8_t board_panelIsOn(void);
+uint8_t board_panelPixel(uint8_t x, uint8_t y);
+uint8_t board_getSeg7(void);
+uint16_t board_getLeds(void);
+
+#endif /* end __BOARD_H */
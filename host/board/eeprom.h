@@ -0,0 +1,17 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the base board's 24LC08B EEPROM driver,
+ *                backed by RAM of the board model.
+ *
+ ******************************************************************************/
+
+#ifndef __EEPROM_H
+#define __EEPROM_H
+
+#define EEPROM_TOTAL_SIZE   1024
+
+void eeprom_init(void);
+int16_t eeprom_read(uint8_t *buf, uint16_t offset, uint16_t len);
+int16_t eeprom_write(uint8_t *buf, uint16_t offset, uint16_t len);
+
+#endif /* end __EEPROM_H */
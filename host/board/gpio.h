@@ -0,0 +1,23 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the MCU library's GPIO driver. Pins are
+ *                words of the board model, see fastgpio.h.
+ *
+ ******************************************************************************/
+
+#ifndef __GPIO_H
+#define __GPIO_H
+
+#define PORT0       0
+#define PORT1       1
+#define PORT2       2
+#define PORT3       3
+
+void GPIOInit(void);
+void GPIOSetDir(uint32_t portNum, uint32_t bitPosi, uint32_t dir);
+void GPIOSetValue(uint32_t portNum, uint32_t bitPosi, uint32_t bitVal);
+void GPIOSetInterrupt(uint32_t portNum, uint32_t bitPosi, uint32_t sense, uint32_t single,
+                      uint32_t event);
+void GPIOIntEnable(uint32_t portNum, uint32_t bitPosi);
+
+#endif /* end __GPIO_H */
@@ -0,0 +1,16 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the MCU library's I2C driver. The I2C
+ *                devices are modelled behind their own drivers.
+ *
+ ******************************************************************************/
+
+#ifndef __I2C_H
+#define __I2C_H
+
+#define I2CMASTER   0x01
+#define I2CSLAVE    0x02
+
+uint32_t I2CInit(uint32_t I2cMode, uint32_t slaveAddr);
+
+#endif /* end __I2C_H */
@@ -0,0 +1,13 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the base board's 7-segment driver. The
+ *                latch is modelled behind SSPSend().
+ *
+ ******************************************************************************/
+
+#ifndef __LED7SEG_H
+#define __LED7SEG_H
+
+void led7seg_init(void);
+
+#endif /* end __LED7SEG_H */
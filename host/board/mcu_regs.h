@@ -0,0 +1,31 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the LPC13xx register definitions. Only
+ *                the registers the game touches outside CLOCK_VIRTUAL
+ *                sections exist; they are plain memory of the board model.
+ *
+ ******************************************************************************/
+
+#ifndef __MCU_REGS_H__
+#define __MCU_REGS_H__
+
+#include "type.h"
+
+#define SystemFrequency     72000000UL
+
+typedef struct {
+    volatile uint32_t SYSRESSTAT;
+    volatile uint32_t SYSAHBCLKCTRL;
+} LPC_SYSCON_TypeDef;
+
+typedef struct {
+    volatile uint32_t JTAG_nTRST_PIO1_2;
+} LPC_IOCON_TypeDef;
+
+extern LPC_SYSCON_TypeDef hostSyscon;
+extern LPC_IOCON_TypeDef hostIocon;
+
+#define LPC_SYSCON          (&hostSyscon)
+#define LPC_IOCON           (&hostIocon)
+
+#endif /* end __MCU_REGS_H__ */
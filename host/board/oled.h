@@ -0,0 +1,22 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the base board's OLED driver. Drawing
+ *                goes through display.h; the panel itself is modelled
+ *                behind SSPSend().
+ *
+ ******************************************************************************/
+
+#ifndef __OLED_H
+#define __OLED_H
+
+#define OLED_DISPLAY_WIDTH  96
+#define OLED_DISPLAY_HEIGHT 64
+
+typedef enum {
+    OLED_COLOR_BLACK,
+    OLED_COLOR_WHITE
+} oled_color_t;
+
+void oled_init(void);
+
+#endif /* end __OLED_H */
@@ -0,0 +1,13 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the base board's PCA9532 LED driver.
+ *
+ ******************************************************************************/
+
+#ifndef __PCA9532_H
+#define __PCA9532_H
+
+void pca9532_init(void);
+void pca9532_setLeds(uint16_t ledOnMask, uint16_t ledOffMask);
+
+#endif /* end __PCA9532_H */
@@ -0,0 +1,12 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the base board's RGB LED driver.
+ *
+ ******************************************************************************/
+
+#ifndef __RGB_H
+#define __RGB_H
+
+void rgb_init(void);
+
+#endif /* end __RGB_H */
@@ -0,0 +1,15 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the MCU library's SSP driver. SSPSend()
+ *                hands the bytes to the device models whose chip select
+ *                is low.
+ *
+ ******************************************************************************/
+
+#ifndef __SSP_H
+#define __SSP_H
+
+void SSPInit(void);
+void SSPSend(uint8_t *buf, uint32_t Length);
+
+#endif /* end __SSP_H */
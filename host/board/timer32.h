@@ -0,0 +1,14 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the MCU library's 32-bit timer driver.
+ *                The game waits through clock.h, so the delays are never
+ *                called on the host.
+ *
+ ******************************************************************************/
+
+#ifndef __TIMER32_H
+#define __TIMER32_H
+
+void init_timer32(uint8_t timer_num, uint32_t timerInterval);
+
+#endif /* end __TIMER32_H */
@@ -0,0 +1,21 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host stand-in for the MCU library's type.h.
+ *
+ ******************************************************************************/
+
+#ifndef __TYPE_H__
+#define __TYPE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef FALSE
+#define FALSE   (0)
+#endif
+
+#ifndef TRUE
+#define TRUE    (1)
+#endif
+
+#endif /* end __TYPE_H__ */
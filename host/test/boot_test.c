@@ -0,0 +1,73 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test: boots the game on the board model and answers
+ *                the welcome screen, checking that time is simulated and
+ *                that the panel shows what was drawn.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "joystick.h"
+#include "oled.h"
+
+#include "board.h"
+#include "clock.h"
+#include "input.h"
+
+#include "hosttest.h"
+
+#include <time.h>
+
+/* Simulated time at which the script presses center */
+#define PRESS_MS    30000
+
+/*****************************************************************************
+** Function name:       pressLater
+**
+** Description:         Script holding center from PRESS_MS on.
+**
+** Parameters:          nowMs - simulated time
+** Returned value:      JOYSTICK_* bits held
+*****************************************************************************/
+static uint8_t pressLater(uint32_t nowMs)
+{
+    return (nowMs >= PRESS_MS) ? JOYSTICK_CENTER : 0;
+}
+
+/*****************************************************************************
+** Function name:       ignore
+**
+** Description:         Stimulus and result events are not scripted here.
+**
+** Parameters:          value - unused
+** Returned value:      None
+*****************************************************************************/
+static void ignore(uint32_t value)
+{
+    (void)value;
+}
+
+int main(void)
+{
+    static const input_source_t script = { pressLater, ignore, ignore };
+    clock_t started;
+
+    hosttest_boot();
+    CHECK(clock_nowMs() < 1000, "boot took %lu ms", (unsigned long)clock_nowMs());
+    CHECK(board_panelIsOn(), "panel off after boot");
+
+    input_setSource(&script);
+    started = clock();
+    show_welcome_screen();
+
+    CHECK(clock_nowMs() >= PRESS_MS, "welcome screen left at %lu ms",
+          (unsigned long)clock_nowMs());
+    CHECK((clock() - started) < CLOCKS_PER_SEC,
+          "%lu ms of simulated time took a second or more",
+          (unsigned long)clock_nowMs());
+    CHECK(board_panelIsOn(), "panel off after the welcome screen");
+    CHECK(hosttest_panelLit() > 0, "welcome screen not on the panel");
+
+    return hosttest_done("boot_test");
+}
@@ -0,0 +1,320 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test of the duel: two simulated boards, a leader and
+ *                a follower process joined by a pseudo-terminal pair, run
+ *                the game's own start_duel() in real time with opposite
+ *                clock skews. Scripted players click a fixed time after
+ *                the stimulus their panel shows. The test checks every
+ *                verdict sent over the link, the reaction times, the
+ *                drift estimate and that both stimuli appear together in
+ *                host time, within the sync error bound, the drift error
+ *                over the time since the sync and the wake-up jitter.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "joystick.h"
+
+#include "clock.h"
+#include "duel.h"
+#include "input.h"
+#include "payload.h"
+#include "remote.h"
+#include "serial.h"
+
+#include "hosttest.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Crystal errors of the two boards */
+#define LEADER_SKEW_PPM         80
+#define FOLLOWER_SKEW_PPM       (-70)
+
+/* Scripted reaction times on each board's own clock */
+#define LEADER_REACTION_MS      250
+#define FOLLOWER_REACTION_MS    200
+
+/* Clicks on the end screen */
+#define CLICK_EVERY_MS          1000
+#define PRESS_MS                100
+
+/* The board polls the joystick this often while it waits for the click,
+   so a press is time-stamped up to this late */
+#define CLICK_POLL_US           50
+
+/* Onset mismatch allowed on top of the clock error: both boards wake
+   from a host sleep of up to one poll period to flush */
+#define ONSET_JITTER_US         250
+
+/* Allowed drift estimate error */
+#define DRIFT_TOLERANCE_PPB     20000
+
+/* Wall time limits */
+#define INVITE_TIMEOUT_S        5
+#define DUEL_TIMEOUT_S          120
+
+#define NEVER                   0xFFFFFFFFUL
+
+typedef struct {
+    uint8_t stimuli;
+    uint8_t results;
+    uint8_t outcomes;
+    uint64_t onsetNs[DUEL_ROUNDS];      /* host time each stimulus was flushed */
+    uint32_t allowedUs[DUEL_ROUNDS];    /* leader: onset error bound of the round */
+    uint32_t measuredMs[DUEL_ROUNDS];   /* reaction time the board measured */
+    duel_outcome_t outcome[DUEL_ROUNDS];    /* follower: verdicts received */
+} player_report_t;
+
+/* Follower minus leader rate, in parts per billion */
+#define TRUE_DRIFT_PPB  (((1.0 + FOLLOWER_SKEW_PPM * 1e-6) / (1.0 + LEADER_SKEW_PPM * 1e-6) - 1.0) * 1e9)
+
+/* What this process's board did */
+static player_report_t report;
+static uint8_t leading;
+static uint32_t stimulusMs = NEVER;
+static uint32_t lastResultMs;
+
+/*****************************************************************************
+** Function name:       hostNs
+**
+** Description:         Host monotonic time, shared by both processes.
+**
+** Parameters:          None
+** Returned value:      Nanoseconds since an arbitrary start
+*****************************************************************************/
+static uint64_t hostNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*****************************************************************************
+** Function name:       readKeys
+**
+** Description:         Script: holds center from the reaction time after
+**                      each stimulus until the board measured it. After
+**                      the last round it clicks periodically to leave
+**                      the end screen.
+**
+** Parameters:          nowMs - board time
+** Returned value:      JOYSTICK_* bits held
+*****************************************************************************/
+static uint8_t readKeys(uint32_t nowMs)
+{
+    uint32_t reactionMs = leading ? LEADER_REACTION_MS : FOLLOWER_REACTION_MS;
+
+    if ((stimulusMs != NEVER) && (nowMs >= stimulusMs + reactionMs)) {
+        return JOYSTICK_CENTER;
+    }
+    if ((report.results == DUEL_ROUNDS) && (nowMs - lastResultMs >= CLICK_EVERY_MS) &&
+        ((nowMs - lastResultMs) % CLICK_EVERY_MS < PRESS_MS)) {
+        return JOYSTICK_CENTER;
+    }
+    return 0;
+}
+
+/*****************************************************************************
+** Function name:       onStimulus
+**
+** Description:         Script: the stimulus is on the panel. The leader
+**                      also works out how far the follower's onset may
+**                      be off: the sync error bound, plus the error of
+**                      the drift estimate (none before the second sync)
+**                      over the time since the sync, plus jitter.
+**
+** Parameters:          nowMs - board time
+** Returned value:      None
+*****************************************************************************/
+static void onStimulus(uint32_t nowMs)
+{
+    const duel_sync_t *sync = duel_getSync();
+
+    if (report.stimuli < DUEL_ROUNDS) {
+        report.onsetNs[report.stimuli] = hostNs();
+        if (leading) {
+            double driftErrorPpb = fabs(TRUE_DRIFT_PPB - sync->driftPpb);
+            uint64_t sinceSyncUs = clock_nowUs() - sync->refUs;
+            report.allowedUs[report.stimuli] =
+                sync->errorUs + (uint32_t)(driftErrorPpb * sinceSyncUs / 1e9) + ONSET_JITTER_US;
+        }
+    }
+    report.stimuli++;
+    stimulusMs = nowMs;
+}
+
+/*****************************************************************************
+** Function name:       onResult
+**
+** Description:         Script: the board measured the click.
+**
+** Parameters:          ms - measured reaction time
+** Returned value:      None
+*****************************************************************************/
+static void onResult(uint32_t ms)
+{
+    if (report.results < DUEL_ROUNDS) {
+        report.measuredMs[report.results] = ms;
+    }
+    report.results++;
+    stimulusMs = NEVER;
+    lastResultMs = clock_nowMs();
+}
+
+/*****************************************************************************
+** Function name:       followerCommand
+**
+** Description:         Link handler of the follower: the game's own, for
+**                      the duel commands, which also keeps a copy of each
+**                      verdict the leader sends.
+**
+** Parameters:          cmd      - REMOTE_CMD_* command
+**                      payload  - command payload
+**                      len      - payload length
+**                      reply    - reply payload to fill
+**                      replyLen - reply payload length
+** Returned value:      0, or a REMOTE_ERR_* code
+*****************************************************************************/
+static uint8_t followerCommand(uint8_t cmd, const uint8_t *payload, uint8_t len,
+                               uint8_t *reply, uint8_t *replyLen)
+{
+    uint8_t error = duel_command(cmd, payload, len, reply, replyLen);
+
+    if ((error == 0) && (cmd == REMOTE_CMD_DUEL_OUTCOME) && (report.outcomes < DUEL_ROUNDS)) {
+        duel_outcome_t *outcome = &report.outcome[report.outcomes++];
+        outcome->round = payload[0];
+        outcome->winner = payload[1];
+        outcome->leaderUs = payload_getU32(&payload[2]);
+        outcome->followerUs = payload_getU32(&payload[6]);
+    }
+    return error;
+}
+
+/*****************************************************************************
+** Function name:       runFollower
+**
+** Description:         Follower board: waits in the link loop for the
+**                      invite, as the main menu does, and plays the duel.
+**
+** Parameters:          device - pseudo-terminal of the leader
+**                      ready  - pipe told once the link is open
+** Returned value:      None
+*****************************************************************************/
+static void runFollower(const char *device, int ready)
+{
+    static const input_source_t script = { readKeys, onStimulus, onResult };
+    uint64_t deadlineNs;
+
+    hosttest_boot();
+    clock_setRealtime(FOLLOWER_SKEW_PPM);
+    setenv("REFLEX_SERIAL", device, 1);
+    serial_init();
+    remote_init(followerCommand);
+    if (write(ready, "", 1) != 1) {
+        return;
+    }
+
+    deadlineNs = hostNs() + (uint64_t)INVITE_TIMEOUT_S * 1000000000;
+    input_setSource(&script);
+    while (!duel_isInvited() && (hostNs() < deadlineNs)) {
+        input_read();
+        clock_delayUs(50);
+    }
+    if (duel_isInvited()) {
+        start_duel();
+    }
+}
+
+int main(void)
+{
+    static const input_source_t script = { readKeys, onStimulus, onResult };
+    player_report_t follower = { 0 };
+    int reportPipe[2];
+    int readyPipe[2];
+    char ready;
+    int status;
+    pid_t pid;
+
+    hosttest_boot();
+    clock_setRealtime(LEADER_SKEW_PPM);
+    serial_init();
+    remote_init(duel_command);
+
+    fflush(NULL);
+    if ((pipe(reportPipe) != 0) || (pipe(readyPipe) != 0) || ((pid = fork()) < 0)) {
+        CHECK(0, "cannot start the follower");
+        return hosttest_done("duel_test");
+    }
+    if (pid == 0) {
+        alarm(DUEL_TIMEOUT_S);
+        close(reportPipe[0]);
+        close(readyPipe[0]);
+        runFollower(serial_getDevice(), readyPipe[1]);
+        _exit(write(reportPipe[1], &report, sizeof(report)) == (ssize_t)sizeof(report) ? 0 : 1);
+    }
+    close(reportPipe[1]);
+    close(readyPipe[1]);
+    alarm(DUEL_TIMEOUT_S);
+
+    // Leader: the player picks "Duel" once the other board listens
+    CHECK(read(readyPipe[0], &ready, 1) == 1, "follower did not open the link");
+    leading = 1;
+    input_setSource(&script);
+    start_duel();
+
+    CHECK(read(reportPipe[0], &follower, sizeof(follower)) == (ssize_t)sizeof(follower),
+          "no report from the follower");
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && (WEXITSTATUS(status) == 0), "follower failed");
+
+    CHECK((report.stimuli == DUEL_ROUNDS) && (follower.stimuli == DUEL_ROUNDS),
+          "stimuli: leader %u, follower %u", report.stimuli, follower.stimuli);
+    CHECK(follower.outcomes == DUEL_ROUNDS, "%u verdicts received", follower.outcomes);
+
+    for (uint8_t round = 0; round < DUEL_ROUNDS; round++) {
+        const duel_outcome_t *outcome = &follower.outcome[round];
+        int64_t skewUs = ((int64_t)follower.onsetNs[round] - (int64_t)report.onsetNs[round]) / 1000;
+        uint32_t allowedUs = report.allowedUs[round];
+
+        printf("round %u: onsets %+ld us apart (allowed %lu), leader %lu us, follower %lu us\n",
+               round, (long)skewUs, (unsigned long)allowedUs, (unsigned long)outcome->leaderUs,
+               (unsigned long)outcome->followerUs);
+        CHECK((skewUs <= (int64_t)allowedUs) && (skewUs >= -(int64_t)allowedUs),
+              "round %u: onsets %ld us apart", round, (long)skewUs);
+        CHECK((report.measuredMs[round] + 1 >= LEADER_REACTION_MS) &&
+                  (report.measuredMs[round] <= LEADER_REACTION_MS),
+              "round %u: leader measured %lu ms", round, (unsigned long)report.measuredMs[round]);
+        CHECK((follower.measuredMs[round] + 1 >= FOLLOWER_REACTION_MS) &&
+                  (follower.measuredMs[round] <= FOLLOWER_REACTION_MS),
+              "round %u: follower measured %lu ms", round,
+              (unsigned long)follower.measuredMs[round]);
+        CHECK((outcome->round == round) && (outcome->winner == DUEL_WIN_FOLLOWER),
+              "round %u: verdict for round %u, winner %u", round, outcome->round,
+              outcome->winner);
+        CHECK((outcome->leaderUs + 1000 >= LEADER_REACTION_MS * 1000) &&
+                  (outcome->leaderUs <= LEADER_REACTION_MS * 1000 + CLICK_POLL_US),
+              "round %u: leader time %lu us", round, (unsigned long)outcome->leaderUs);
+        CHECK((outcome->followerUs + 1000 + allowedUs >= FOLLOWER_REACTION_MS * 1000) &&
+                  (outcome->followerUs <=
+                   FOLLOWER_REACTION_MS * 1000 + CLICK_POLL_US + allowedUs),
+              "round %u: follower time %lu us on the leader's clock", round,
+              (unsigned long)outcome->followerUs);
+    }
+
+    double trueDriftPpb = TRUE_DRIFT_PPB;
+    const duel_sync_t *sync = duel_getSync();
+    printf("drift %ld ppb (true %.0f), %u bursts\n", (long)sync->driftPpb, trueDriftPpb,
+           sync->samples);
+    CHECK(sync->samples == DUEL_ROUNDS, "%u sync bursts", sync->samples);
+    CHECK((sync->driftPpb > trueDriftPpb - DRIFT_TOLERANCE_PPB) &&
+              (sync->driftPpb < trueDriftPpb + DRIFT_TOLERANCE_PPB),
+          "drift estimate %ld ppb, true %.0f ppb", (long)sync->driftPpb, trueDriftPpb);
+
+    return hosttest_done("duel_test");
+}
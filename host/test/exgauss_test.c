@@ -0,0 +1,184 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test of the streaming ex-Gaussian estimate: mu,
+ *                sigma and tau of known ex-Gaussian samples against the
+ *                true parameters and a double-precision method-of-moments
+ *                reference, and the degenerate cases.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "exgauss.h"
+
+#include "hosttest.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define SAMPLES     20000
+
+typedef struct {
+    double mu;
+    double sigma;
+    double tau;
+} reference_t;
+
+/* xorshift32 state of the sample generator */
+static uint32_t rngState = 2463534242u;
+
+/*****************************************************************************
+** Function name:       uniform
+**
+** Description:         Uniform deviate strictly inside (0, 1).
+**
+** Parameters:          None
+** Returned value:      Random value
+*****************************************************************************/
+static double uniform(void)
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return ((double)rngState + 1.0) / 4294967297.0;
+}
+
+/*****************************************************************************
+** Function name:       exGaussian
+**
+** Description:         Draws an ex-Gaussian reaction time, rounded to ms.
+**
+** Parameters:          mu, sigma, tau - distribution parameters in ms
+** Returned value:      Reaction time in ms, at least 1
+*****************************************************************************/
+static uint32_t exGaussian(double mu, double sigma, double tau)
+{
+    double gauss = sqrt(-2.0 * log(uniform())) * cos(6.283185307179586 * uniform());
+    double x = mu + sigma * gauss - tau * log(uniform());
+
+    return (x < 1.0) ? 1 : (uint32_t)(x + 0.5);
+}
+
+/*****************************************************************************
+** Function name:       momentsFit
+**
+** Description:         Method-of-moments fit in double precision with
+**                      two-pass central moments, the reference for the
+**                      firmware's single-precision power sums.
+**
+** Parameters:          samples - reaction times
+**                      count   - number of samples
+** Returned value:      Fitted parameters
+*****************************************************************************/
+static reference_t momentsFit(const uint32_t *samples, uint32_t count)
+{
+    double mean = 0.0;
+    double m2 = 0.0;
+    double m3 = 0.0;
+    reference_t fit;
+
+    for (uint32_t i = 0; i < count; i++) {
+        mean += samples[i];
+    }
+    mean /= count;
+    for (uint32_t i = 0; i < count; i++) {
+        double d = samples[i] - mean;
+        m2 += d * d;
+        m3 += d * d * d;
+    }
+    m2 /= count;
+    m3 /= count;
+
+    fit.tau = (m3 > 0.0) ? cbrt(m3 / 2.0) : 0.0;
+    if (fit.tau * fit.tau > m2 * 8.0 / 9.0) {
+        fit.tau = sqrt(m2 * 8.0 / 9.0);
+    }
+    fit.sigma = sqrt(m2 - fit.tau * fit.tau);
+    fit.mu = mean - fit.tau;
+    return fit;
+}
+
+/*****************************************************************************
+** Function name:       checkDistribution
+**
+** Description:         Feeds ex-Gaussian samples to a player slot and
+**                      compares the estimate with the double-precision
+**                      fit of the same samples (within 1 ms) and with the
+**                      true parameters (within the given tolerance).
+**
+** Parameters:          mu, sigma, tau - true parameters in ms
+**                      tolerance      - allowed sampling error in ms
+** Returned value:      None
+*****************************************************************************/
+static void checkDistribution(double mu, double sigma, double tau, double tolerance)
+{
+    static uint32_t samples[SAMPLES];
+    exgauss_params_t fit;
+
+    exgauss_reset(0);
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        samples[i] = exGaussian(mu, sigma, tau);
+        exgauss_addResult(0, samples[i]);
+    }
+
+    reference_t ref = momentsFit(samples, SAMPLES);
+    CHECK(exgauss_estimate(0, &fit), "no estimate from %u samples", SAMPLES);
+    CHECK(fabs(fit.mu - ref.mu) <= 1.0 && fabs(fit.sigma - ref.sigma) <= 1.0 &&
+              fabs(fit.tau - ref.tau) <= 1.0,
+          "ex-Gaussian(%g, %g, %g): estimate %u/%u/%u, double fit %.1f/%.1f/%.1f", mu, sigma,
+          tau, fit.mu, fit.sigma, fit.tau, ref.mu, ref.sigma, ref.tau);
+    CHECK(fabs(fit.mu - mu) <= tolerance && fabs(fit.sigma - sigma) <= tolerance &&
+              fabs(fit.tau - tau) <= tolerance,
+          "ex-Gaussian(%g, %g, %g): estimate %u/%u/%u", mu, sigma, tau, fit.mu, fit.sigma,
+          fit.tau);
+}
+
+int main(void)
+{
+    exgauss_params_t fit;
+
+    // Typical simple reaction times, a slow and a very skewed player
+    checkDistribution(250, 30, 80, 10);
+    checkDistribution(300, 40, 100, 10);
+    checkDistribution(450, 60, 200, 20);
+    checkDistribution(220, 20, 30, 8);
+
+    // Too few results give no estimate
+    exgauss_reset(1);
+    for (uint32_t i = 0; i < EXGAUSS_MIN_SAMPLES - 1; i++) {
+        exgauss_addResult(1, 300);
+    }
+    CHECK(!exgauss_estimate(1, &fit), "estimate from %u results", EXGAUSS_MIN_SAMPLES - 1);
+
+    // Constant results: all of it is mu
+    exgauss_addResult(1, 300);
+    CHECK(exgauss_estimate(1, &fit) && fit.mu == 300 && fit.sigma == 0 && fit.tau == 0,
+          "constant 300 ms: %u/%u/%u", fit.mu, fit.sigma, fit.tau);
+
+    // Negative skew has no exponential part
+    exgauss_reset(2);
+    for (uint32_t i = 0; i < 100; i++) {
+        exgauss_addResult(2, (i < 90) ? 400 : 200);
+    }
+    CHECK(exgauss_estimate(2, &fit) && fit.tau == 0, "negative skew: tau %u", fit.tau);
+
+    // Extreme skew is capped so sigma keeps a third of the deviation
+    exgauss_reset(3);
+    for (uint32_t i = 0; i < 100; i++) {
+        exgauss_addResult(3, (i < 98) ? 200 : 2000);
+    }
+    CHECK(exgauss_estimate(3, &fit) && fit.sigma > 0 && fit.tau > fit.sigma,
+          "capped skew: %u/%u/%u", fit.mu, fit.sigma, fit.tau);
+
+    // Players are independent, reset forgets, timeouts are clamped
+    CHECK(exgauss_getCount(1) == EXGAUSS_MIN_SAMPLES && exgauss_getCount(2) == 100,
+          "player counts %u, %u", exgauss_getCount(1), exgauss_getCount(2));
+    exgauss_reset(1);
+    CHECK(exgauss_getCount(1) == 0, "%u results after reset", exgauss_getCount(1));
+    for (uint32_t i = 0; i < EXGAUSS_MIN_SAMPLES; i++) {
+        exgauss_addResult(1, 60000);
+    }
+    CHECK(exgauss_estimate(1, &fit) && fit.mu == 10000, "clamped results: mu %u", fit.mu);
+
+    return hosttest_done("exgauss_test");
+}
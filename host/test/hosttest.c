@@ -0,0 +1,126 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Shared helpers of the host tests, see hosttest.h.
+ *
+ ******************************************************************************/
+
+#include "mcu_regs.h"
+#include "type.h"
+#include "ssp.h"
+
+#include "eeprom.h"
+#include "led7seg.h"
+#include "light.h"
+#include "oled.h"
+#include "pca9532.h"
+
+#include "board.h"
+#include "clock.h"
+#include "display.h"
+#include "input.h"
+#include "lifetime.h"
+#include "power.h"
+#include "sleep.h"
+#include "sspbus.h"
+
+#include "hosttest.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+
+static uint32_t checks;
+static uint32_t failures;
+
+/*****************************************************************************
+** Function name:       hosttest_boot
+**
+** Description:         Power-on of the board model and the init sequence
+**                      of main(), without the startup animation and the
+**                      welcome screen. No input source is installed.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void hosttest_boot(void)
+{
+    board_reset();
+    clock_init();
+    input_setSource(NULL);
+    SSPInit();
+    oled_init();
+    led7seg_init();
+    sspbus_init();
+    display_init();
+    light_init();
+    light_enable();
+    srand(light_read());
+    init_light_interrupt();
+    pca9532_init();
+    eeprom_init();
+    lifetime_init();
+    power_init();
+    adjust_theme();
+    sleep_touch();
+}
+
+/*****************************************************************************
+** Function name:       hosttest_check
+**
+** Description:         Counts a check and reports it if it failed.
+**
+** Parameters:          ok     - nonzero if the check passed
+**                      file   - source file of the check
+**                      line   - source line of the check
+**                      format - printf-style description
+** Returned value:      None
+*****************************************************************************/
+void hosttest_check(int ok, const char *file, int line, const char *format, ...)
+{
+    va_list args;
+
+    checks++;
+    if (ok) {
+        return;
+    }
+    failures++;
+    printf("%s:%d: FAIL: ", file, line);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+/*****************************************************************************
+** Function name:       hosttest_panelLit
+**
+** Description:         Counts the pixels the panel shows lit.
+**
+** Parameters:          None
+** Returned value:      Number of lit pixels
+*****************************************************************************/
+uint32_t hosttest_panelLit(void)
+{
+    uint32_t lit = 0;
+
+    for (uint8_t y = 0; y < OLED_DISPLAY_HEIGHT; y++) {
+        for (uint8_t x = 0; x < OLED_DISPLAY_WIDTH; x++) {
+            lit += board_panelPixel(x, y);
+        }
+    }
+    return lit;
+}
+
+/*****************************************************************************
+** Function name:       hosttest_done
+**
+** Description:         Prints the summary of a test program.
+**
+** Parameters:          name - name of the test program
+** Returned value:      Exit status: 0 if every check passed
+*****************************************************************************/
+int hosttest_done(const char *name)
+{
+    printf("%s: %lu checks, %lu failed\n", name, (unsigned long)checks,
+           (unsigned long)failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
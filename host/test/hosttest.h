@@ -0,0 +1,36 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Shared helpers of the host tests: boots the game on the
+ *                board model the way main() does, minus the animations,
+ *                and counts failed checks.
+ *
+ ******************************************************************************/
+
+#ifndef __HOSTTEST_H
+#define __HOSTTEST_H
+
+#include <stdio.h>
+
+/* Records a failed check with its location and a printf-style message */
+#define CHECK(cond, ...) \
+    hosttest_check((cond) != 0, __FILE__, __LINE__, __VA_ARGS__)
+
+/* Game functions of main.c the tests drive (main() is reflex_main()) */
+void start_game(void);
+void start_duel(void);
+void draw_menu(void);
+void init_menu(void);
+void show_stats_screen(void);
+void show_main_menu(void);
+void show_welcome_screen(void);
+void wait_for_joystick_center_click(void);
+void init_light_interrupt(void);
+uint8_t adjust_theme(void);
+
+void hosttest_boot(void);
+void hosttest_check(int ok, const char *file, int line, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+uint32_t hosttest_panelLit(void);
+int hosttest_done(const char *name);
+
+#endif /* end __HOSTTEST_H */
@@ -0,0 +1,43 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test and driver of the latency harness: fuzzes the
+ *                whole UI from the main menu for a fixed simulated time,
+ *                prints the latency report and checks that the run ends
+ *                on time wherever the UI happens to be.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "clock.h"
+#include "latency.h"
+
+#include "hosttest.h"
+
+#include <stdlib.h>
+
+/* Simulated run time, default 30 minutes; argv[1] overrides it in ms */
+#define RUN_MS          (30UL * 60 * 1000)
+
+/* Longest stretch the UI spends without polling input (a long melody) */
+#define POLL_GAP_MS     5000
+
+int main(int argc, char **argv)
+{
+    static const latency_fuzz_t fuzz = { 0x1A7E, 20, 400, 1500 };
+    uint32_t runMs = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : RUN_MS;
+
+    hosttest_boot();
+    latency_runFuzz(&fuzz, runMs, show_main_menu);
+    printf("fuzzed %lu ms of simulated time\n\n", (unsigned long)clock_nowMs());
+    latency_printReport(3);
+    printf("\n");
+
+    CHECK(clock_nowMs() >= runMs && clock_nowMs() < runMs + POLL_GAP_MS,
+          "run of %lu ms ended at %lu ms", (unsigned long)runMs, (unsigned long)clock_nowMs());
+    CHECK(latency_getCount(LATENCY_NAV) > 0, "no menu navigation");
+    CHECK(latency_getCount(LATENCY_SELECT) > 0, "no menu selection");
+    CHECK(latency_getCount(LATENCY_CLICK) > 0, "no prompt confirmed");
+
+    return hosttest_done("latency_test");
+}
@@ -0,0 +1,191 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test of the lifetime histogram: the mapping of
+ *                reaction times to log-scale bins, percentile accuracy,
+ *                saturation and persistence across a reboot.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "board.h"
+#include "lifetime.h"
+#include "nvstore.h"
+
+#include "hosttest.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/*****************************************************************************
+** Function name:       edge
+**
+** Description:         Reference bin edge: 80 ms times 25^(i/31), rounded.
+**
+** Parameters:          i - edge index, 0..LIFETIME_BINS
+** Returned value:      Edge in ms
+*****************************************************************************/
+static uint32_t edge(uint8_t i)
+{
+    return (uint32_t)lround(80.0 * pow(25.0, i / 31.0));
+}
+
+/*****************************************************************************
+** Function name:       freshHistogram
+**
+** Description:         Erases the EEPROM and starts an empty histogram.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void freshHistogram(void)
+{
+    board_reset();
+    lifetime_init();
+}
+
+/*****************************************************************************
+** Function name:       binOfSingle
+**
+** Description:         Bin a single result lands in, read back through
+**                      the median: a lone result is placed at the centre
+**                      of its bin.
+**
+** Parameters:          ms - reaction time
+** Returned value:      Bin index, LIFETIME_BINS if the median fits none
+*****************************************************************************/
+static uint8_t binOfSingle(uint32_t ms)
+{
+    freshHistogram();
+    lifetime_addResult(ms);
+
+    uint16_t median = lifetime_percentile(50);
+    for (uint8_t i = 0; i < LIFETIME_BINS; i++) {
+        if ((median >= edge(i)) && (median < edge(i + 1))) {
+            CHECK(median == edge(i) + (edge(i + 1) - edge(i)) / 2,
+                  "%lu ms: median %u not at the centre of bin %u", (unsigned long)ms, median, i);
+            return i;
+        }
+    }
+    return LIFETIME_BINS;
+}
+
+/*****************************************************************************
+** Function name:       compareUint
+**
+** Description:         qsort() order of uint32_t values.
+**
+** Parameters:          a, b - values to compare
+** Returned value:      <0, 0 or >0
+*****************************************************************************/
+static int compareUint(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*****************************************************************************
+** Function name:       checkPercentiles
+**
+** Description:         Compares the histogram's percentiles of a sample
+**                      with the exact nearest-rank ones. The estimate must
+**                      stay within the width of the bin holding the exact
+**                      value, and within half of it on average.
+**
+** Parameters:          samples - reaction times, sorted on return
+**                      count   - number of samples
+** Returned value:      None
+*****************************************************************************/
+static void checkPercentiles(uint32_t *samples, uint32_t count)
+{
+    double relErrorSum = 0.0;
+    uint32_t checked = 0;
+
+    freshHistogram();
+    for (uint32_t i = 0; i < count; i++) {
+        lifetime_addResult(samples[i]);
+    }
+    qsort(samples, count, sizeof(samples[0]), compareUint);
+
+    for (uint8_t percent = 1; percent <= 99; percent++) {
+        uint32_t exact = samples[(percent * count + 99) / 100 - 1];
+        uint32_t estimate = lifetime_percentile(percent);
+        uint8_t bin = 0;
+
+        while ((bin < LIFETIME_BINS - 1) && (exact >= edge(bin + 1))) {
+            bin++;
+        }
+        uint32_t width = edge(bin + 1) - edge(bin);
+        uint32_t error = (estimate > exact) ? estimate - exact : exact - estimate;
+        CHECK(error <= width, "p%u: estimate %lu, exact %lu, bin width %lu", percent,
+              (unsigned long)estimate, (unsigned long)exact, (unsigned long)width);
+        relErrorSum += (double)error / width;
+        checked++;
+    }
+    CHECK(relErrorSum / checked <= 0.5, "mean percentile error %.2f bin widths",
+          relErrorSum / checked);
+}
+
+int main(void)
+{
+    static uint32_t samples[2000];
+
+    hosttest_boot();
+
+    // Every edge opens its bin, one ms below belongs to the bin before
+    for (uint8_t i = 0; i < LIFETIME_BINS; i++) {
+        CHECK(binOfSingle(edge(i)) == i, "%lu ms not in bin %u", (unsigned long)edge(i), i);
+        if (i > 0) {
+            CHECK(binOfSingle(edge(i) - 1) == i - 1, "%lu ms not in bin %u",
+                  (unsigned long)(edge(i) - 1), i - 1);
+        }
+    }
+
+    // Out of range results go to the outer bins
+    CHECK(binOfSingle(1) == 0, "1 ms not in the first bin");
+    CHECK(binOfSingle(79) == 0, "79 ms not in the first bin");
+    CHECK(binOfSingle(5000) == LIFETIME_BINS - 1, "5000 ms not in the last bin");
+    CHECK(binOfSingle(65535) == LIFETIME_BINS - 1, "65535 ms not in the last bin");
+
+    freshHistogram();
+    CHECK(lifetime_percentile(50) == 0, "empty histogram has a median");
+
+    // Evenly spread results, then a skewed, ex-Gaussian-like sample
+    for (uint32_t i = 0; i < 1000; i++) {
+        samples[i] = 200 + (i * 2) / 5;
+    }
+    checkPercentiles(samples, 1000);
+
+    srand(1234);
+    for (uint32_t i = 0; i < 2000; i++) {
+        double u = (rand() + 1.0) / ((double)RAND_MAX + 2.0);
+        samples[i] = 180 + rand() % 120 + (uint32_t)(-120.0 * log(u));
+    }
+    checkPercentiles(samples, 2000);
+
+    // Counters saturate instead of wrapping
+    freshHistogram();
+    for (uint32_t i = 0; i < 70000; i++) {
+        lifetime_addResult(250);
+    }
+    CHECK(lifetime_getCount() == 0xFFFF, "saturated count %lu", (unsigned long)lifetime_getCount());
+
+    // A session in one page costs one page write and survives a reboot
+    freshHistogram();
+    for (uint32_t i = 0; i < 5; i++) {
+        lifetime_addResult(240 + i * 10);
+    }
+    uint16_t median = lifetime_percentile(50);
+    uint32_t writes = nvstore_getWriteCount();
+    lifetime_commit();
+    CHECK(nvstore_getWriteCount() - writes == 1, "session commit took %lu page writes",
+          (unsigned long)(nvstore_getWriteCount() - writes));
+    lifetime_init();
+    CHECK(lifetime_getCount() == 5, "%lu results after reboot", (unsigned long)lifetime_getCount());
+    CHECK(lifetime_percentile(50) == median, "median %u after reboot, %u before",
+          lifetime_percentile(50), median);
+
+    return hosttest_done("lifetime_test");
+}
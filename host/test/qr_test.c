@@ -0,0 +1,614 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test of the QR encoder: renders the share code of a
+ *                known session for each of versions 1 to 3, reads the
+ *                modules back from the panel and checks them against an
+ *                independent reference: the light quiet zone, function
+ *                patterns, format bits
+ *                from the table of ISO/IEC 18004, the decoded data, zero
+ *                Reed-Solomon syndromes and the penalty-optimal mask.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "oled.h"
+
+#include "board.h"
+#include "display.h"
+#include "qr.h"
+
+#include "hosttest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Level L format information for masks 0-7, BCH coded and masked */
+static const uint16_t formatL[8] = {
+    0x77C4, 0x72F3, 0x7DAA, 0x789D, 0x662F, 0x6318, 0x6C41, 0x6976
+};
+
+/* Per version: data and error correction codewords, remainder bits */
+static const uint8_t refData[QR_VERSION_MAX] = { 19, 34, 55 };
+static const uint8_t refEcc[QR_VERSION_MAX] = { 7, 10, 15 };
+static const uint8_t refRemainder[QR_VERSION_MAX] = { 0, 7, 7 };
+
+/* Finder-like pattern of the penalty rules, with four light modules */
+static const uint8_t finderLike[2][11] = {
+    { 1, 0, 1, 1, 1, 0, 1, 0, 0, 0, 0 },
+    { 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1 }
+};
+
+typedef struct {
+    const char *text;
+    uint8_t version;
+} sample_t;
+
+/* Share texts as show_share_screen() builds them, one per version */
+static const sample_t samples[] = {
+    { "P1 231 198 305", 1 },
+    { "P1 231 198 305\navg 244 best 198", 2 },
+    { "P2 250 212 287 199\navg 237 best 199\nexG 201/24/34", 3 },
+};
+
+typedef struct {
+    uint8_t version;
+    uint8_t size;
+    uint8_t dark[QR_SIZE_MAX][QR_SIZE_MAX];    /* [row][column] */
+} matrix_t;
+
+/*****************************************************************************
+** Function name:       gfMulRef
+**
+** Description:         GF(256) product by shift and add, modulo
+**                      x^8 + x^4 + x^3 + x^2 + 1, without tables.
+**
+** Parameters:          a, b - factors
+** Returned value:      Product
+*****************************************************************************/
+static uint8_t gfMulRef(uint8_t a, uint8_t b)
+{
+    uint8_t product = 0;
+
+    while (b != 0) {
+        if (b & 1) {
+            product ^= a;
+        }
+        a = (a & 0x80) ? (uint8_t)((a << 1) ^ 0x1D) : (uint8_t)(a << 1);
+        b >>= 1;
+    }
+    return product;
+}
+
+/*****************************************************************************
+** Function name:       isReserved
+**
+** Description:         Whether a module is a function pattern, separator
+**                      or format module, as laid out in the standard.
+**
+** Parameters:          m        - symbol
+**                      row, col - module
+** Returned value:      1 if data never goes there
+*****************************************************************************/
+static uint8_t isReserved(const matrix_t *m, int row, int col)
+{
+    int last = m->size - 1;
+    int align = m->size - 7;
+
+    if ((row <= 8) && ((col <= 8) || (col >= last - 7))) {
+        return 1;
+    }
+    if ((col <= 8) && (row >= last - 7)) {
+        return 1;
+    }
+    if ((row == 6) || (col == 6)) {
+        return 1;
+    }
+    return (m->version >= 2) && (abs(row - align) <= 2) && (abs(col - align) <= 2);
+}
+
+/*****************************************************************************
+** Function name:       maskRef
+**
+** Description:         Mask condition of the standard, i = row, j = column.
+**
+** Parameters:          mask - mask reference 0-7
+**                      i, j - module
+** Returned value:      1 where the mask inverts the module
+*****************************************************************************/
+static uint8_t maskRef(uint8_t mask, int i, int j)
+{
+    switch (mask) {
+    case 0:  return (i + j) % 2 == 0;
+    case 1:  return i % 2 == 0;
+    case 2:  return j % 3 == 0;
+    case 3:  return (i + j) % 3 == 0;
+    case 4:  return (i / 2 + j / 3) % 2 == 0;
+    case 5:  return (i * j) % 2 + (i * j) % 3 == 0;
+    case 6:  return ((i * j) % 2 + (i * j) % 3) % 2 == 0;
+    default: return ((i * j) % 3 + (i + j) % 2) % 2 == 0;
+    }
+}
+
+/*****************************************************************************
+** Function name:       formatModule
+**
+** Description:         Location of one bit of either copy of the format
+**                      information.
+**
+** Parameters:          size     - modules per side
+**                      copy     - 0 around the top-left finder, 1 split
+**                                 between the other two
+**                      bit      - bit 0 (LSB) to 14
+**                      row, col - receive the module
+** Returned value:      None
+*****************************************************************************/
+static void formatModule(uint8_t size, uint8_t copy, uint8_t bit, int *row, int *col)
+{
+    if ((copy == 0) && (bit <= 5)) {
+        *row = bit;
+        *col = 8;
+    } else if ((copy == 0) && (bit <= 7)) {
+        *row = bit + 1;     // over the timing row
+        *col = 8;
+    } else if (copy == 0) {
+        *row = 8;
+        *col = (bit == 8) ? 7 : 14 - bit;
+    } else if (bit <= 7) {
+        *row = 8;
+        *col = size - 1 - bit;
+    } else {
+        *row = size - 15 + bit;
+        *col = 8;
+    }
+}
+
+/*****************************************************************************
+** Function name:       placement
+**
+** Description:         Where qr_draw() puts a symbol in the full-height
+**                      band: the largest whole scale that fits it with
+**                      QR_QUIET_MIN light modules above and below,
+**                      centered.
+**
+** Parameters:          size  - modules per side
+**                      scale - receives pixels per module
+**                      left  - receives the left edge in pixels
+**                      top   - receives the top edge in pixels
+** Returned value:      None
+*****************************************************************************/
+static void placement(uint8_t size, uint8_t *scale, uint8_t *left, uint8_t *top)
+{
+    *scale = OLED_DISPLAY_HEIGHT / (size + 2 * QR_QUIET_MIN);
+    *left = (OLED_DISPLAY_WIDTH - size * *scale) / 2;
+    *top = (OLED_DISPLAY_HEIGHT - size * *scale) / 2;
+}
+
+/*****************************************************************************
+** Function name:       readPanel
+**
+** Description:         Samples the center of every module on the panel.
+**                      Dark is unlit.
+**
+** Parameters:          version - expected version
+**                      m       - receives the symbol
+** Returned value:      None
+*****************************************************************************/
+static void readPanel(uint8_t version, matrix_t *m)
+{
+    uint8_t scale;
+    uint8_t left;
+    uint8_t top;
+
+    m->version = version;
+    m->size = 17 + 4 * version;
+    placement(m->size, &scale, &left, &top);
+
+    for (uint8_t row = 0; row < m->size; row++) {
+        for (uint8_t col = 0; col < m->size; col++) {
+            m->dark[row][col] = !board_panelPixel(left + col * scale + scale / 2,
+                                                  top + row * scale + scale / 2);
+        }
+    }
+}
+
+/*****************************************************************************
+** Function name:       checkQuietZone
+**
+** Description:         Checks that the symbol has at least QR_QUIET_MIN
+**                      modules of panel on every side and that all of
+**                      the band outside the symbol is lit (light).
+**
+** Parameters:          size - modules per side
+** Returned value:      None
+*****************************************************************************/
+static void checkQuietZone(uint8_t size)
+{
+    uint8_t scale;
+    uint8_t left;
+    uint8_t top;
+    uint16_t dark = 0;
+
+    placement(size, &scale, &left, &top);
+    uint8_t right = left + size * scale;
+    uint8_t bottom = top + size * scale;
+
+    CHECK(scale >= 1, "%u modules: no room on the panel", size);
+    CHECK((top >= QR_QUIET_MIN * scale) && (OLED_DISPLAY_HEIGHT - bottom >= QR_QUIET_MIN * scale) &&
+              (left >= QR_QUIET_MIN * scale) && (OLED_DISPLAY_WIDTH - right >= QR_QUIET_MIN * scale),
+          "%u modules at %u px: margins %u/%u/%u/%u px", size, scale, top,
+          OLED_DISPLAY_HEIGHT - bottom, left, OLED_DISPLAY_WIDTH - right);
+    for (uint8_t y = 0; y < OLED_DISPLAY_HEIGHT; y++) {
+        for (uint8_t x = 0; x < OLED_DISPLAY_WIDTH; x++) {
+            if ((y < top) || (y >= bottom) || (x < left) || (x >= right)) {
+                dark += !board_panelPixel(x, y);
+            }
+        }
+    }
+    CHECK(dark == 0, "%u modules: %u dark pixels around the symbol", size, dark);
+}
+
+/*****************************************************************************
+** Function name:       checkPatterns
+**
+** Description:         Checks the finders with their separators, the
+**                      timing patterns, the alignment pattern and the
+**                      dark module.
+**
+** Parameters:          m - symbol read from the panel
+** Returned value:      None
+*****************************************************************************/
+static void checkPatterns(const matrix_t *m)
+{
+    static const int corners[3][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 } };
+    int far = m->size - 7;
+    int align = m->size - 7;
+    uint16_t wrong = 0;
+
+    for (uint8_t f = 0; f < 3; f++) {
+        int top = corners[f][0] * far;
+        int left = corners[f][1] * far;
+        for (int dr = -1; dr <= 7; dr++) {
+            for (int dc = -1; dc <= 7; dc++) {
+                int row = top + dr;
+                int col = left + dc;
+                if ((row < 0) || (col < 0) || (row >= m->size) || (col >= m->size)) {
+                    continue;
+                }
+                int ring = abs(dr - 3) > abs(dc - 3) ? abs(dr - 3) : abs(dc - 3);
+                wrong += m->dark[row][col] != ((ring <= 3) && (ring != 2));
+            }
+        }
+    }
+    CHECK(wrong == 0, "version %u: %u finder or separator modules wrong", m->version, wrong);
+
+    wrong = 0;
+    for (int i = 8; i < m->size - 8; i++) {
+        wrong += m->dark[6][i] != (i % 2 == 0);
+        wrong += m->dark[i][6] != (i % 2 == 0);
+    }
+    CHECK(wrong == 0, "version %u: %u timing modules wrong", m->version, wrong);
+
+    if (m->version >= 2) {
+        wrong = 0;
+        for (int dr = -2; dr <= 2; dr++) {
+            for (int dc = -2; dc <= 2; dc++) {
+                int ring = abs(dr) > abs(dc) ? abs(dr) : abs(dc);
+                wrong += m->dark[align + dr][align + dc] != (ring != 1);
+            }
+        }
+        CHECK(wrong == 0, "version %u: %u alignment modules wrong", m->version, wrong);
+    }
+    CHECK(m->dark[m->size - 8][8], "version %u: dark module light", m->version);
+}
+
+/*****************************************************************************
+** Function name:       readFormat
+**
+** Description:         Reads one copy of the format information.
+**
+** Parameters:          m    - symbol
+**                      copy - 0 or 1, see formatModule()
+** Returned value:      The 15 format bits
+*****************************************************************************/
+static uint16_t readFormat(const matrix_t *m, uint8_t copy)
+{
+    uint16_t bits = 0;
+    int row;
+    int col;
+
+    for (uint8_t bit = 0; bit < 15; bit++) {
+        formatModule(m->size, copy, bit, &row, &col);
+        bits |= (uint16_t)m->dark[row][col] << bit;
+    }
+    return bits;
+}
+
+/*****************************************************************************
+** Function name:       readCodewords
+**
+** Description:         Removes the mask and reads the data modules in the
+**                      standard's order: upward and downward in column
+**                      pairs from the right, skipping the timing column.
+**
+** Parameters:          m         - masked symbol
+**                      mask      - mask to remove
+**                      codewords - receives the codewords
+**                      count     - codewords to read
+**                      extra     - receives the number of data modules
+**                                  left after them
+** Returned value:      Number of dark remainder modules
+*****************************************************************************/
+static uint16_t readCodewords(const matrix_t *m, uint8_t mask, uint8_t *codewords, uint8_t count,
+                              uint16_t *extra)
+{
+    uint16_t bit = 0;
+    uint16_t darkRemainder = 0;
+    uint8_t upward = 1;
+
+    memset(codewords, 0, count);
+    for (int col = m->size - 1; col > 0; col -= 2, upward = !upward) {
+        if (col == 6) {
+            col--;
+        }
+        for (int k = 0; k < m->size; k++) {
+            int row = upward ? m->size - 1 - k : k;
+            for (int c = col; c >= col - 1; c--) {
+                if (isReserved(m, row, c)) {
+                    continue;
+                }
+                uint8_t value = m->dark[row][c] ^ maskRef(mask, row, c);
+                if (bit < count * 8) {
+                    codewords[bit / 8] |= value << (7 - bit % 8);
+                } else {
+                    darkRemainder += value;
+                }
+                bit++;
+            }
+        }
+    }
+    *extra = bit - count * 8;
+    return darkRemainder;
+}
+
+/*****************************************************************************
+** Function name:       checkData
+**
+** Description:         Checks the data codewords: byte mode, the count,
+**                      the text, the terminator and the pad bytes.
+**
+** Parameters:          version   - symbol version
+**                      data      - data codewords
+**                      count     - number of data codewords
+**                      text      - text that was encoded
+** Returned value:      None
+*****************************************************************************/
+static void checkData(uint8_t version, const uint8_t *data, uint8_t count, const char *text)
+{
+    uint8_t len = strlen(text);
+    uint8_t mode = data[0] >> 4;
+    uint8_t length = (uint8_t)(data[0] << 4) | (data[1] >> 4);
+    uint8_t textOk = 1;
+    uint8_t padOk = 1;
+
+    CHECK(mode == 0x4, "version %u: mode %x, not byte", version, mode);
+    CHECK(length == len, "version %u: count %u, text has %u bytes", version, length, len);
+    for (uint8_t i = 0; i < len; i++) {
+        textOk &= (uint8_t)((data[1 + i] << 4) | (data[2 + i] >> 4)) == (uint8_t)text[i];
+    }
+    CHECK(textOk, "version %u: text differs", version);
+    CHECK((data[1 + len] & 0x0F) == 0, "version %u: terminator not zero", version);
+    for (uint8_t i = 2 + len, pad = 0xEC; i < count; i++, pad = (pad == 0xEC) ? 0x11 : 0xEC) {
+        padOk &= data[i] == pad;
+    }
+    CHECK(padOk, "version %u: pad bytes wrong", version);
+}
+
+/*****************************************************************************
+** Function name:       syndrome
+**
+** Description:         Evaluates the codeword polynomial, first codeword
+**                      highest, at alpha^power. A valid block of the QR
+**                      code is zero at alpha^0 to alpha^(ecc - 1).
+**
+** Parameters:          codewords - data followed by error correction
+**                      count     - total codewords
+**                      power     - exponent of alpha = 2
+** Returned value:      The syndrome
+*****************************************************************************/
+static uint8_t syndrome(const uint8_t *codewords, uint8_t count, uint8_t power)
+{
+    uint8_t x = 1;
+    uint8_t sum = 0;
+
+    for (uint8_t i = 0; i < power; i++) {
+        x = gfMulRef(x, 2);
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        sum = gfMulRef(sum, x) ^ codewords[i];
+    }
+    return sum;
+}
+
+/*****************************************************************************
+** Function name:       penaltyRef
+**
+** Description:         Penalty score of the standard: N1 for runs of five
+**                      or more, N2 for 2x2 blocks, N3 for 1:1:3:1:1
+**                      patterns with four light modules on one side
+**                      inside the symbol, N4 for each full 5% of
+**                      imbalance.
+**
+** Parameters:          m - masked symbol with its format bits
+** Returned value:      Score
+*****************************************************************************/
+static uint32_t penaltyRef(const matrix_t *m)
+{
+    uint32_t score = 0;
+    uint16_t dark = 0;
+    int n = m->size;
+
+    for (uint8_t vertical = 0; vertical < 2; vertical++) {
+        for (int line = 0; line < n; line++) {
+            uint8_t at[QR_SIZE_MAX];
+            for (int i = 0; i < n; i++) {
+                at[i] = vertical ? m->dark[i][line] : m->dark[line][i];
+            }
+            for (int start = 0, end; start < n; start = end) {
+                for (end = start; (end < n) && (at[end] == at[start]); end++);
+                if (end - start >= 5) {
+                    score += 3 + (end - start - 5);
+                }
+            }
+            for (int start = 0; start + 11 <= n; start++) {
+                for (uint8_t p = 0; p < 2; p++) {
+                    score += (memcmp(&at[start], finderLike[p], 11) == 0) ? 40 : 0;
+                }
+            }
+        }
+    }
+
+    for (int row = 0; row < n; row++) {
+        for (int col = 0; col < n; col++) {
+            dark += m->dark[row][col];
+            if ((row + 1 < n) && (col + 1 < n) && (m->dark[row][col] == m->dark[row][col + 1]) &&
+                (m->dark[row][col] == m->dark[row + 1][col]) &&
+                (m->dark[row][col] == m->dark[row + 1][col + 1])) {
+                score += 3;
+            }
+        }
+    }
+    score += 10 * (abs(dark * 20 - n * n * 10) / (n * n));
+    return score;
+}
+
+/*****************************************************************************
+** Function name:       remask
+**
+** Description:         Builds the symbol the encoder would produce with
+**                      another mask: data modules re-masked, format bits
+**                      rewritten.
+**
+** Parameters:          from     - symbol as rendered
+**                      fromMask - its mask
+**                      mask     - mask to apply instead
+**                      to       - receives the symbol
+** Returned value:      None
+*****************************************************************************/
+static void remask(const matrix_t *from, uint8_t fromMask, uint8_t mask, matrix_t *to)
+{
+    int row;
+    int col;
+
+    *to = *from;
+    for (row = 0; row < to->size; row++) {
+        for (col = 0; col < to->size; col++) {
+            if (!isReserved(to, row, col)) {
+                to->dark[row][col] ^= maskRef(fromMask, row, col) ^ maskRef(mask, row, col);
+            }
+        }
+    }
+    for (uint8_t copy = 0; copy < 2; copy++) {
+        for (uint8_t bit = 0; bit < 15; bit++) {
+            formatModule(to->size, copy, bit, &row, &col);
+            to->dark[row][col] = (formatL[mask] >> bit) & 1;
+        }
+    }
+}
+
+/*****************************************************************************
+** Function name:       checkSample
+**
+** Description:         Encodes and renders one text and checks the
+**                      symbol on the panel.
+**
+** Parameters:          sample - text and expected version
+** Returned value:      None
+*****************************************************************************/
+static void checkSample(const sample_t *sample)
+{
+    uint8_t codewords[70];
+    qr_code_t code;
+    matrix_t panel;
+    matrix_t other;
+    uint8_t mask;
+    uint16_t extra;
+
+    uint8_t version = qr_encode(sample->text, &code);
+    CHECK(version == sample->version, "\"%s\": version %u, expected %u", sample->text, version,
+          sample->version);
+    if (version != sample->version) {
+        return;
+    }
+    qr_draw(&code, 0, 0, OLED_DISPLAY_HEIGHT, OLED_COLOR_BLACK, OLED_COLOR_WHITE);
+    display_flush();
+    readPanel(version, &panel);
+    checkQuietZone(panel.size);
+
+    uint16_t differ = 0;
+    for (uint8_t row = 0; row < panel.size; row++) {
+        for (uint8_t col = 0; col < panel.size; col++) {
+            differ += panel.dark[row][col] != qr_getModule(&code, col, row);
+        }
+    }
+    CHECK(differ == 0, "version %u: %u modules on the panel differ from the code", version, differ);
+
+    checkPatterns(&panel);
+
+    uint16_t format = readFormat(&panel, 0);
+    CHECK(readFormat(&panel, 1) == format, "version %u: format copies %04X and %04X differ",
+          version, format, readFormat(&panel, 1));
+    for (mask = 0; (mask < 8) && (formatL[mask] != format); mask++);
+    CHECK(mask < 8, "version %u: format %04X is not level L", version, format);
+    if (mask == 8) {
+        return;
+    }
+
+    uint8_t dataCount = refData[version - 1];
+    uint8_t total = dataCount + refEcc[version - 1];
+    uint16_t darkRemainder = readCodewords(&panel, mask, codewords, total, &extra);
+    CHECK(extra == refRemainder[version - 1], "version %u: %u remainder modules", version, extra);
+    CHECK(darkRemainder == 0, "version %u: %u remainder modules dark", version, darkRemainder);
+
+    checkData(version, codewords, dataCount, sample->text);
+    for (uint8_t power = 0; power < refEcc[version - 1]; power++) {
+        uint8_t s = syndrome(codewords, total, power);
+        CHECK(s == 0, "version %u: syndrome %u is %02X", version, power, s);
+    }
+
+    uint8_t best = 0;
+    uint32_t bestScore = 0xFFFFFFFFUL;
+    for (uint8_t m = 0; m < 8; m++) {
+        remask(&panel, mask, m, &other);
+        uint32_t score = penaltyRef(&other);
+        if (score < bestScore) {
+            bestScore = score;
+            best = m;
+        }
+    }
+    printf("version %u: mask %u, penalty %lu\n", version, mask, (unsigned long)bestScore);
+    CHECK(mask == best, "version %u: mask %u used, %u scores lower", version, mask, best);
+}
+
+int main(void)
+{
+    char text[QR_TEXT_MAX + 2];
+    qr_code_t code;
+
+    hosttest_boot();
+
+    for (uint8_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        checkSample(&samples[i]);
+    }
+
+    /* Capacity limits: 17, 32 and 53 bytes */
+    memset(text, 'x', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    CHECK(qr_encode(&text[QR_TEXT_MAX + 1 - 17], &code) == 1, "17 bytes not in version 1");
+    CHECK(qr_encode(&text[QR_TEXT_MAX + 1 - 18], &code) == 2, "18 bytes not in version 2");
+    CHECK(qr_encode(&text[QR_TEXT_MAX + 1 - 33], &code) == 3, "33 bytes not in version 3");
+    CHECK(qr_encode(&text[1], &code) == 3, "%u bytes not in version 3", QR_TEXT_MAX);
+    CHECK(qr_encode(text, &code) == 0, "%u bytes encoded", QR_TEXT_MAX + 1);
+
+    return hosttest_done("qr_test");
+}
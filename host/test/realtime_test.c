@@ -0,0 +1,156 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test of the simulated clock against real time: the
+ *                same scripted session is played once on the virtual
+ *                clock and once with REFLEX_REALTIME=0. Both runs must
+ *                show every stimulus at the same board time and measure
+ *                the same reaction times, to the millisecond.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "joystick.h"
+
+#include "clock.h"
+#include "input.h"
+
+#include "hosttest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SESSION_ROUNDS      5
+
+#define NEVER               0xFFFFFFFFUL
+
+/* Scripted player: a reaction time per round, then a click to go on */
+#define CLICK_AFTER_MS      2000    // after a result, past a record tune and the hold
+#define PRESS_MS            100
+
+static const uint32_t reactionMs[SESSION_ROUNDS] = { 231, 198, 305, 247, 276 };
+
+typedef struct {
+    uint8_t stimuli;
+    uint8_t results;
+    uint32_t onsetMs[SESSION_ROUNDS];       /* board time of each stimulus */
+    uint32_t measuredMs[SESSION_ROUNDS];    /* reaction time the board measured */
+} session_report_t;
+
+static session_report_t report;
+static uint32_t stimulusMs = NEVER;
+static uint32_t clickAtMs = NEVER;
+
+/*****************************************************************************
+** Function name:       readKeys
+**
+** Description:         Script: holds center from the round's reaction time
+**                      after each stimulus until the board measured it,
+**                      and clicks after each result; after the session a
+**                      click every CLICK_AFTER_MS leaves the end screens.
+**
+** Parameters:          nowMs - board time
+** Returned value:      JOYSTICK_* bits held
+*****************************************************************************/
+static uint8_t readKeys(uint32_t nowMs)
+{
+    if ((stimulusMs != NEVER) && (nowMs >= stimulusMs + reactionMs[report.results])) {
+        return JOYSTICK_CENTER;
+    }
+    if ((clickAtMs != NEVER) && (nowMs >= clickAtMs + PRESS_MS) &&
+        (report.results == SESSION_ROUNDS)) {
+        clickAtMs += CLICK_AFTER_MS;
+    }
+    if ((clickAtMs != NEVER) && (nowMs >= clickAtMs) && (nowMs < clickAtMs + PRESS_MS)) {
+        return JOYSTICK_CENTER;
+    }
+    return 0;
+}
+
+/*****************************************************************************
+** Function name:       onStimulus
+**
+** Description:         Script: a stimulus appeared.
+**
+** Parameters:          nowMs - board time
+** Returned value:      None
+*****************************************************************************/
+static void onStimulus(uint32_t nowMs)
+{
+    if (report.stimuli < SESSION_ROUNDS) {
+        report.onsetMs[report.stimuli] = nowMs;
+    }
+    report.stimuli++;
+    stimulusMs = nowMs;
+}
+
+/*****************************************************************************
+** Function name:       onResult
+**
+** Description:         Script: the board measured the click; the next
+**                      click is due after the result hold.
+**
+** Parameters:          ms - measured reaction time
+** Returned value:      None
+*****************************************************************************/
+static void onResult(uint32_t ms)
+{
+    if (report.results < SESSION_ROUNDS) {
+        report.measuredMs[report.results] = ms;
+    }
+    report.results++;
+    stimulusMs = NEVER;
+    clickAtMs = clock_nowMs() + CLICK_AFTER_MS;
+}
+
+/*****************************************************************************
+** Function name:       playSession
+**
+** Description:         Boots the board and plays one scripted session.
+**
+** Parameters:          to - receives what the board showed and measured
+** Returned value:      None
+*****************************************************************************/
+static void playSession(session_report_t *to)
+{
+    static const input_source_t script = { readKeys, onStimulus, onResult };
+
+    memset(&report, 0, sizeof(report));
+    stimulusMs = NEVER;
+    clickAtMs = NEVER;
+
+    hosttest_boot();
+    input_setSource(&script);
+    start_game();
+    *to = report;
+}
+
+int main(void)
+{
+    session_report_t virtual, realtime;
+
+    playSession(&virtual);
+    setenv("REFLEX_REALTIME", "0", 1);
+    playSession(&realtime);
+    unsetenv("REFLEX_REALTIME");
+
+    CHECK((virtual.results == SESSION_ROUNDS) && (realtime.results == SESSION_ROUNDS),
+          "rounds played: virtual %u, real time %u", virtual.results, realtime.results);
+
+    for (uint8_t round = 0; round < SESSION_ROUNDS; round++) {
+        printf("round %u: stimulus at %lu / %lu ms, measured %lu / %lu ms\n", round,
+               (unsigned long)virtual.onsetMs[round], (unsigned long)realtime.onsetMs[round],
+               (unsigned long)virtual.measuredMs[round], (unsigned long)realtime.measuredMs[round]);
+        CHECK(virtual.measuredMs[round] == reactionMs[round],
+              "round %u: virtual run measured %lu ms, pressed after %lu ms", round,
+              (unsigned long)virtual.measuredMs[round], (unsigned long)reactionMs[round]);
+        CHECK(realtime.measuredMs[round] == virtual.measuredMs[round],
+              "round %u: real time measured %lu ms, virtual %lu ms", round,
+              (unsigned long)realtime.measuredMs[round], (unsigned long)virtual.measuredMs[round]);
+        CHECK(realtime.onsetMs[round] == virtual.onsetMs[round],
+              "round %u: real time stimulus at %lu ms, virtual at %lu ms", round,
+              (unsigned long)realtime.onsetMs[round], (unsigned long)virtual.onsetMs[round]);
+    }
+
+    return hosttest_done("realtime_test");
+}
@@ -0,0 +1,369 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host benchmark of text rendering: draw_menu() and the
+ *                result, summary and stats screens of real games, with
+ *                the page-major blitter in display.c and with the former
+ *                per-pixel renderer (row-major font, one display_putPixel()
+ *                per cell pixel), which is kept here as the reference.
+ *
+ *                Calls of display_putString() from the game are routed
+ *                here with -Wl,--wrap. Each renderer runs in its own
+ *                process from a fresh boot; every flushed panel is hashed
+ *                and both renderers must produce the same sequence.
+ *
+ *                Host times only compare the two paths; cycle counts on
+ *                the board come from PERF_CYCLES() around the same calls.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "oled.h"
+
+#include "board.h"
+#include "display.h"
+#include "simplayer.h"
+
+#include "hosttest.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MENU_DRAWS          5000
+#define GAMES               20
+
+/* Former 5x7 font, ASCII 0x20-0x7F, one byte per row, MSB leftmost */
+static const uint8_t oldFont[] = {
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,  /*   */
+    0x80,0x80,0x80,0x80,0x80,0x00,0x80,0x00,  /* ! */
+    0xa0,0xa0,0xa0,0x00,0x00,0x00,0x00,0x00,  /* " */
+    0x50,0x50,0xf8,0x50,0xf8,0x50,0x50,0x00,  /* # */
+    0x20,0x78,0xa0,0x70,0x28,0xf0,0x20,0x00,  /* $ */
+    0xc0,0xc8,0x10,0x20,0x40,0x98,0x18,0x00,  /* % */
+    0x60,0x90,0xa0,0x40,0xa8,0x90,0x68,0x00,  /* & */
+    0xc0,0x40,0x80,0x00,0x00,0x00,0x00,0x00,  /* ' */
+    0x20,0x40,0x80,0x80,0x80,0x40,0x20,0x00,  /* ( */
+    0x80,0x40,0x20,0x20,0x20,0x40,0x80,0x00,  /* ) */
+    0x00,0x50,0x20,0xf8,0x20,0x50,0x00,0x00,  /* * */
+    0x00,0x20,0x20,0xf8,0x20,0x20,0x00,0x00,  /* + */
+    0x00,0x00,0x00,0x00,0x00,0xc0,0x40,0x80,  /* , */
+    0x00,0x00,0x00,0xf8,0x00,0x00,0x00,0x00,  /* - */
+    0x00,0x00,0x00,0x00,0x00,0xc0,0xc0,0x00,  /* . */
+    0x00,0x08,0x10,0x20,0x40,0x80,0x00,0x00,  /* / */
+    0x70,0x88,0x98,0xa8,0xc8,0x88,0x70,0x00,  /* 0 */
+    0x20,0x60,0x20,0x20,0x20,0x20,0x70,0x00,  /* 1 */
+    0x70,0x88,0x08,0x30,0x40,0x80,0xf8,0x00,  /* 2 */
+    0x70,0x88,0x08,0x30,0x08,0x88,0x70,0x00,  /* 3 */
+    0x10,0x30,0x50,0x90,0xf8,0x10,0x10,0x00,  /* 4 */
+    0xf8,0x80,0xf0,0x08,0x08,0x88,0x70,0x00,  /* 5 */
+    0x30,0x40,0x80,0xf0,0x88,0x88,0x70,0x00,  /* 6 */
+    0xf8,0x08,0x10,0x20,0x40,0x40,0x40,0x00,  /* 7 */
+    0x70,0x88,0x88,0x70,0x88,0x88,0x70,0x00,  /* 8 */
+    0x70,0x88,0x88,0x78,0x08,0x10,0x60,0x00,  /* 9 */
+    0x00,0xc0,0xc0,0x00,0xc0,0xc0,0x00,0x00,  /* : */
+    0x00,0x00,0xc0,0xc0,0x00,0xc0,0x40,0x80,  /* ; */
+    0x10,0x20,0x40,0x80,0x40,0x20,0x10,0x00,  /* < */
+    0x00,0x00,0xf8,0x00,0xf8,0x00,0x00,0x00,  /* = */
+    0x80,0x40,0x20,0x10,0x20,0x40,0x80,0x00,  /* > */
+    0x70,0x88,0x08,0x10,0x20,0x00,0x20,0x00,  /* ? */
+    0x70,0x88,0x08,0x68,0xa8,0xa8,0x70,0x00,  /* @ */
+    0x70,0x88,0x88,0xf8,0x88,0x88,0x88,0x00,  /* A */
+    0xf0,0x88,0x88,0xf0,0x88,0x88,0xf0,0x00,  /* B */
+    0x70,0x88,0x80,0x80,0x80,0x88,0x70,0x00,  /* C */
+    0xe0,0x90,0x88,0x88,0x88,0x90,0xe0,0x00,  /* D */
+    0xf8,0x80,0x80,0xf0,0x80,0x80,0xf8,0x00,  /* E */
+    0xf8,0x80,0x80,0xf0,0x80,0x80,0x80,0x00,  /* F */
+    0x70,0x88,0x80,0x80,0x98,0x88,0x78,0x00,  /* G */
+    0x88,0x88,0x88,0xf8,0x88,0x88,0x88,0x00,  /* H */
+    0xe0,0x40,0x40,0x40,0x40,0x40,0xe0,0x00,  /* I */
+    0x38,0x10,0x10,0x10,0x10,0x90,0x60,0x00,  /* J */
+    0x88,0x90,0xa0,0xc0,0xa0,0x90,0x88,0x00,  /* K */
+    0x80,0x80,0x80,0x80,0x80,0x80,0xf8,0x00,  /* L */
+    0x88,0xd8,0xa8,0xa8,0x88,0x88,0x88,0x00,  /* M */
+    0x88,0x88,0xc8,0xa8,0x98,0x88,0x88,0x00,  /* N */
+    0x70,0x88,0x88,0x88,0x88,0x88,0x70,0x00,  /* O */
+    0xf0,0x88,0x88,0xf0,0x80,0x80,0x80,0x00,  /* P */
+    0x70,0x88,0x88,0x88,0xa8,0x90,0x68,0x00,  /* Q */
+    0xf0,0x88,0x88,0xf0,0xa0,0x90,0x88,0x00,  /* R */
+    0x70,0x88,0x80,0x70,0x08,0x88,0x70,0x00,  /* S */
+    0xf8,0x20,0x20,0x20,0x20,0x20,0x20,0x00,  /* T */
+    0x88,0x88,0x88,0x88,0x88,0x88,0x70,0x00,  /* U */
+    0x88,0x88,0x88,0x88,0x88,0x50,0x20,0x00,  /* V */
+    0x88,0x88,0x88,0xa8,0xa8,0xa8,0x50,0x00,  /* W */
+    0x88,0x88,0x50,0x20,0x50,0x88,0x88,0x00,  /* X */
+    0x88,0x88,0x50,0x20,0x20,0x20,0x20,0x00,  /* Y */
+    0xf8,0x08,0x10,0x20,0x40,0x80,0xf8,0x00,  /* Z */
+    0xe0,0x80,0x80,0x80,0x80,0x80,0xe0,0x00,  /* [ */
+    0x00,0x80,0x40,0x20,0x10,0x08,0x00,0x00,  /* \\ */
+    0xe0,0x20,0x20,0x20,0x20,0x20,0xe0,0x00,  /* ] */
+    0x20,0x50,0x88,0x00,0x00,0x00,0x00,0x00,  /* ^ */
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xf8,  /* _ */
+    0x80,0x40,0x20,0x00,0x00,0x00,0x00,0x00,  /* ` */
+    0x00,0x00,0x70,0x08,0x78,0x88,0x78,0x00,  /* a */
+    0x80,0x80,0xb0,0xc8,0x88,0x88,0xf0,0x00,  /* b */
+    0x00,0x00,0x60,0x90,0x80,0x90,0x60,0x00,  /* c */
+    0x08,0x08,0x68,0x98,0x88,0x88,0x78,0x00,  /* d */
+    0x00,0x00,0x70,0x88,0xf8,0x80,0x70,0x00,  /* e */
+    0x20,0x50,0x40,0xe0,0x40,0x40,0x40,0x00,  /* f */
+    0x00,0x00,0x78,0x88,0x88,0x78,0x08,0x70,  /* g */
+    0x80,0x80,0xb0,0xc8,0x88,0x88,0x88,0x00,  /* h */
+    0x40,0x00,0x40,0x40,0x40,0x40,0x40,0x00,  /* i */
+    0x20,0x00,0x60,0x20,0x20,0x20,0x20,0xc0,  /* j */
+    0x80,0x80,0x90,0xa0,0xc0,0xa0,0x90,0x00,  /* k */
+    0xc0,0x40,0x40,0x40,0x40,0x40,0xe0,0x00,  /* l */
+    0x00,0x00,0xd0,0xa8,0xa8,0x88,0x88,0x00,  /* m */
+    0x00,0x00,0xb0,0xd0,0x90,0x90,0x90,0x00,  /* n */
+    0x00,0x00,0x60,0x90,0x90,0x90,0x60,0x00,  /* o */
+    0x00,0x00,0xe0,0x90,0x90,0xe0,0x80,0x80,  /* p */
+    0x00,0x00,0x70,0x90,0x90,0x70,0x10,0x10,  /* q */
+    0x00,0x00,0x50,0x60,0x40,0x40,0x40,0x00,  /* r */
+    0x00,0x00,0x70,0x80,0x60,0x10,0xe0,0x00,  /* s */
+    0x40,0x40,0xe0,0x40,0x40,0x40,0x60,0x00,  /* t */
+    0x00,0x00,0x90,0x90,0x90,0x90,0x70,0x00,  /* u */
+    0x00,0x00,0x88,0x88,0x88,0x50,0x20,0x00,  /* v */
+    0x00,0x00,0x88,0x88,0xa8,0xa8,0x50,0x00,  /* w */
+    0x00,0x00,0x88,0x50,0x20,0x50,0x88,0x00,  /* x */
+    0x00,0x00,0x90,0x90,0x90,0x70,0x10,0x60,  /* y */
+    0x00,0x00,0xf8,0x10,0x20,0x40,0xf8,0x00,  /* z */
+    0x20,0x40,0x40,0x80,0x40,0x40,0x20,0x00,  /* { */
+    0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,  /* | */
+    0x80,0x40,0x40,0x20,0x40,0x40,0x80,0x00,  /* } */
+    0x68,0x90,0x00,0x00,0x00,0x00,0x00,0x00,  /* ~ */
+    0xf8,0xf8,0xf8,0xf8,0xf8,0xf8,0xf8,0x00,  /* \x7f */
+};
+
+#define OLD_CELL_WIDTH      6
+#define OLD_CELL_HEIGHT     8
+
+typedef struct {
+    uint64_t menuNs;        /* all draw_menu() calls */
+    uint64_t menuTextNs;    /* text part of them */
+    uint64_t gameTextNs;    /* text of the game screens */
+    uint32_t gameTextCalls;
+    uint32_t flushes;
+    uint32_t panelHash;     /* FNV-1a over every flushed panel */
+} bench_result_t;
+
+void __real_display_putString(uint8_t x, uint8_t y, const char *str, oled_color_t fg,
+                              oled_color_t bg);
+void __real_display_flush(void);
+
+static uint8_t useOldRenderer;
+static uint64_t *textNs;
+static uint32_t *textCalls;
+static bench_result_t result;
+
+/*****************************************************************************
+** Function name:       nowNs
+**
+** Description:         Host monotonic time.
+**
+** Parameters:          None
+** Returned value:      Nanoseconds since an arbitrary start
+*****************************************************************************/
+static uint64_t nowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*****************************************************************************
+** Function name:       oldPutChar
+**
+** Description:         The former display_putChar(): 48 display_putPixel()
+**                      calls per cell.
+**
+** Parameters:          x, y - top left corner of the cell
+**                      ch   - ASCII character, unknown ones draw as blank
+**                      fg   - text color
+**                      bg   - background color
+** Returned value:      0 if the cell does not fit on the display, else 1
+*****************************************************************************/
+static uint8_t oldPutChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fg, oled_color_t bg)
+{
+    if ((x >= (OLED_DISPLAY_WIDTH - 8)) || (y >= (OLED_DISPLAY_HEIGHT - 8))) {
+        return 0;
+    }
+
+    if ((ch < 0x20) || (ch > 0x7F)) {
+        ch = 0x20;
+    }
+
+    const uint8_t *glyph = &oldFont[(ch - 0x20) * OLD_CELL_HEIGHT];
+    for (uint8_t row = 0; row < OLD_CELL_HEIGHT; row++) {
+        uint8_t bits = glyph[row];
+        for (uint8_t col = 0; col < OLD_CELL_WIDTH; col++) {
+            display_putPixel(x + col, y + row, (bits & (0x80 >> col)) ? fg : bg);
+        }
+    }
+    return 1;
+}
+
+/*****************************************************************************
+** Function name:       __wrap_display_putString
+**
+** Description:         display_putString() as the game sees it: the
+**                      selected renderer, timed.
+**
+** Parameters:          x, y - top left corner of the first cell
+**                      str  - null-terminated string
+**                      fg   - text color
+**                      bg   - background color
+** Returned value:      None
+*****************************************************************************/
+void __wrap_display_putString(uint8_t x, uint8_t y, const char *str, oled_color_t fg,
+                              oled_color_t bg)
+{
+    uint64_t start = nowNs();
+
+    if (useOldRenderer) {
+        while (*str != '\0') {
+            if (oldPutChar(x, y, (uint8_t)*str++, fg, bg) == 0) {
+                break;
+            }
+            x += OLD_CELL_WIDTH;
+        }
+    } else {
+        __real_display_putString(x, y, str, fg, bg);
+    }
+
+    *textNs += nowNs() - start;
+    (*textCalls)++;
+}
+
+/*****************************************************************************
+** Function name:       __wrap_display_flush
+**
+** Description:         display_flush() as the game sees it: flushes, then
+**                      folds what the panel shows into the hash.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void __wrap_display_flush(void)
+{
+    __real_display_flush();
+
+    for (uint8_t y = 0; y < OLED_DISPLAY_HEIGHT; y++) {
+        for (uint8_t x = 0; x < OLED_DISPLAY_WIDTH; x++) {
+            result.panelHash = (result.panelHash ^ board_panelPixel(x, y)) * 16777619u;
+        }
+    }
+    result.flushes++;
+}
+
+/*****************************************************************************
+** Function name:       runRenderer
+**
+** Description:         Benchmarks one renderer from a fresh boot.
+**
+** Parameters:          old - nonzero for the former per-pixel renderer
+** Returned value:      None, fills in result
+*****************************************************************************/
+static void runRenderer(uint8_t old)
+{
+    static const simplayer_config_t player = {
+        250, 30, 80, 0, 0, 0, 400, 0x5EED
+    };
+    simplayer_report_t report;
+    uint32_t menuCalls = 0;
+
+    memset(&result, 0, sizeof(result));
+    result.panelHash = 2166136261u;
+    useOldRenderer = old;
+
+    hosttest_boot();
+    init_menu();
+    textNs = &result.menuTextNs;
+    textCalls = &menuCalls;
+    uint64_t start = nowNs();
+    for (uint32_t i = 0; i < MENU_DRAWS; i++) {
+        draw_menu();
+    }
+    result.menuNs = nowNs() - start;
+
+    textNs = &result.gameTextNs;
+    textCalls = &result.gameTextCalls;
+    simplayer_runLoadTest(&player, GAMES, start_game, &report);
+}
+
+/*****************************************************************************
+** Function name:       runInChild
+**
+** Description:         Runs runRenderer() in a child process, so both
+**                      renderers start from the same state.
+**
+** Parameters:          old - nonzero for the former per-pixel renderer
+**                      out - receives the child's result
+** Returned value:      1 on success, 0 if the child failed
+*****************************************************************************/
+static uint8_t runInChild(uint8_t old, bench_result_t *out)
+{
+    int fds[2];
+    int status;
+    pid_t pid;
+
+    if (pipe(fds) != 0) {
+        return 0;
+    }
+    pid = fork();
+    if (pid < 0) {
+        return 0;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        runRenderer(old);
+        _exit(write(fds[1], &result, sizeof(result)) == (ssize_t)sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], out, sizeof(*out));
+    close(fds[0]);
+    waitpid(pid, &status, 0);
+    return (got == (ssize_t)sizeof(*out)) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+/*****************************************************************************
+** Function name:       printResult
+**
+** Description:         Prints the timings of one renderer.
+**
+** Parameters:          name - renderer name
+**                      r    - its result
+** Returned value:      None
+*****************************************************************************/
+static void printResult(const char *name, const bench_result_t *r)
+{
+    printf("%-10s draw_menu %7.2f us (text %7.2f us), game screens %7.1f ns per string\n",
+           name, r->menuNs / 1000.0 / MENU_DRAWS, r->menuTextNs / 1000.0 / MENU_DRAWS,
+           (r->gameTextCalls > 0) ? (double)r->gameTextNs / r->gameTextCalls : 0.0);
+}
+
+int main(void)
+{
+    bench_result_t oldResult;
+    bench_result_t newResult;
+
+    if (!runInChild(1, &oldResult) || !runInChild(0, &newResult)) {
+        CHECK(0, "benchmark run failed");
+        return hosttest_done("render_bench");
+    }
+
+    printf("%u draw_menu() calls, %u games, %lu strings in games, %lu flushes\n",
+           MENU_DRAWS, GAMES, (unsigned long)newResult.gameTextCalls,
+           (unsigned long)newResult.flushes);
+    printResult("per-pixel", &oldResult);
+    printResult("page-major", &newResult);
+    printf("text speedup: menu %.1fx, game screens %.1fx\n",
+           (double)oldResult.menuTextNs / newResult.menuTextNs,
+           (double)oldResult.gameTextNs / newResult.gameTextNs);
+
+    CHECK(oldResult.flushes == newResult.flushes, "flush counts differ: %lu vs %lu",
+          (unsigned long)oldResult.flushes, (unsigned long)newResult.flushes);
+    CHECK(oldResult.panelHash == newResult.panelHash, "renderers drew different panels");
+    return hosttest_done("render_bench");
+}
@@ -0,0 +1,69 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test: plays whole sessions of the real start_game()
+ *                against the synthetic player and checks every reaction
+ *                time the game records against the player's true one.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "exgauss.h"
+#include "lifetime.h"
+#include "simplayer.h"
+#include "stats.h"
+
+#include "hosttest.h"
+
+#define SESSION_ROUNDS  5
+#define GAMES           200
+
+int main(void)
+{
+    static const simplayer_config_t player = {
+        260, 35, 90, 0, 0, 0, 400, 0xC0FFEE
+    };
+    static const simplayer_config_t sloppy = {
+        260, 35, 90, 50, 50, 2000, 400, 0xBADC0DE
+    };
+    simplayer_report_t report;
+    exgauss_params_t fit;
+
+    hosttest_boot();
+
+    // Clean responses: every measurement equals the true response time
+    simplayer_runLoadTest(&player, GAMES, start_game, &report);
+    simplayer_printReport(&report);
+    CHECK(report.games == GAMES, "%lu games played", (unsigned long)report.games);
+    CHECK(report.rounds == GAMES * SESSION_ROUNDS, "%lu rounds measured",
+          (unsigned long)report.rounds);
+    CHECK(report.driftMin == 0 && report.driftMax == 0,
+          "measured minus true: min %ld, max %ld ms", (long)report.driftMin,
+          (long)report.driftMax);
+
+    // What the game stored is what the player did
+    CHECK(stats_getResultCount() == report.rounds, "stats hold %u results",
+          stats_getResultCount());
+    CHECK(stats_getSessionCount() == GAMES, "stats hold %u sessions", stats_getSessionCount());
+    CHECK(lifetime_getCount() == report.rounds, "lifetime histogram holds %lu results",
+          (unsigned long)lifetime_getCount());
+    CHECK(exgauss_getCount(0) == report.rounds, "player 1 has %u results", exgauss_getCount(0));
+    CHECK(exgauss_estimate(0, &fit) && (fit.mu > 240) && (fit.mu < 280) && (fit.sigma > 15) &&
+              (fit.sigma < 55) && (fit.tau > 70) && (fit.tau < 110),
+          "fit of the recorded times %u/%u/%u, player 260/35/90", fit.mu, fit.sigma, fit.tau);
+    CHECK(report.eepromWrites <= 2 * GAMES, "%lu EEPROM page writes for %u games",
+          (unsigned long)report.eepromWrites, GAMES);
+
+    // False starts and misses still run full sessions; misses are timed
+    simplayer_runLoadTest(&sloppy, GAMES, start_game, &report);
+    simplayer_printReport(&report);
+    CHECK(report.rounds == GAMES * SESSION_ROUNDS, "%lu rounds measured",
+          (unsigned long)report.rounds);
+    CHECK(report.falseStarts > 0 && report.misses > 0, "%lu false starts, %lu misses",
+          (unsigned long)report.falseStarts, (unsigned long)report.misses);
+    CHECK(report.driftMin == 0 && report.driftMax == 0,
+          "measured minus true: min %ld, max %ld ms", (long)report.driftMin,
+          (long)report.driftMax);
+
+    return hosttest_done("simplayer_test");
+}
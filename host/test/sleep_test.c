@@ -0,0 +1,262 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test of the inactivity sleep: the player leaves the
+ *                first result of a session on hold until the panel goes
+ *                off, then wakes it. The panel must come back with the
+ *                result, not with the next round composed in the shadow,
+ *                and the waking press must not start that round. A second
+ *                session leaves a stimulus unanswered for longer than the
+ *                timeout: the panel must stay on and the late press must
+ *                be the response.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "joystick.h"
+#include "oled.h"
+
+#include "board.h"
+#include "clock.h"
+#include "input.h"
+#include "sleep.h"
+
+#include "hosttest.h"
+
+#include <string.h>
+
+#define SESSION_ROUNDS      5
+
+#define NEVER               0xFFFFFFFFUL
+
+/* Scripted player */
+#define REACTION_MS         300
+#define CLICK_AFTER_MS      1000    // after a result, past the 600 ms hold
+#define PRESS_MS            100
+#define WAKE_AFTER_MS       5000    // after the panel went off
+#define LATE_MS             (SLEEP_TIMEOUT_MS + 10000)
+
+/* A sleeping board checks input once per simulated millisecond */
+#define WAKE_CHECK_US       1000
+
+typedef uint8_t panel_t[OLED_DISPLAY_HEIGHT][OLED_DISPLAY_WIDTH];
+
+static uint32_t stimulusMs = NEVER;
+static uint32_t clickAtMs = NEVER;
+static uint32_t wakeAtMs = NEVER;
+static uint8_t results;
+static uint8_t resultSeen;
+static uint8_t slept;
+static uint8_t woke;
+static uint32_t wakeClickMs = NEVER;         // first click after the wake
+static uint32_t nextStimulusMs = NEVER;      // first stimulus after the wake
+static uint32_t firstResultMs;
+static uint8_t darkDuringStimulus;
+
+static panel_t resultPanel;     // the first result, as the panel showed it
+static panel_t sleepPanel;      // panel contents when it went off
+static panel_t wakePanel;       // panel contents once it was back on
+
+/*****************************************************************************
+** Function name:       copyPanel
+**
+** Description:         Copies what the panel shows, or would show if it
+**                      is off: the controller RAM.
+**
+** Parameters:          to - receives the pixels
+** Returned value:      None
+*****************************************************************************/
+static void copyPanel(panel_t to)
+{
+    for (uint8_t y = 0; y < OLED_DISPLAY_HEIGHT; y++) {
+        for (uint8_t x = 0; x < OLED_DISPLAY_WIDTH; x++) {
+            to[y][x] = board_panelPixel(x, y);
+        }
+    }
+}
+
+/*****************************************************************************
+** Function name:       watchPanel
+**
+** Description:         Records the panel at the first result, when it
+**                      goes off and when it is back on.
+**
+** Parameters:          nowMs - simulated time
+** Returned value:      None
+*****************************************************************************/
+static void watchPanel(uint32_t nowMs)
+{
+    if ((results == 1) && !resultSeen) {
+        copyPanel(resultPanel);
+        resultSeen = 1;
+    }
+    if (!slept && !board_panelIsOn()) {
+        copyPanel(sleepPanel);
+        slept = 1;
+        wakeAtMs = nowMs + WAKE_AFTER_MS;
+    }
+    if (slept && !woke && board_panelIsOn()) {
+        copyPanel(wakePanel);
+        woke = 1;
+        clickAtMs = nowMs + CLICK_AFTER_MS;
+        wakeClickMs = clickAtMs;
+    }
+}
+
+/*****************************************************************************
+** Function name:       clickKeys
+**
+** Description:         Script: the scheduled click, and after the session
+**                      a click every CLICK_AFTER_MS to leave the end
+**                      screens.
+**
+** Parameters:          nowMs - simulated time
+** Returned value:      JOYSTICK_* bits held
+*****************************************************************************/
+static uint8_t clickKeys(uint32_t nowMs)
+{
+    if ((clickAtMs != NEVER) && (nowMs >= clickAtMs + PRESS_MS) && (results == SESSION_ROUNDS)) {
+        clickAtMs += CLICK_AFTER_MS;
+    }
+    if ((clickAtMs != NEVER) && (nowMs >= clickAtMs) && (nowMs < clickAtMs + PRESS_MS)) {
+        return JOYSTICK_CENTER;
+    }
+    return 0;
+}
+
+/*****************************************************************************
+** Function name:       readKeys
+**
+** Description:         Script: answers each stimulus, clicks to go on after
+**                      each result except the first, which is left until
+**                      the board sleeps and is woken.
+**
+** Parameters:          nowMs - simulated time
+** Returned value:      JOYSTICK_* bits held
+*****************************************************************************/
+static uint8_t readKeys(uint32_t nowMs)
+{
+    watchPanel(nowMs);
+
+    if ((stimulusMs != NEVER) && (nowMs >= stimulusMs + REACTION_MS)) {
+        return JOYSTICK_CENTER;
+    }
+    if ((wakeAtMs != NEVER) && (nowMs >= wakeAtMs) && (nowMs < wakeAtMs + PRESS_MS)) {
+        return JOYSTICK_CENTER;
+    }
+    return clickKeys(nowMs);
+}
+
+/*****************************************************************************
+** Function name:       readLate
+**
+** Description:         Script: answers the first stimulus only after
+**                      LATE_MS, the others promptly, and clicks on after
+**                      each result.
+**
+** Parameters:          nowMs - simulated time
+** Returned value:      JOYSTICK_* bits held
+*****************************************************************************/
+static uint8_t readLate(uint32_t nowMs)
+{
+    uint32_t reactionMs = (results == 0) ? LATE_MS : REACTION_MS;
+
+    if (stimulusMs != NEVER) {
+        darkDuringStimulus |= !board_panelIsOn();
+        if (nowMs >= stimulusMs + reactionMs) {
+            return JOYSTICK_CENTER;
+        }
+    }
+    return clickKeys(nowMs);
+}
+
+/*****************************************************************************
+** Function name:       onStimulus
+**
+** Description:         Script: a stimulus appeared.
+**
+** Parameters:          nowMs - simulated time
+** Returned value:      None
+*****************************************************************************/
+static void onStimulus(uint32_t nowMs)
+{
+    stimulusMs = nowMs;
+    if (woke && (nextStimulusMs == NEVER)) {
+        nextStimulusMs = nowMs;
+    }
+}
+
+/*****************************************************************************
+** Function name:       onResult
+**
+** Description:         Script: a reaction time was measured; the next
+**                      click is due after the result hold.
+**
+** Parameters:          ms - measured time, unused
+** Returned value:      None
+*****************************************************************************/
+static void onResult(uint32_t ms)
+{
+    (void)ms;
+    stimulusMs = NEVER;
+    results++;
+    clickAtMs = (results == 1) ? NEVER : clock_nowMs() + CLICK_AFTER_MS;
+}
+
+/*****************************************************************************
+** Function name:       onLateResult
+**
+** Description:         Script: a reaction time was measured; the first
+**                      is kept, and the next click is due after the
+**                      result hold.
+**
+** Parameters:          ms - measured time
+** Returned value:      None
+*****************************************************************************/
+static void onLateResult(uint32_t ms)
+{
+    if (results == 0) {
+        firstResultMs = ms;
+    }
+    stimulusMs = NEVER;
+    results++;
+    clickAtMs = clock_nowMs() + CLICK_AFTER_MS;
+}
+
+int main(void)
+{
+    static const input_source_t script = { readKeys, onStimulus, onResult };
+    static const input_source_t late = { readLate, onStimulus, onLateResult };
+
+    hosttest_boot();
+    input_setSource(&script);
+    start_game();
+
+    CHECK(results == SESSION_ROUNDS, "%u rounds played", results);
+    CHECK(slept && woke, "panel did not sleep and wake (slept %u, woke %u)", slept, woke);
+    CHECK(board_panelIsOn(), "panel off after the session");
+    CHECK(memcmp(sleepPanel, resultPanel, sizeof(panel_t)) == 0,
+          "panel did not show the result when it went off");
+    CHECK(memcmp(wakePanel, sleepPanel, sizeof(panel_t)) == 0,
+          "panel changed over the sleep");
+    CHECK((nextStimulusMs != NEVER) && (nextStimulusMs > wakeClickMs),
+          "round 2 stimulus at %lu ms, before the click at %lu ms: the waking press went on",
+          (unsigned long)nextStimulusMs, (unsigned long)wakeClickMs);
+    printf("woke in %lu us\n", (unsigned long)sleep_getWakeUs());
+    CHECK(sleep_getWakeUs() >= WAKE_CHECK_US,
+          "woke in %lu us, less than the %lu us between input checks",
+          (unsigned long)sleep_getWakeUs(), (unsigned long)WAKE_CHECK_US);
+
+    // A trial never sleeps: the late press is the response
+    results = 0;
+    clickAtMs = NEVER;
+    input_setSource(&late);
+    start_game();
+
+    CHECK(results == SESSION_ROUNDS, "%u rounds played", results);
+    CHECK(!darkDuringStimulus, "panel went off with a stimulus shown");
+    CHECK(firstResultMs == LATE_MS, "late response measured as %lu ms, pressed after %lu ms",
+          (unsigned long)firstResultMs, (unsigned long)LATE_MS);
+
+    return hosttest_done("sleep_test");
+}
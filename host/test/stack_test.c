@@ -0,0 +1,100 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Host test of budgeted stack runs: usage within budget,
+ *                a guard hit, and a run whose function never returns.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "stack.h"
+
+#include "hosttest.h"
+
+#include <pthread.h>
+
+#define BUDGET          (64 * 1024)
+#define SMALL_FRAME     1000
+#define LARGE_FRAME     (BUDGET + 8 * 1024)
+
+static uint32_t sizeInside;
+
+/* Sum of the frame bytes, read back so the frame is really used */
+static volatile uint32_t frameSum;
+
+/*****************************************************************************
+** Function name:       useStack
+**
+** Description:         Writes a frame of the given size and reads it
+**                      back.
+**
+** Parameters:          bytes - frame size
+** Returned value:      None
+*****************************************************************************/
+static void __attribute__((noinline)) useStack(uint32_t bytes)
+{
+    volatile uint8_t frame[bytes];
+
+    for (uint32_t i = 0; i < bytes; i++) {
+        frame[i] = 0x5A;
+    }
+    for (uint32_t i = 0; i < bytes; i++) {
+        frameSum += frame[i];
+    }
+    sizeInside = stack_getSize();
+}
+
+/*****************************************************************************
+** Function name:       smallFrame, largeFrame
+**
+** Description:         Budgeted functions with a small and an oversized
+**                      frame.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void smallFrame(void)
+{
+    useStack(SMALL_FRAME);
+}
+
+static void largeFrame(void)
+{
+    useStack(LARGE_FRAME);
+}
+
+/*****************************************************************************
+** Function name:       neverReturns
+**
+** Description:         Budgeted function that leaves its thread instead of
+**                      returning.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void neverReturns(void)
+{
+    pthread_exit(NULL);
+}
+
+int main(void)
+{
+    stack_budget_t result;
+
+    CHECK(stack_runWithBudget(smallFrame, BUDGET, &result), "small frame failed its budget");
+    CHECK(result.ran && !result.guardHit, "small frame: ran %u, guard hit %u", result.ran,
+          result.guardHit);
+    CHECK(result.used >= SMALL_FRAME && result.used < BUDGET, "small frame used %lu bytes",
+          (unsigned long)result.used);
+    CHECK(sizeInside == BUDGET, "budget inside the run %lu", (unsigned long)sizeInside);
+
+    CHECK(!stack_runWithBudget(largeFrame, BUDGET, &result), "large frame passed its budget");
+    CHECK(result.ran && result.guardHit, "large frame: ran %u, guard hit %u", result.ran,
+          result.guardHit);
+    CHECK(result.used > LARGE_FRAME, "large frame used %lu bytes", (unsigned long)result.used);
+
+    CHECK(!stack_runWithBudget(neverReturns, BUDGET, &result), "unfinished run passed");
+    CHECK(!result.ran, "unfinished run reported as run");
+
+    return hosttest_done("stack_test");
+}
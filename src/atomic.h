@@ -0,0 +1,34 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Lock-free counters for data shared with interrupt
+ *                handlers, built on the Cortex-M3 exclusive accesses
+ *                (LDREX/STREX), so no interrupt is ever masked.
+ *
+ ******************************************************************************/
+
+#ifndef __ATOMIC_H
+#define __ATOMIC_H
+
+/*****************************************************************************
+** Function name:       atomic_fetchAdd
+**
+** Description:         Adds to a counter as one indivisible step, even
+**                      when an interrupt handler updates it in between.
+**
+** Parameters:          counter - counter to update
+**                      amount  - value to add
+** Returned value:      Counter value before the addition
+*****************************************************************************/
+static inline uint32_t atomic_fetchAdd(volatile uint32_t *counter, uint32_t amount)
+{
+    uint32_t value;
+    uint32_t failed;
+
+    do {
+        __asm volatile ("ldrex %0, [%1]" : "=r" (value) : "r" (counter));
+        __asm volatile ("strex %0, %2, [%1]" : "=&r" (failed) : "r" (counter), "r" (value + amount) : "memory");
+    } while (failed);
+    return value;
+}
+
+#endif /* end __ATOMIC_H */
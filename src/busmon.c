@@ -0,0 +1,159 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Bus and loop monitor, see busmon.h.
+ *
+ ******************************************************************************/
+
+#include "mcu_regs.h"
+#include "type.h"
+#include "acc.h"
+#include "light.h"
+
+#include "busmon.h"
+#include "clock.h"
+#include "perf.h"
+#include "power.h"
+
+static volatile uint32_t i2cTicks;
+static volatile uint32_t sspTicks;
+static uint32_t accTicks;
+static uint32_t lightTicks;
+static uint32_t loopTicks;
+static uint32_t lastLoop;
+
+/*****************************************************************************
+** Function name:       busmon_now
+**
+** Description:         Current time in monitor ticks.
+**
+** Parameters:          None
+** Returned value:      Core cycles, or simulated microseconds on the host
+*****************************************************************************/
+uint32_t busmon_now(void)
+{
+#ifndef CLOCK_VIRTUAL
+    return PERF_CYCLES();
+#else
+    return (uint32_t)clock_nowUs();
+#endif
+}
+
+/*****************************************************************************
+** Function name:       busmon_ticksToUs
+**
+** Description:         Converts monitor ticks to microseconds.
+**
+** Parameters:          ticks - duration in monitor ticks
+** Returned value:      Microseconds
+*****************************************************************************/
+uint32_t busmon_ticksToUs(uint32_t ticks)
+{
+#ifndef CLOCK_VIRTUAL
+    return ticks / (SystemFrequency / 1000000);
+#else
+    return ticks;
+#endif
+}
+
+/*****************************************************************************
+** Function name:       busmon_addI2c
+**
+** Description:         Accounts time spent in an I2C transfer.
+**
+** Parameters:          ticks - duration in monitor ticks
+** Returned value:      None
+*****************************************************************************/
+void busmon_addI2c(uint32_t ticks)
+{
+    i2cTicks += ticks;
+}
+
+/*****************************************************************************
+** Function name:       busmon_addSsp
+**
+** Description:         Accounts time spent in an SSP transfer.
+**
+** Parameters:          ticks - duration in monitor ticks
+** Returned value:      None
+*****************************************************************************/
+void busmon_addSsp(uint32_t ticks)
+{
+    sspTicks += ticks;
+}
+
+/*****************************************************************************
+** Function name:       busmon_accRead
+**
+** Description:         acc_read() with its duration recorded, the I2C
+**                      clock held for it.
+**
+** Parameters:          x, y, z - receive the acceleration
+** Returned value:      None
+*****************************************************************************/
+void busmon_accRead(int8_t *x, int8_t *y, int8_t *z)
+{
+    power_acquire(POWER_ACC);
+    uint32_t start = busmon_now();
+
+    acc_read(x, y, z);
+    accTicks = busmon_now() - start;
+    i2cTicks += accTicks;
+    power_release(POWER_ACC);
+}
+
+/*****************************************************************************
+** Function name:       busmon_lightRead
+**
+** Description:         light_read() with its duration recorded, the I2C
+**                      clock held for it.
+**
+** Parameters:          None
+** Returned value:      Light level in lux
+*****************************************************************************/
+uint32_t busmon_lightRead(void)
+{
+    power_acquire(POWER_LIGHT);
+    uint32_t start = busmon_now();
+    uint32_t lux = light_read();
+
+    lightTicks = busmon_now() - start;
+    i2cTicks += lightTicks;
+    power_release(POWER_LIGHT);
+    return lux;
+}
+
+/*****************************************************************************
+** Function name:       busmon_loopTick
+**
+** Description:         Marks one pass of the main loop.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void busmon_loopTick(void)
+{
+    uint32_t now = busmon_now();
+
+    loopTicks = now - lastLoop;
+    lastLoop = now;
+}
+
+/*****************************************************************************
+** Function name:       busmon_getCounters
+**
+** Description:         Snapshot of all counters; utilization over a window
+**                      is the difference of two snapshots' bus times
+**                      divided by the difference of their time stamps.
+**
+** Parameters:          counters - receives the snapshot
+** Returned value:      None
+*****************************************************************************/
+void busmon_getCounters(busmon_counters_t *counters)
+{
+    counters->now = busmon_now();
+    counters->i2cTicks = i2cTicks;
+    counters->sspTicks = sspTicks;
+    counters->accTicks = accTicks;
+    counters->lightTicks = lightTicks;
+    counters->loopTicks = loopTicks;
+}
@@ -0,0 +1,33 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Bus and loop monitor for the diagnostics screen. Time
+ *                spent in I2C and SSP transfers is summed so utilization
+ *                can be derived over any window; the latest accelerometer
+ *                and light sensor read times and the main-loop period are
+ *                kept as well. Times are in monitor ticks: core cycles on
+ *                the board, microseconds of simulated time on the host.
+ *
+ ******************************************************************************/
+
+#ifndef __BUSMON_H
+#define __BUSMON_H
+
+typedef struct {
+    uint32_t now;           /* time of the snapshot */
+    uint32_t i2cTicks;      /* total time in I2C transfers */
+    uint32_t sspTicks;      /* total time in SSP transfers */
+    uint32_t accTicks;      /* latest acc_read() */
+    uint32_t lightTicks;    /* latest light_read() */
+    uint32_t loopTicks;     /* latest main-loop period */
+} busmon_counters_t;
+
+uint32_t busmon_now(void);
+uint32_t busmon_ticksToUs(uint32_t ticks);
+void busmon_addI2c(uint32_t ticks);
+void busmon_addSsp(uint32_t ticks);
+void busmon_accRead(int8_t *x, int8_t *y, int8_t *z);
+uint32_t busmon_lightRead(void);
+void busmon_loopTick(void);
+void busmon_getCounters(busmon_counters_t *counters);
+
+#endif /* end __BUSMON_H */
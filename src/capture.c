@@ -0,0 +1,290 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Response capture on the joystick center edge, see
+ *                capture.h.
+ *
+ ******************************************************************************/
+
+#ifndef CLOCK_VIRTUAL
+
+#include "mcu_regs.h"
+#include "type.h"
+#include "gpio.h"
+
+#include "busmon.h"
+#include "clock.h"
+#include "display.h"
+#include "fastgpio.h"
+#include "perf.h"
+#include "irqprio.h"
+#include "power.h"
+#include "stack.h"
+#include "trace.h"
+#include "capture.h"
+
+#include <string.h>
+
+/* Joystick center button, active low with pull-up */
+#define CAPTURE_PORT        PORT2
+#define CAPTURE_PIN         0
+#define CAPTURE_MASK        (1 << CAPTURE_PIN)
+
+/* Cycle stamps are used below this span, CYCCNT wraps after ~59 s */
+#define CYCLE_SPAN_MS       50000
+
+/* Self-test load: audio sample rate of the Timer32_1 interrupt */
+#define AUDIO_LOAD_HZ       8000
+
+/* Self-test timeouts in ms */
+#define EDGE_TIMEOUT_MS     3
+
+/* Latest capture since capture_arm() */
+static volatile uint8_t captured;
+static volatile uint32_t captureCycles;
+static volatile uint32_t captureMs;
+static uint32_t armCycles;
+
+/* Self-test edge injection */
+volatile uint8_t captureInjectFromTick;
+static volatile uint32_t injectCycles;
+
+/*****************************************************************************
+** Function name:       PIOINT2_IRQHandler
+**
+** Description:         Time stamps the first falling edge after arming.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void PIOINT2_IRQHandler(void)
+{
+    uint32_t cycles = PERF_CYCLES();
+
+    stack_sampleIsr();
+    if (LPC_GPIO2->MIS & CAPTURE_MASK) {
+        LPC_GPIO2->IC = CAPTURE_MASK;
+        if (!captured) {
+            captureCycles = cycles;
+            captureMs = clock_nowMs();
+            captured = 1;
+            trace_instant(TRACE_CLICK, 0);
+        }
+    }
+    (void)LPC_GPIO2->MIS;   // Let the IC write settle before returning
+}
+
+/*****************************************************************************
+** Function name:       capture_init
+**
+** Description:         Enables the falling-edge interrupt of the center
+**                      button. Needs the DWT cycle counter (display_init)
+**                      and the priority plan (irqprio_init).
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void capture_init(void)
+{
+    GPIOSetDir(CAPTURE_PORT, CAPTURE_PIN, 0);
+    FASTGPIO_LOW(CAPTURE_PORT, CAPTURE_PIN);   // Output latch for the self-test
+    GPIOSetInterrupt(CAPTURE_PORT, CAPTURE_PIN, 0, 0, 0);  // Edge, single, falling
+    LPC_GPIO2->IC = CAPTURE_MASK;
+    GPIOIntEnable(CAPTURE_PORT, CAPTURE_PIN);
+    NVIC_EnableIRQ(EINT2_IRQn);
+}
+
+/*****************************************************************************
+** Function name:       capture_arm
+**
+** Description:         Starts timing: the next click is captured relative
+**                      to now. Call at stimulus onset.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void capture_arm(void)
+{
+    captured = 0;
+    armCycles = PERF_CYCLES();
+}
+
+/*****************************************************************************
+** Function name:       capture_elapsedMs
+**
+** Description:         Time from arming to the captured click, from the
+**                      cycle stamps when the span allows it. Without a
+**                      captured edge (button already held at arming) the
+**                      current time is used instead.
+**
+** Parameters:          startMs - clock_nowMs() at arming
+** Returned value:      Elapsed milliseconds
+*****************************************************************************/
+uint32_t capture_elapsedMs(uint32_t startMs)
+{
+    if (!captured) {
+        return clock_nowMs() - startMs;
+    }
+    if (captureMs - startMs < CYCLE_SPAN_MS) {
+        return (captureCycles - armCycles) / (SystemFrequency / 1000);
+    }
+    return captureMs - startMs;
+}
+
+/*****************************************************************************
+** Function name:       capture_elapsedUs
+**
+** Description:         Like capture_elapsedMs(), in microseconds.
+**
+** Parameters:          startUs - clock_nowUs() at arming
+** Returned value:      Elapsed microseconds
+*****************************************************************************/
+uint32_t capture_elapsedUs(uint64_t startUs)
+{
+    if (!captured) {
+        return (uint32_t)(clock_nowUs() - startUs);
+    }
+    if (captureMs - (uint32_t)(startUs / 1000) < CYCLE_SPAN_MS) {
+        return (captureCycles - armCycles) / (SystemFrequency / 1000000);
+    }
+    return (uint32_t)((uint64_t)captureMs * 1000 - startUs);
+}
+
+/*****************************************************************************
+** Function name:       injectEdge
+**
+** Description:         Pulls the capture pin low by turning it into an
+**                      output (latch is low) and stamps the moment.
+**                      Harmless while the button is pressed, which also
+**                      pulls it low.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static inline void injectEdge(void)
+{
+    injectCycles = PERF_CYCLES();
+    LPC_GPIO2->DIR |= CAPTURE_MASK;
+}
+
+/*****************************************************************************
+** Function name:       capture_injectFromTick
+**
+** Description:         Injects the pending self-test edge from inside the
+**                      SysTick handler.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void capture_injectFromTick(void)
+{
+    injectEdge();
+    captureInjectFromTick = 0;
+}
+
+/*****************************************************************************
+** Function name:       runLoad
+**
+** Description:         One slice of bus load: a full-screen SSP flush and
+**                      an I2C accelerometer read.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void runLoad(void)
+{
+    int8_t x, y, z;
+
+    display_measureFullFlush();
+    busmon_accRead(&x, &y, &z);
+}
+
+/*****************************************************************************
+** Function name:       waitFor
+**
+** Description:         Waits for a flag to become the given value.
+**
+** Parameters:          flag  - flag to watch
+**                      value - value to wait for
+** Returned value:      1 if it did within EDGE_TIMEOUT_MS, else 0
+*****************************************************************************/
+static uint8_t waitFor(volatile uint8_t *flag, uint8_t value)
+{
+    uint32_t start = clock_nowMs();
+
+    while (*flag != value) {
+        if (clock_nowMs() - start > EDGE_TIMEOUT_MS) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*****************************************************************************
+** Function name:       capture_selfTest
+**
+** Description:         Measures edge-to-handler latency of the capture
+**                      interrupt under load. Even rounds inject the edge
+**                      from thread code, odd rounds from the SysTick
+**                      handler while an SSP flush and I2C reads are under
+**                      way; a Timer32_1 interrupt runs at audio rate all
+**                      the time. The button must not be touched meanwhile.
+**
+** Parameters:          rounds - number of injected edges
+**                      report - receives the latencies
+** Returned value:      None
+*****************************************************************************/
+void capture_selfTest(uint16_t rounds, capture_report_t *report)
+{
+    memset(report, 0, sizeof(*report));
+
+    // Audio stand-in; the timer32 driver's handler acknowledges the match
+    power_acquire(POWER_LOAD);
+    LPC_TMR32B1->TCR = 2;
+    LPC_TMR32B1->MR0 = SystemFrequency / AUDIO_LOAD_HZ;
+    LPC_TMR32B1->MCR = 3;   // Interrupt and reset on MR0
+    LPC_TMR32B1->TCR = 1;
+    NVIC_EnableIRQ(TIMER_32_1_IRQn);
+
+    for (uint16_t round = 0; round < rounds; round++) {
+        uint8_t fromTick = round & 1;
+
+        LPC_GPIO2->IC = CAPTURE_MASK;
+        captured = 0;
+
+        if (fromTick) {
+            captureInjectFromTick = 1;
+            runLoad();
+            waitFor(&captureInjectFromTick, 0);
+        } else {
+            uint32_t saved = irq_maskFrom(IRQ_PRIO_AUDIO);
+            injectEdge();
+            irq_unmask(saved);
+            runLoad();
+        }
+
+        uint8_t hit = waitFor(&captured, 1);
+        captureInjectFromTick = 0;
+        LPC_GPIO2->DIR &= ~CAPTURE_MASK;
+        clock_delayUs(50);  // Pull-up brings the pin back high
+
+        report->rounds++;
+        if (!hit) {
+            report->missed++;
+            continue;
+        }
+        uint32_t latency = captureCycles - injectCycles;
+        report->sumCycles += latency;
+        if (fromTick) {
+            if (latency > report->isrMaxCycles) report->isrMaxCycles = latency;
+        } else {
+            if (latency > report->threadMaxCycles) report->threadMaxCycles = latency;
+        }
+    }
+
+    NVIC_DisableIRQ(TIMER_32_1_IRQn);
+    LPC_TMR32B1->TCR = 0;
+    power_release(POWER_LOAD);
+    LPC_GPIO2->IC = CAPTURE_MASK;
+}
+
+#endif /* CLOCK_VIRTUAL */
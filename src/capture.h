@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Response capture. The falling edge of the joystick center
+ *                button raises the most urgent interrupt in the system
+ *                (see irqprio.h), whose handler time stamps the click in
+ *                core cycles, so a reaction time no longer depends on how
+ *                often or how late the game polls the button.
+ *
+ *                A self-test drives the capture pin low itself and
+ *                measures edge-to-handler latency in cycles, from thread
+ *                code and from inside the SysTick handler, while an audio
+ *                rate timer interrupt, I2C traffic and full-screen SSP
+ *                flushes run.
+ *
+ ******************************************************************************/
+
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+/* Result of capture_selfTest(), latencies in core cycles */
+typedef struct {
+    uint16_t rounds;
+    uint16_t missed;            /* injected edges that raised no interrupt */
+    uint32_t threadMaxCycles;   /* worst latency, edge from thread code */
+    uint32_t isrMaxCycles;      /* worst latency, edge from the SysTick handler */
+    uint32_t sumCycles;
+} capture_report_t;
+
+#ifndef CLOCK_VIRTUAL
+
+/* Set by the self-test to have the next SysTick inject an edge */
+extern volatile uint8_t captureInjectFromTick;
+
+void capture_init(void);
+void capture_arm(void);
+uint32_t capture_elapsedMs(uint32_t startMs);
+uint32_t capture_elapsedUs(uint64_t startUs);
+void capture_injectFromTick(void);
+void capture_selfTest(uint16_t rounds, capture_report_t *report);
+
+/*****************************************************************************
+** Function name:       capture_onTick
+**
+** Description:         SysTick hook of the self-test.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static inline void capture_onTick(void)
+{
+    if (captureInjectFromTick) {
+        capture_injectFromTick();
+    }
+}
+
+#else /* CLOCK_VIRTUAL */
+
+#define capture_init()
+#define capture_arm()
+#define capture_elapsedMs(startMs)  (clock_nowMs() - (startMs))
+#define capture_elapsedUs(startUs)  ((uint32_t)(clock_nowUs() - (startUs)))
+#define capture_onTick()
+#define capture_selfTest(rounds, report)    memset((report), 0, sizeof(*(report)))
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __CAPTURE_H */
@@ -0,0 +1,351 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Time base of the game: SysTick millisecond counter and
+ *                Timer32_0 busy waits on the board, or a simulated clock
+ *                when built with CLOCK_VIRTUAL.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "capture.h"
+#include "clock.h"
+#include "profile.h"
+#include "stack.h"
+#include "trace.h"
+
+#ifndef CLOCK_VIRTUAL
+
+#include "mcu_regs.h"
+#include "timer32.h"
+
+/* SysTick registers of the Cortex-M3 core */
+#define SYSTICK_CTRL        (*(volatile uint32_t *)0xE000E010)
+#define SYSTICK_LOAD        (*(volatile uint32_t *)0xE000E014)
+#define SYSTICK_VAL         (*(volatile uint32_t *)0xE000E018)
+
+#define SYSTICK_ENABLE      (1 << 0)
+#define SYSTICK_TICKINT     (1 << 1)
+#define SYSTICK_CLKSOURCE   (1 << 2)    // Core clock
+
+/* Milliseconds since clock_init(), wraps after ~49 days */
+static volatile uint32_t msTicks;
+
+/*****************************************************************************
+** Function name:       tick
+**
+** Description:         Millisecond tick.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static inline void tick(void)
+{
+    stack_sampleIsr();
+    msTicks++;
+    if ((msTicks & 0x3FFF) == 0) {
+        trace_instant(TRACE_SYNC, (uint16_t)(msTicks >> 14));
+    }
+    capture_onTick();
+}
+
+#ifdef PROFILE
+
+/* Word of the exception stack frame holding the interrupted PC */
+#define FRAME_PC            6
+
+/*****************************************************************************
+** Function name:       profiledTick
+**
+** Description:         Millisecond tick that also feeds the profiler.
+**
+** Parameters:          frame - exception stack frame of the interrupted code
+** Returned value:      None
+*****************************************************************************/
+static void __attribute__((used)) profiledTick(const uint32_t *frame)
+{
+    tick();
+    profile_sample(frame[FRAME_PC]);
+}
+
+/*****************************************************************************
+** Function name:       SysTick_Handler
+**
+** Description:         Passes the exception frame, on whichever stack it
+**                      was pushed, to profiledTick().
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void SysTick_Handler(void) __attribute__((naked));
+void SysTick_Handler(void)
+{
+    __asm volatile (
+        "tst    lr, #4          \n"
+        "ite    eq              \n"
+        "mrseq  r0, msp         \n"
+        "mrsne  r0, psp         \n"
+        "b      profiledTick    \n"
+    );
+}
+
+#else
+
+/*****************************************************************************
+** Function name:       SysTick_Handler
+**
+** Description:         Millisecond tick.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void SysTick_Handler(void)
+{
+    tick();
+}
+
+#endif /* PROFILE */
+
+/*****************************************************************************
+** Function name:       clock_init
+**
+** Description:         Starts the 1 ms SysTick. Timer32_0 must already be
+**                      set up with init_timer32() for the busy waits.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void clock_init(void)
+{
+    msTicks = 0;
+    SYSTICK_LOAD = (SystemFrequency / 1000) - 1;
+    SYSTICK_VAL = 0;
+    SYSTICK_CTRL = SYSTICK_CLKSOURCE | SYSTICK_TICKINT | SYSTICK_ENABLE;
+}
+
+/*****************************************************************************
+** Function name:       clock_nowMs
+**
+** Description:         Current time stamp.
+**
+** Parameters:          None
+** Returned value:      Milliseconds since clock_init()
+*****************************************************************************/
+uint32_t clock_nowMs(void)
+{
+    return msTicks;
+}
+
+/*****************************************************************************
+** Function name:       clock_nowUs
+**
+** Description:         Current time stamp at microsecond resolution, from
+**                      the millisecond count and the SysTick down-counter.
+**                      Thread code only: in a section that masks SysTick
+**                      a pending wrap is missed and time steps back 1 ms.
+**
+** Parameters:          None
+** Returned value:      Microseconds since clock_init()
+*****************************************************************************/
+uint64_t clock_nowUs(void)
+{
+    uint32_t ms;
+    uint32_t count;
+
+    do {
+        ms = msTicks;
+        count = SYSTICK_VAL;
+    } while (ms != msTicks);
+
+    return (uint64_t)ms * 1000 + (SYSTICK_LOAD - count) / (SystemFrequency / 1000000);
+}
+
+/*****************************************************************************
+** Function name:       clock_delayMs
+**
+** Description:         Busy-waits on Timer32_0.
+**
+** Parameters:          ms - time to wait in milliseconds
+** Returned value:      None
+*****************************************************************************/
+void clock_delayMs(uint32_t ms)
+{
+    delay32Ms(0, ms);
+}
+
+/*****************************************************************************
+** Function name:       clock_delayUs
+**
+** Description:         Busy-waits on Timer32_0.
+**
+** Parameters:          us - time to wait in microseconds
+** Returned value:      None
+*****************************************************************************/
+void clock_delayUs(uint32_t us)
+{
+    delay32Us(0, us);
+}
+
+#else /* CLOCK_VIRTUAL */
+
+#include <stdlib.h>
+#include <time.h>
+
+/* Simulated time, advanced only by waits */
+static uint64_t virtualUs;
+
+/* Real-time mode: host monotonic and simulated time at its start, and
+   rate error in ppm */
+static uint8_t realtime;
+static uint64_t realtimeStartNs;
+static uint64_t realtimeStartUs;
+static int32_t realtimeSkewPpm;
+
+/*****************************************************************************
+** Function name:       hostNowNs
+**
+** Description:         Host monotonic time.
+**
+** Parameters:          None
+** Returned value:      Nanoseconds since an arbitrary start
+*****************************************************************************/
+static uint64_t hostNowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*****************************************************************************
+** Function name:       realtimeWait
+**
+** Description:         Sleeps until the host's clock, at the board's rate,
+**                      has caught up with simulated time. Returns at once
+**                      when the host is already past it, so the board
+**                      catches up over the next waits.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void realtimeWait(void)
+{
+    int64_t boardNs = (int64_t)(virtualUs - realtimeStartUs) * 1000;
+    int64_t dueNs = boardNs - boardNs * realtimeSkewPpm / (1000000 + realtimeSkewPpm);
+    int64_t elapsedNs;
+
+    while ((elapsedNs = (int64_t)(hostNowNs() - realtimeStartNs)) < dueNs) {
+        int64_t leftNs = dueNs - elapsedNs;
+        struct timespec pause = { (time_t)(leftNs / 1000000000), (long)(leftNs % 1000000000) };
+        nanosleep(&pause, NULL);
+    }
+}
+
+/*****************************************************************************
+** Function name:       clock_init
+**
+** Description:         Starts simulated time at zero. Call again to rewind
+**                      between simulated runs. With REFLEX_REALTIME set to
+**                      a skew in ppm (e.g. "0"), time is paced to the host's
+**                      clock from the start, so the game can be played
+**                      over the remote-control link.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void clock_init(void)
+{
+    const char *skew = getenv("REFLEX_REALTIME");
+
+    virtualUs = 0;
+    realtime = 0;
+    if (skew != NULL) {
+        clock_setRealtime((int32_t)strtol(skew, NULL, 10));
+    }
+}
+
+/*****************************************************************************
+** Function name:       clock_setRealtime
+**
+** Description:         Paces simulated time to the host's clock from now
+**                      on, running fast or slow by skewPpm: waits still
+**                      advance it by exactly their length, then sleep
+**                      until the host has caught up. Time stamps thus
+**                      never run ahead of the host's clock, trail it by
+**                      at most the work since the last wait, and a
+**                      session plays out exactly as it does on the
+**                      virtual clock. Lets two simulated boards talk over
+**                      a pseudo-terminal pair with a known crystal error.
+**
+** Parameters:          skewPpm - rate error, positive runs fast
+** Returned value:      None
+*****************************************************************************/
+void clock_setRealtime(int32_t skewPpm)
+{
+    realtimeStartNs = hostNowNs();
+    realtimeStartUs = virtualUs;
+    realtimeSkewPpm = skewPpm;
+    realtime = 1;
+}
+
+/*****************************************************************************
+** Function name:       clock_nowMs
+**
+** Description:         Current simulated time stamp.
+**
+** Parameters:          None
+** Returned value:      Milliseconds since clock_init()
+*****************************************************************************/
+uint32_t clock_nowMs(void)
+{
+    return (uint32_t)(clock_nowUs() / 1000);
+}
+
+/*****************************************************************************
+** Function name:       clock_nowUs
+**
+** Description:         Current simulated time stamp at full resolution.
+**
+** Parameters:          None
+** Returned value:      Microseconds since clock_init()
+*****************************************************************************/
+uint64_t clock_nowUs(void)
+{
+    return virtualUs;
+}
+
+/*****************************************************************************
+** Function name:       clock_delayMs
+**
+** Description:         Advances simulated time without waiting, or then
+**                      sleeps until the host catches up in real-time mode.
+**
+** Parameters:          ms - time to skip in milliseconds
+** Returned value:      None
+*****************************************************************************/
+void clock_delayMs(uint32_t ms)
+{
+    virtualUs += (uint64_t)ms * 1000;
+    if (realtime) {
+        realtimeWait();
+    }
+}
+
+/*****************************************************************************
+** Function name:       clock_delayUs
+**
+** Description:         Advances simulated time without waiting, or then
+**                      sleeps until the host catches up in real-time mode.
+**
+** Parameters:          us - time to skip in microseconds
+** Returned value:      None
+*****************************************************************************/
+void clock_delayUs(uint32_t us)
+{
+    virtualUs += us;
+    if (realtime) {
+        realtimeWait();
+    }
+}
+
+#endif /* CLOCK_VIRTUAL */
@@ -0,0 +1,30 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Time base of the game. All waits and time stamps go
+ *                through this module. On the board it counts SysTick
+ *                milliseconds and busy-waits with Timer32_0.
+ *
+ *                Built with CLOCK_VIRTUAL defined (host simulation), time
+ *                is a counter that every wait advances instantly. The code
+ *                between waits runs unchanged and in the same order, so a
+ *                scripted game gives the same results as on the board in
+ *                no wall-clock time. In real-time mode it follows the
+ *                host clock instead, with an optional rate error, so
+ *                simulated boards can talk to each other.
+ *
+ ******************************************************************************/
+
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+void clock_init(void);
+uint32_t clock_nowMs(void);
+void clock_delayMs(uint32_t ms);
+void clock_delayUs(uint32_t us);
+uint64_t clock_nowUs(void);
+
+#ifdef CLOCK_VIRTUAL
+void clock_setRealtime(int32_t skewPpm);
+#endif
+
+#endif /* end __CLOCK_H */
@@ -0,0 +1,644 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: OLED display driver with a RAM shadow of the panel.
+ *                Drawing only touches the shadow and marks the changed
+ *                column span of each page; a flush queues one SSP bus
+ *                transfer per dirty page at the controller's maximum
+ *                serial clock, so other devices can use the bus between
+ *                pages.
+ *
+ ******************************************************************************/
+
+#include "mcu_regs.h"
+#include "type.h"
+
+#include "fastgpio.h"
+#include "perf.h"
+#include "sspbus.h"
+#include "trace.h"
+#include "display.h"
+
+#include <string.h>
+
+/* OLED control lines on the base board */
+#define OLED_CS_PORT    0
+#define OLED_CS_PIN     2
+#define OLED_DC_PORT    2
+#define OLED_DC_PIN     7
+
+
+/*
+ * SSP throughput mode. SSD1305 serial clock cycle is 250 ns minimum, so
+ * run SCK at 4 MHz: PCLK 72 MHz / (CPSR 2 * (SCR 8 + 1)), 8-bit SPI mode 0.
+ */
+static const sspbus_device_t oledDevice = {
+    (8 << 8) | 0x07, 2, OLED_CS_PORT, OLED_CS_PIN, OLED_DC_PORT, OLED_DC_PIN
+};
+
+/* The 96 visible columns start at column 18 of the controller RAM */
+#define X_OFFSET        18
+#define PAGE_COUNT      (OLED_DISPLAY_HEIGHT >> 3)
+
+/* Character cell of the 5x7 font */
+#define FONT_GLYPH_WIDTH 5
+#define FONT_CELL_WIDTH  6
+
+/* RAM copy of the panel contents, one byte per 8 vertical pixels */
+static uint8_t shadowFB[OLED_DISPLAY_WIDTH * PAGE_COUNT];
+
+/* Dirty column span per page, clean when dirtyMin > dirtyMax */
+static uint8_t dirtyMin[PAGE_COUNT];
+static uint8_t dirtyMax[PAGE_COUNT];
+
+/* One bus transfer per page: address bytes as head, dirty span as body */
+static sspbus_xfer_t pageXfer[PAGE_COUNT];
+static uint8_t pageAddress[PAGE_COUNT][3];
+
+/* Last page queued by display_flushAsync(), 0xFF when none is pending */
+static uint8_t lastQueuedPage = 0xFF;
+
+/* Single command bytes outside the page transfers */
+static sspbus_xfer_t commandXfer;
+static uint8_t commandByte;
+
+/* Statistics of the most recent flush */
+static uint32_t lastFlushBytes;
+static uint32_t lastFlushCycles;
+
+/*
+ * 5x7 font, ASCII 0x20-0x7F, stored page-major: five column bytes per
+ * glyph, bit 0 is the top row, so a glyph blits straight into page bytes.
+ * The sixth column of the cell is spacing.
+ */
+static const uint8_t fontColumns[] = {
+    0x00,0x00,0x00,0x00,0x00,  /*   */
+    0x5f,0x00,0x00,0x00,0x00,  /* ! */
+    0x07,0x00,0x07,0x00,0x00,  /* " */
+    0x14,0x7f,0x14,0x7f,0x14,  /* # */
+    0x24,0x2a,0x7f,0x2a,0x12,  /* $ */
+    0x23,0x13,0x08,0x64,0x62,  /* % */
+    0x36,0x49,0x55,0x22,0x50,  /* & */
+    0x05,0x03,0x00,0x00,0x00,  /* ' */
+    0x1c,0x22,0x41,0x00,0x00,  /* ( */
+    0x41,0x22,0x1c,0x00,0x00,  /* ) */
+    0x08,0x2a,0x1c,0x2a,0x08,  /* * */
+    0x08,0x08,0x3e,0x08,0x08,  /* + */
+    0xa0,0x60,0x00,0x00,0x00,  /* , */
+    0x08,0x08,0x08,0x08,0x08,  /* - */
+    0x60,0x60,0x00,0x00,0x00,  /* . */
+    0x20,0x10,0x08,0x04,0x02,  /* / */
+    0x3e,0x51,0x49,0x45,0x3e,  /* 0 */
+    0x00,0x42,0x7f,0x40,0x00,  /* 1 */
+    0x62,0x51,0x49,0x49,0x46,  /* 2 */
+    0x22,0x41,0x49,0x49,0x36,  /* 3 */
+    0x18,0x14,0x12,0x7f,0x10,  /* 4 */
+    0x27,0x45,0x45,0x45,0x39,  /* 5 */
+    0x3c,0x4a,0x49,0x49,0x30,  /* 6 */
+    0x01,0x71,0x09,0x05,0x03,  /* 7 */
+    0x36,0x49,0x49,0x49,0x36,  /* 8 */
+    0x06,0x49,0x49,0x29,0x1e,  /* 9 */
+    0x36,0x36,0x00,0x00,0x00,  /* : */
+    0xac,0x6c,0x00,0x00,0x00,  /* ; */
+    0x08,0x14,0x22,0x41,0x00,  /* < */
+    0x14,0x14,0x14,0x14,0x14,  /* = */
+    0x41,0x22,0x14,0x08,0x00,  /* > */
+    0x02,0x01,0x51,0x09,0x06,  /* ? */
+    0x32,0x49,0x79,0x41,0x3e,  /* @ */
+    0x7e,0x09,0x09,0x09,0x7e,  /* A */
+    0x7f,0x49,0x49,0x49,0x36,  /* B */
+    0x3e,0x41,0x41,0x41,0x22,  /* C */
+    0x7f,0x41,0x41,0x22,0x1c,  /* D */
+    0x7f,0x49,0x49,0x49,0x41,  /* E */
+    0x7f,0x09,0x09,0x09,0x01,  /* F */
+    0x3e,0x41,0x41,0x51,0x72,  /* G */
+    0x7f,0x08,0x08,0x08,0x7f,  /* H */
+    0x41,0x7f,0x41,0x00,0x00,  /* I */
+    0x20,0x40,0x41,0x3f,0x01,  /* J */
+    0x7f,0x08,0x14,0x22,0x41,  /* K */
+    0x7f,0x40,0x40,0x40,0x40,  /* L */
+    0x7f,0x02,0x0c,0x02,0x7f,  /* M */
+    0x7f,0x04,0x08,0x10,0x7f,  /* N */
+    0x3e,0x41,0x41,0x41,0x3e,  /* O */
+    0x7f,0x09,0x09,0x09,0x06,  /* P */
+    0x3e,0x41,0x51,0x21,0x5e,  /* Q */
+    0x7f,0x09,0x19,0x29,0x46,  /* R */
+    0x26,0x49,0x49,0x49,0x32,  /* S */
+    0x01,0x01,0x7f,0x01,0x01,  /* T */
+    0x3f,0x40,0x40,0x40,0x3f,  /* U */
+    0x1f,0x20,0x40,0x20,0x1f,  /* V */
+    0x3f,0x40,0x38,0x40,0x3f,  /* W */
+    0x63,0x14,0x08,0x14,0x63,  /* X */
+    0x03,0x04,0x78,0x04,0x03,  /* Y */
+    0x61,0x51,0x49,0x45,0x43,  /* Z */
+    0x7f,0x41,0x41,0x00,0x00,  /* [ */
+    0x02,0x04,0x08,0x10,0x20,  /* \\ */
+    0x41,0x41,0x7f,0x00,0x00,  /* ] */
+    0x04,0x02,0x01,0x02,0x04,  /* ^ */
+    0x80,0x80,0x80,0x80,0x80,  /* _ */
+    0x01,0x02,0x04,0x00,0x00,  /* ` */
+    0x20,0x54,0x54,0x54,0x78,  /* a */
+    0x7f,0x48,0x44,0x44,0x38,  /* b */
+    0x38,0x44,0x44,0x28,0x00,  /* c */
+    0x38,0x44,0x44,0x48,0x7f,  /* d */
+    0x38,0x54,0x54,0x54,0x18,  /* e */
+    0x08,0x7e,0x09,0x02,0x00,  /* f */
+    0x18,0xa4,0xa4,0xa4,0x7c,  /* g */
+    0x7f,0x08,0x04,0x04,0x78,  /* h */
+    0x00,0x7d,0x00,0x00,0x00,  /* i */
+    0x80,0x84,0x7d,0x00,0x00,  /* j */
+    0x7f,0x10,0x28,0x44,0x00,  /* k */
+    0x41,0x7f,0x40,0x00,0x00,  /* l */
+    0x7c,0x04,0x18,0x04,0x78,  /* m */
+    0x7c,0x08,0x04,0x7c,0x00,  /* n */
+    0x38,0x44,0x44,0x38,0x00,  /* o */
+    0xfc,0x24,0x24,0x18,0x00,  /* p */
+    0x18,0x24,0x24,0xfc,0x00,  /* q */
+    0x00,0x7c,0x08,0x04,0x00,  /* r */
+    0x48,0x54,0x54,0x24,0x00,  /* s */
+    0x04,0x7f,0x44,0x00,0x00,  /* t */
+    0x3c,0x40,0x40,0x7c,0x00,  /* u */
+    0x1c,0x20,0x40,0x20,0x1c,  /* v */
+    0x3c,0x40,0x30,0x40,0x3c,  /* w */
+    0x44,0x28,0x10,0x28,0x44,  /* x */
+    0x1c,0xa0,0xa0,0x7c,0x00,  /* y */
+    0x44,0x64,0x54,0x4c,0x44,  /* z */
+    0x08,0x36,0x41,0x00,0x00,  /* { */
+    0x00,0x7f,0x00,0x00,0x00,  /* | */
+    0x41,0x36,0x08,0x00,0x00,  /* } */
+    0x02,0x01,0x01,0x02,0x01,  /* ~ */
+    0x7f,0x7f,0x7f,0x7f,0x7f,  /* \x7f */
+};
+
+/*****************************************************************************
+** Function name:       queuePageSpan
+**
+** Description:         Queues the transfer that addresses a page and
+**                      streams one column span of the shadow to it.
+**
+** Parameters:          page  - page number (0-7)
+**                      first - first visible column
+**                      last  - last visible column
+** Returned value:      Number of bytes queued
+*****************************************************************************/
+static uint32_t queuePageSpan(uint8_t page, uint8_t first, uint8_t last)
+{
+    uint8_t column = first + X_OFFSET;
+    uint8_t *address = pageAddress[page];
+    sspbus_xfer_t *xfer = &pageXfer[page];
+
+    sspbus_complete(xfer);
+
+    address[0] = 0xB0 | page;               // Page address
+    address[1] = 0x00 | (column & 0x0F);    // Lower column address
+    address[2] = 0x10 | (column >> 4);      // Higher column address
+
+    xfer->device = &oledDevice;
+    xfer->head = address;
+    xfer->headLen = sizeof(pageAddress[page]);
+    xfer->body = &shadowFB[page * OLED_DISPLAY_WIDTH + first];
+    xfer->bodyLen = last - first + 1;
+    xfer->priority = SSPBUS_PRIO_BACKGROUND;
+    sspbus_submit(xfer);
+
+    return xfer->headLen + xfer->bodyLen;
+}
+
+/*****************************************************************************
+** Function name:       waitForFlush
+**
+** Description:         Completes a pending asynchronous flush. Called
+**                      before the shadow is modified, since queued pages
+**                      are sent straight from it.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void waitForFlush(void)
+{
+    if (lastQueuedPage != 0xFF) {
+        sspbus_complete(&pageXfer[lastQueuedPage]);
+        lastQueuedPage = 0xFF;
+    }
+}
+
+/*****************************************************************************
+** Function name:       markDirty
+**
+** Description:         Extends the dirty span of a page.
+**
+** Parameters:          page  - page number (0-7)
+**                      first - first changed column
+**                      last  - last changed column
+** Returned value:      None
+*****************************************************************************/
+static void markDirty(uint8_t page, uint8_t first, uint8_t last)
+{
+    if (first < dirtyMin[page]) dirtyMin[page] = first;
+    if (last > dirtyMax[page]) dirtyMax[page] = last;
+}
+
+/*****************************************************************************
+** Function name:       display_init
+**
+** Description:         Takes over the panel after oled_init() and
+**                      sspbus_init(): clears the panel so the shadow
+**                      matches the controller RAM.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void display_init(void)
+{
+    perf_init();
+    display_clearScreen(OLED_COLOR_BLACK);
+    display_flush();
+}
+
+/*****************************************************************************
+** Function name:       display_flushAsync
+**
+** Description:         Queues every dirty span on the SSP bus and returns.
+**                      The pages go out as the bus is serviced; the next
+**                      drawing call or flush waits for them to finish.
+**
+** Parameters:          None
+** Returned value:      Number of bytes queued
+*****************************************************************************/
+uint32_t display_flushAsync(void)
+{
+    uint32_t bytes = 0;
+
+    for (uint8_t page = 0; page < PAGE_COUNT; page++) {
+        if (dirtyMin[page] > dirtyMax[page]) {
+            continue;
+        }
+        bytes += queuePageSpan(page, dirtyMin[page], dirtyMax[page]);
+        dirtyMin[page] = 0xFF;
+        dirtyMax[page] = 0;
+        lastQueuedPage = page;
+    }
+    return bytes;
+}
+
+/*****************************************************************************
+** Function name:       display_flush
+**
+** Description:         Sends every dirty span to the panel and waits until
+**                      the last page is out. Transfers of higher priority
+**                      may run between pages.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void display_flush(void)
+{
+    uint32_t start = PERF_CYCLES();
+
+    trace_begin(TRACE_DRAW, 0);
+    uint32_t bytes = display_flushAsync();
+
+    waitForFlush();
+    trace_end(TRACE_DRAW, (uint16_t)bytes);
+
+    if (bytes > 0) {
+        lastFlushBytes = bytes;
+        lastFlushCycles = PERF_CYCLES() - start;
+    }
+}
+
+/*****************************************************************************
+** Function name:       display_getFlushRate
+**
+** Description:         Throughput of the most recent non-empty flush,
+**                      measured with the core cycle counter.
+**
+** Parameters:          None
+** Returned value:      Bytes per second, 0 if nothing was flushed yet
+*****************************************************************************/
+uint32_t display_getFlushRate(void)
+{
+    if (lastFlushCycles == 0) {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)lastFlushBytes * SystemFrequency) / lastFlushCycles);
+}
+
+/*****************************************************************************
+** Function name:       display_measureFullFlush
+**
+** Description:         Forces a full-screen flush of the current contents
+**                      and reports its throughput.
+**
+** Parameters:          None
+** Returned value:      Bytes per second of the full-screen flush
+*****************************************************************************/
+uint32_t display_measureFullFlush(void)
+{
+    for (uint8_t page = 0; page < PAGE_COUNT; page++) {
+        markDirty(page, 0, OLED_DISPLAY_WIDTH - 1);
+    }
+    display_flush();
+    return display_getFlushRate();
+}
+
+/*****************************************************************************
+** Function name:       sendCommand
+**
+** Description:         Sends one controller command byte and waits until
+**                      it is out.
+**
+** Parameters:          command - SSD1305 command
+** Returned value:      None
+*****************************************************************************/
+static void sendCommand(uint8_t command)
+{
+    sspbus_complete(&commandXfer);
+
+    commandByte = command;
+    commandXfer.device = &oledDevice;
+    commandXfer.head = &commandByte;
+    commandXfer.headLen = 1;
+    commandXfer.body = NULL;
+    commandXfer.bodyLen = 0;
+    commandXfer.priority = SSPBUS_PRIO_NORMAL;
+    sspbus_submit(&commandXfer);
+    sspbus_complete(&commandXfer);
+}
+
+/*****************************************************************************
+** Function name:       display_sleep
+**
+** Description:         Switches the panel off (SSD1305 sleep mode). The
+**                      controller keeps its RAM; drawing goes to the
+**                      shadow and flushes reach the RAM as usual.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void display_sleep(void)
+{
+    waitForFlush();
+    sendCommand(0xAE);                      // Display off
+}
+
+/*****************************************************************************
+** Function name:       display_wake
+**
+** Description:         Switches the panel back on. The controller kept
+**                      its RAM, so the panel shows what it last showed,
+**                      e.g. a result on hold; a screen composed in the
+**                      shadow meanwhile waits for its own flush.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void display_wake(void)
+{
+    sendCommand(0xAF);                      // Display on
+}
+
+/*****************************************************************************
+** Function name:       display_putPixel
+**
+** Description:         Sets a single pixel in the shadow.
+**
+** Parameters:          x, y  - pixel coordinates
+**                      color - pixel color
+** Returned value:      None
+*****************************************************************************/
+void display_putPixel(uint8_t x, uint8_t y, oled_color_t color)
+{
+    if ((x >= OLED_DISPLAY_WIDTH) || (y >= OLED_DISPLAY_HEIGHT)) {
+        return;
+    }
+    waitForFlush();
+
+    uint8_t page = y >> 3;
+    uint8_t mask = (uint8_t)(1 << (y & 0x07));
+    uint8_t *cell = &shadowFB[page * OLED_DISPLAY_WIDTH + x];
+
+    uint8_t value = (color > 0) ? (*cell | mask) : (*cell & ~mask);
+
+    if (value != *cell) {
+        *cell = value;
+        markDirty(page, x, x);
+    }
+}
+
+/*****************************************************************************
+** Function name:       display_clearScreen
+**
+** Description:         Fills the whole shadow with one color.
+**
+** Parameters:          color - fill color
+** Returned value:      None
+*****************************************************************************/
+void display_clearScreen(oled_color_t color)
+{
+    waitForFlush();
+    memset(shadowFB, (color > 0) ? 0xFF : 0x00, sizeof(shadowFB));
+
+    for (uint8_t page = 0; page < PAGE_COUNT; page++) {
+        markDirty(page, 0, OLED_DISPLAY_WIDTH - 1);
+    }
+}
+
+/*****************************************************************************
+** Function name:       pageMask
+**
+** Description:         Bits of a page byte that lie within a pixel row
+**                      range.
+**
+** Parameters:          page - page number (0-7)
+**                      y0   - first row of the range
+**                      y1   - last row of the range
+** Returned value:      Mask of the rows of the page inside [y0, y1]
+*****************************************************************************/
+static uint8_t pageMask(uint8_t page, uint8_t y0, uint8_t y1)
+{
+    uint8_t top = page << 3;
+    uint8_t first = (y0 > top) ? (y0 - top) : 0;
+    uint8_t last = ((y1 - top) < 7) ? (y1 - top) : 7;
+
+    return (uint8_t)((0xFF << first) & (0xFF >> (7 - last)));
+}
+
+/*****************************************************************************
+** Function name:       display_fillRect
+**
+** Description:         Fills a rectangle with one color, clipped to the
+**                      display. Writes whole page bytes under a row mask.
+**
+** Parameters:          x, y          - top left corner
+**                      width, height - size in pixels
+**                      color         - fill color
+** Returned value:      None
+*****************************************************************************/
+void display_fillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, oled_color_t color)
+{
+    if ((x >= OLED_DISPLAY_WIDTH) || (y >= OLED_DISPLAY_HEIGHT) || (width == 0) || (height == 0)) {
+        return;
+    }
+    if (width > OLED_DISPLAY_WIDTH - x) width = OLED_DISPLAY_WIDTH - x;
+    if (height > OLED_DISPLAY_HEIGHT - y) height = OLED_DISPLAY_HEIGHT - y;
+    waitForFlush();
+
+    uint8_t y1 = y + height - 1;
+
+    for (uint8_t page = y >> 3; page <= (y1 >> 3); page++) {
+        uint8_t mask = pageMask(page, y, y1);
+        uint8_t *cell = &shadowFB[page * OLED_DISPLAY_WIDTH + x];
+
+        for (uint8_t col = 0; col < width; col++) {
+            cell[col] = (color > 0) ? (cell[col] | mask) : (cell[col] & ~mask);
+        }
+        markDirty(page, x, x + width - 1);
+    }
+}
+
+/*****************************************************************************
+** Function name:       display_scrollRect
+**
+** Description:         Moves the contents of a rectangle vertically inside
+**                      the shadow, without redrawing them. Rows moved in
+**                      from outside the rectangle are undefined and must be
+**                      repainted by the caller.
+**
+** Parameters:          x, y          - top left corner
+**                      width, height - size in pixels
+**                      dy            - rows to move, positive is down
+** Returned value:      None
+*****************************************************************************/
+void display_scrollRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, int8_t dy)
+{
+    if ((x >= OLED_DISPLAY_WIDTH) || (y >= OLED_DISPLAY_HEIGHT) || (width == 0) || (height == 0)) {
+        return;
+    }
+    if (width > OLED_DISPLAY_WIDTH - x) width = OLED_DISPLAY_WIDTH - x;
+    if (height > OLED_DISPLAY_HEIGHT - y) height = OLED_DISPLAY_HEIGHT - y;
+    if ((dy == 0) || (dy >= (int8_t)height) || (-dy >= (int8_t)height)) {
+        return;
+    }
+    waitForFlush();
+
+    uint8_t y1 = y + height - 1;
+    uint8_t firstPage = y >> 3;
+    uint8_t lastPage = y1 >> 3;
+    uint64_t window = (height == 64) ? ~(uint64_t)0 : ((((uint64_t)1 << height) - 1) << y);
+
+    /* Gather each column into one 64-bit word, shift it, scatter it back */
+    for (uint8_t col = x; col < x + width; col++) {
+        uint64_t column = 0;
+
+        for (uint8_t page = firstPage; page <= lastPage; page++) {
+            column |= (uint64_t)shadowFB[page * OLED_DISPLAY_WIDTH + col] << (page << 3);
+        }
+
+        uint64_t moved = (dy > 0) ? (column << dy) : (column >> -dy);
+        column = (column & ~window) | (moved & window);
+
+        for (uint8_t page = firstPage; page <= lastPage; page++) {
+            shadowFB[page * OLED_DISPLAY_WIDTH + col] = (uint8_t)(column >> (page << 3));
+        }
+    }
+
+    for (uint8_t page = firstPage; page <= lastPage; page++) {
+        markDirty(page, x, x + width - 1);
+    }
+}
+
+/*****************************************************************************
+** Function name:       blitColumns
+**
+** Description:         Writes a run of 8-pixel column bytes at any y.
+**                      Each column becomes one masked write to the page
+**                      holding its top, plus one to the page below when y
+**                      is not page aligned.
+**
+** Parameters:          x, y    - top of the first column
+**                      columns - column bytes, bit 0 at the top
+**                      width   - number of columns
+** Returned value:      None
+*****************************************************************************/
+static void blitColumns(uint8_t x, uint8_t y, const uint8_t *columns, uint8_t width)
+{
+    uint8_t page = y >> 3;
+    uint8_t shift = y & 0x07;
+    uint8_t *upper = &shadowFB[page * OLED_DISPLAY_WIDTH + x];
+
+    waitForFlush();
+
+    if (shift == 0) {
+        memcpy(upper, columns, width);
+        markDirty(page, x, x + width - 1);
+        return;
+    }
+
+    uint8_t *lower = upper + OLED_DISPLAY_WIDTH;
+    uint8_t upperMask = (uint8_t)(0xFF << shift);
+    uint8_t lowerMask = (uint8_t)(0xFF >> (8 - shift));
+
+    for (uint8_t col = 0; col < width; col++) {
+        upper[col] = (upper[col] & ~upperMask) | (uint8_t)(columns[col] << shift);
+        lower[col] = (lower[col] & ~lowerMask) | (uint8_t)(columns[col] >> (8 - shift));
+    }
+    markDirty(page, x, x + width - 1);
+    markDirty(page + 1, x, x + width - 1);
+}
+
+/*****************************************************************************
+** Function name:       display_putChar
+**
+** Description:         Draws one character cell (6x8) with its background.
+**
+** Parameters:          x, y - top left corner of the cell
+**                      ch   - ASCII character, unknown ones draw as blank
+**                      fg   - text color
+**                      bg   - background color
+** Returned value:      0 if the cell does not fit on the display, else 1
+*****************************************************************************/
+uint8_t display_putChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fg, oled_color_t bg)
+{
+    if ((x >= (OLED_DISPLAY_WIDTH - 8)) || (y >= (OLED_DISPLAY_HEIGHT - 8))) {
+        return 0;
+    }
+
+    if ((ch < 0x20) || (ch > 0x7F)) {
+        ch = 0x20;
+    }
+
+    const uint8_t *glyph = &fontColumns[(ch - 0x20) * FONT_GLYPH_WIDTH];
+    uint8_t fgBits = (fg > 0) ? 0xFF : 0x00;
+    uint8_t bgBits = (bg > 0) ? 0xFF : 0x00;
+    uint8_t cell[FONT_CELL_WIDTH];
+
+    for (uint8_t col = 0; col < FONT_GLYPH_WIDTH; col++) {
+        cell[col] = (glyph[col] & fgBits) | (~glyph[col] & bgBits);
+    }
+    cell[FONT_GLYPH_WIDTH] = bgBits;
+
+    blitColumns(x, y, cell, FONT_CELL_WIDTH);
+    return 1;
+}
+
+/*****************************************************************************
+** Function name:       display_putString
+**
+** Description:         Draws a string on a single text line. Stops at the
+**                      first character that does not fit.
+**
+** Parameters:          x, y - top left corner of the first cell
+**                      str  - null-terminated string
+**                      fg   - text color
+**                      bg   - background color
+** Returned value:      None
+*****************************************************************************/
+void display_putString(uint8_t x, uint8_t y, const char *str, oled_color_t fg, oled_color_t bg)
+{
+    while (*str != '\0') {
+        if (display_putChar(x, y, (uint8_t)*str++, fg, bg) == 0) {
+            break;
+        }
+        x += FONT_CELL_WIDTH;
+    }
+}
@@ -0,0 +1,29 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: OLED display driver with a RAM shadow of the panel. The
+ *                controller is brought up by oled_init(); after that all
+ *                drawing goes through this module. Drawing functions only
+ *                update the shadow, display_flush() makes it visible.
+ *
+ ******************************************************************************/
+
+#ifndef __DISPLAY_H
+#define __DISPLAY_H
+
+#include "oled.h"
+
+void display_init(void);
+void display_flush(void);
+uint32_t display_flushAsync(void);
+uint32_t display_getFlushRate(void);
+uint32_t display_measureFullFlush(void);
+void display_sleep(void);
+void display_wake(void);
+void display_putPixel(uint8_t x, uint8_t y, oled_color_t color);
+void display_clearScreen(oled_color_t color);
+void display_fillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, oled_color_t color);
+void display_scrollRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, int8_t dy);
+uint8_t display_putChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fg, oled_color_t bg);
+void display_putString(uint8_t x, uint8_t y, const char *str, oled_color_t fg, oled_color_t bg);
+
+#endif /* end __DISPLAY_H */
@@ -0,0 +1,95 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Deferred-formatting log ring, see dlog.h.
+ *
+ ******************************************************************************/
+
+#ifndef CLOCK_VIRTUAL
+
+#include "type.h"
+
+#include "atomic.h"
+#include "clock.h"
+#include "dlog.h"
+#include "serial.h"
+
+typedef struct {
+    uint16_t format;    /* offset of the format string in .logstr */
+    uint8_t argc;
+    uint32_t ms;
+    uint32_t args[DLOG_MAX_ARGS];
+} LogRecord;
+
+static LogRecord ring[DLOG_ENTRIES];
+
+/* Records ever reserved; the ring holds the last DLOG_ENTRIES of them */
+static volatile uint32_t head;
+
+/* Set while dumping, so the ring is not overwritten under the reader */
+static volatile uint8_t paused;
+
+/*****************************************************************************
+** Function name:       dlog_write
+**
+** Description:         Stores one log record, overwriting the oldest one
+**                      when the ring is full. Called through DLOG();
+**                      callable from interrupt handlers.
+**
+** Parameters:          format - .logstr offset of the format string
+**                      argc   - number of arguments, at most DLOG_MAX_ARGS
+**                      args   - raw argument values
+** Returned value:      None
+*****************************************************************************/
+void dlog_write(uint16_t format, uint8_t argc, const uint32_t *args)
+{
+    if (paused) {
+        return;
+    }
+    LogRecord *record = &ring[atomic_fetchAdd(&head, 1) & (DLOG_ENTRIES - 1)];
+
+    record->format = format;
+    record->argc = argc;
+    record->ms = clock_nowMs();
+    for (uint8_t i = 0; i < argc; i++) {
+        record->args[i] = args[i];
+    }
+}
+
+/*****************************************************************************
+** Function name:       dlog_dump
+**
+** Description:         Sends the ring over the serial link, oldest record
+**                      first, then empties it. Format, read by
+**                      tools/logdecode.py:
+**
+**                          log begin count=N lost=M
+**                          l <format hex> <ms> <argc> <arg hex>...
+**                          log end
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void dlog_dump(void)
+{
+    paused = 1;
+
+    uint32_t end = head;
+    uint32_t count = (end < DLOG_ENTRIES) ? end : DLOG_ENTRIES;
+
+    serial_printf("log begin count=%lu lost=%lu\r\n", (unsigned long)count,
+                  (unsigned long)(end - count));
+    for (uint32_t i = end - count; i != end; i++) {
+        const LogRecord *record = &ring[i & (DLOG_ENTRIES - 1)];
+        serial_printf("l %04x %lu %u", record->format, (unsigned long)record->ms, record->argc);
+        for (uint8_t k = 0; k < record->argc; k++) {
+            serial_printf(" %lx", (unsigned long)record->args[k]);
+        }
+        serial_write("\r\n");
+    }
+    serial_write("log end\r\n");
+
+    head = 0;
+    paused = 0;
+}
+
+#endif /* CLOCK_VIRTUAL */
@@ -0,0 +1,60 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Deferred-formatting log. DLOG(fmt, ...) does no
+ *                formatting on the board: it stores the format string's
+ *                offset in the .logstr section, a millisecond time stamp
+ *                and up to DLOG_MAX_ARGS raw 32-bit arguments in a RAM
+ *                ring. .logstr is not allocated, so the strings cost no
+ *                flash; tools/logdecode.py reads them from the ELF file
+ *                and rebuilds the text from a serial dump of the ring.
+ *
+ *                Arguments must be integers or characters (%d %i %u %x
+ *                %X %o %c, with optional flags, width and l/h modifiers);
+ *                %s and floating point are not supported. Format strings
+ *                carry no trailing newline.
+ *
+ *                Built with CLOCK_VIRTUAL, all calls compile away.
+ *
+ ******************************************************************************/
+
+#ifndef __DLOG_H
+#define __DLOG_H
+
+#define DLOG_MAX_ARGS       4
+
+/* Ring size in records, a power of two; 24 bytes of RAM each */
+#ifndef DLOG_ENTRIES
+#define DLOG_ENTRIES        32
+#endif
+
+/* Number of variadic arguments, 0 to 8 */
+#define DLOG_NARGS(...)     DLOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...)  n
+
+#ifndef CLOCK_VIRTUAL
+
+/*
+ * Non-allocated section: the trailing '@' comments out the flags GCC
+ * appends to the .section directive, so the assembler sees no "a" flag.
+ */
+#define DLOG_SECTION        ".logstr,\"\",%progbits @"
+
+#define DLOG(fmt, ...) do {                                                     \
+    static const char dlogFormat[] __attribute__((section(DLOG_SECTION), used)) = fmt; \
+    const uint32_t dlogArgs[] = { 0, ##__VA_ARGS__ };                           \
+    typedef char dlogTooManyArgs[(DLOG_NARGS(__VA_ARGS__) <= DLOG_MAX_ARGS) ? 1 : -1]; \
+    (void)sizeof(dlogTooManyArgs);                                              \
+    dlog_write((uint16_t)(uint32_t)dlogFormat, DLOG_NARGS(__VA_ARGS__), &dlogArgs[1]); \
+} while (0)
+
+void dlog_write(uint16_t format, uint8_t argc, const uint32_t *args);
+void dlog_dump(void);
+
+#else /* CLOCK_VIRTUAL */
+
+#define DLOG(fmt, ...)
+#define dlog_dump()
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __DLOG_H */
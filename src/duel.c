@@ -0,0 +1,442 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Head-to-head link protocol and clock synchronization,
+ *                see duel.h. The game flow of both roles is in main.c.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "clock.h"
+#include "dlog.h"
+#include "duel.h"
+#include "payload.h"
+#include "remote.h"
+
+/* Clock exchanges per sync burst; the fastest one is kept */
+#define DUEL_BURST              8
+
+/* Burst results kept for the drift fit */
+#define DUEL_FIT_POINTS         8
+
+/* Shortest span of the fit before a drift is estimated */
+#define DUEL_FIT_MIN_SPAN_US    1000000
+
+/* Crystal tolerances make anything beyond this a bad fit */
+#define DUEL_DRIFT_MAX_PPB      500000
+
+/* Reply timeouts: one clock exchange, other commands */
+#define DUEL_EXCHANGE_MS        20
+#define DUEL_REPLY_MS           100
+
+/* Leader: offset samples of the drift fit, oldest overwritten first */
+static uint64_t fitRefUs[DUEL_FIT_POINTS];
+static int64_t fitOffsetUs[DUEL_FIT_POINTS];
+static duel_sync_t sync;
+
+/* Follower: state received from the leader */
+static uint8_t invited;
+static uint8_t roundReady;
+static uint8_t roundIndex;
+static uint64_t roundStimulusUs;
+static duel_click_t followerClick;
+static uint8_t outcomeReady;
+static duel_outcome_t outcomeReceived;
+
+/*****************************************************************************
+** Function name:       fitDrift
+**
+** Description:         Least-squares slope of the kept offsets over leader
+**                      time, relative to the oldest sample so the sums fit
+**                      in 64 bits.
+**
+** Parameters:          None
+** Returned value:      Drift in parts per billion, 0 while the samples
+**                      span too little time
+*****************************************************************************/
+static int32_t fitDrift(void)
+{
+    uint8_t n = (sync.samples < DUEL_FIT_POINTS) ? sync.samples : DUEL_FIT_POINTS;
+    uint8_t oldest = (sync.samples < DUEL_FIT_POINTS) ? 0 : (sync.samples % DUEL_FIT_POINTS);
+    int64_t sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+
+    if ((n < 2) || (sync.refUs - fitRefUs[oldest] < DUEL_FIT_MIN_SPAN_US)) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        int64_t x = (int64_t)(fitRefUs[i] - fitRefUs[oldest]);
+        int64_t y = fitOffsetUs[i] - fitOffsetUs[oldest];
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+
+    int64_t sxx = (n * sumXX - sumX * sumX) / 1000000;
+    int64_t sxy = n * sumXY - sumX * sumY;
+    if (sxx <= 0) {
+        return 0;
+    }
+    int64_t ppb = sxy * 1000 / sxx;
+    if ((ppb > DUEL_DRIFT_MAX_PPB) || (ppb < -DUEL_DRIFT_MAX_PPB)) {
+        return 0;
+    }
+    return (int32_t)ppb;
+}
+
+/*****************************************************************************
+** Function name:       duel_invite
+**
+** Description:         Asks the board at the other end of the link to
+**                      follow a duel and forgets earlier clock samples.
+**
+** Parameters:          None
+** Returned value:      0, or a REMOTE_ERR_* code
+*****************************************************************************/
+uint8_t duel_invite(void)
+{
+    uint8_t reply[REMOTE_PAYLOAD_MAX];
+
+    sync.samples = 0;
+    sync.driftPpb = 0;
+    return remote_request(REMOTE_CMD_DUEL_JOIN, NULL, 0, reply, NULL, DUEL_REPLY_MS);
+}
+
+/*****************************************************************************
+** Function name:       duel_sync
+**
+** Description:         Runs a burst of clock exchanges, keeps the one with
+**                      the shortest round trip and refits the drift.
+**
+** Parameters:          None
+** Returned value:      0, or REMOTE_ERR_TIMEOUT if no exchange completed
+*****************************************************************************/
+uint8_t duel_sync(void)
+{
+    uint8_t request[8];
+    uint8_t reply[REMOTE_PAYLOAD_MAX];
+    uint8_t replyLen;
+    uint32_t bestRoundTripUs = DUEL_NO_TIME;
+    uint64_t bestRefUs = 0;
+    int64_t bestOffsetUs = 0;
+
+    for (uint8_t i = 0; i < DUEL_BURST; i++) {
+        uint64_t t1 = clock_nowUs();
+        payload_putU64(request, t1);
+        if ((remote_request(REMOTE_CMD_CLOCK, request, sizeof(request), reply, &replyLen,
+                            DUEL_EXCHANGE_MS) != 0) || (replyLen != 8)) {
+            continue;
+        }
+        uint64_t t4 = clock_nowUs();
+        uint64_t t2 = payload_getU64(reply);
+
+        if (t4 - t1 < bestRoundTripUs) {
+            bestRoundTripUs = (uint32_t)(t4 - t1);
+            bestRefUs = t1 + (t4 - t1) / 2;
+            bestOffsetUs = (int64_t)(t2 - bestRefUs);
+        }
+    }
+    if (bestRoundTripUs == DUEL_NO_TIME) {
+        return REMOTE_ERR_TIMEOUT;
+    }
+
+    fitRefUs[sync.samples % DUEL_FIT_POINTS] = bestRefUs;
+    fitOffsetUs[sync.samples % DUEL_FIT_POINTS] = bestOffsetUs;
+    sync.samples++;
+    sync.refUs = bestRefUs;
+    sync.offsetUs = bestOffsetUs;
+    sync.errorUs = bestRoundTripUs / 2;
+    sync.driftPpb = fitDrift();
+    DLOG("duel sync: offset %ld us, error %lu us, drift %ld ppb", (int32_t)sync.offsetUs,
+         sync.errorUs, sync.driftPpb);
+    return 0;
+}
+
+/*****************************************************************************
+** Function name:       duel_getSync
+**
+** Description:         Current clock estimate, valid after duel_sync().
+**
+** Parameters:          None
+** Returned value:      Offset, drift and error bound
+*****************************************************************************/
+const duel_sync_t *duel_getSync(void)
+{
+    return &sync;
+}
+
+/*****************************************************************************
+** Function name:       duel_toFollowerUs
+**
+** Description:         Converts a leader time stamp to the follower's
+**                      clock, extrapolating the latest offset by the drift.
+**
+** Parameters:          leaderUs - leader clock_nowUs() time
+** Returned value:      Same instant on the follower's clock
+*****************************************************************************/
+uint64_t duel_toFollowerUs(uint64_t leaderUs)
+{
+    int64_t sinceUs = (int64_t)(leaderUs - sync.refUs);
+
+    return leaderUs + sync.offsetUs + sinceUs * sync.driftPpb / 1000000000;
+}
+
+/*****************************************************************************
+** Function name:       duel_toLeaderUs
+**
+** Description:         Converts a follower time stamp to the leader's
+**                      clock.
+**
+** Parameters:          followerUs - follower clock_nowUs() time
+** Returned value:      Same instant on the leader's clock
+*****************************************************************************/
+uint64_t duel_toLeaderUs(uint64_t followerUs)
+{
+    uint64_t leaderUs = followerUs - sync.offsetUs;
+
+    return followerUs - (duel_toFollowerUs(leaderUs) - leaderUs);
+}
+
+/*****************************************************************************
+** Function name:       duel_schedule
+**
+** Description:         Tells the follower when to show the stimulus of a
+**                      round.
+**
+** Parameters:          round      - round number
+**                      stimulusUs - stimulus time on the leader's clock
+** Returned value:      0, or a REMOTE_ERR_* code
+*****************************************************************************/
+uint8_t duel_schedule(uint8_t round, uint64_t stimulusUs)
+{
+    uint8_t request[9];
+    uint8_t reply[REMOTE_PAYLOAD_MAX];
+
+    request[0] = round;
+    payload_putU64(&request[1], duel_toFollowerUs(stimulusUs));
+    return remote_request(REMOTE_CMD_DUEL_ROUND, request, sizeof(request), reply, NULL,
+                          DUEL_REPLY_MS);
+}
+
+/*****************************************************************************
+** Function name:       duel_getFollowerClick
+**
+** Description:         Asks the follower for its click of the current
+**                      round.
+**
+** Parameters:          click - state and time stamp on the leader's clock
+** Returned value:      0, or a REMOTE_ERR_* code
+*****************************************************************************/
+uint8_t duel_getFollowerClick(duel_click_t *click)
+{
+    uint8_t reply[REMOTE_PAYLOAD_MAX];
+    uint8_t replyLen;
+    uint8_t error = remote_request(REMOTE_CMD_DUEL_CLICK, NULL, 0, reply, &replyLen,
+                                   DUEL_REPLY_MS);
+
+    if ((error == 0) && (replyLen != 9)) {
+        error = REMOTE_ERR_LENGTH;
+    }
+    if (error != 0) {
+        return error;
+    }
+    click->state = reply[0];
+    click->us = duel_toLeaderUs(payload_getU64(&reply[1]));
+    return 0;
+}
+
+/*****************************************************************************
+** Function name:       duel_judge
+**
+** Description:         Decides a round from the two click time stamps,
+**                      both on the leader's clock. Clicks closer than the
+**                      clock error bound tie.
+**
+** Parameters:          round      - round number
+**                      stimulusUs - stimulus time on the leader's clock
+**                      leader     - leader's click
+**                      follower   - follower's click
+**                      outcome    - filled in
+** Returned value:      None
+*****************************************************************************/
+void duel_judge(uint8_t round, uint64_t stimulusUs, const duel_click_t *leader,
+                const duel_click_t *follower, duel_outcome_t *outcome)
+{
+    uint8_t leaderValid = (leader->state == DUEL_CLICK_DONE);
+    uint8_t followerValid = (follower->state == DUEL_CLICK_DONE);
+
+    outcome->round = round;
+    outcome->leaderUs = leaderValid ? (uint32_t)(leader->us - stimulusUs) : DUEL_NO_TIME;
+    outcome->followerUs = DUEL_NO_TIME;
+    if (followerValid) {
+        /* Clock error may place a fast click just before the stimulus */
+        outcome->followerUs = (follower->us > stimulusUs) ? (uint32_t)(follower->us - stimulusUs) : 0;
+    }
+
+    if (leaderValid && followerValid) {
+        int64_t leadUs = (int64_t)(follower->us - leader->us);
+        if ((leadUs <= (int64_t)sync.errorUs) && (leadUs >= -(int64_t)sync.errorUs)) {
+            outcome->winner = DUEL_TIE;
+        } else {
+            outcome->winner = (leadUs > 0) ? DUEL_WIN_LEADER : DUEL_WIN_FOLLOWER;
+        }
+    } else if (leaderValid) {
+        outcome->winner = DUEL_WIN_LEADER;
+    } else if (followerValid) {
+        outcome->winner = DUEL_WIN_FOLLOWER;
+    } else {
+        outcome->winner = DUEL_NO_WINNER;
+    }
+}
+
+/*****************************************************************************
+** Function name:       duel_sendOutcome
+**
+** Description:         Tells the follower how a round ended.
+**
+** Parameters:          outcome - judged round
+** Returned value:      0, or a REMOTE_ERR_* code
+*****************************************************************************/
+uint8_t duel_sendOutcome(const duel_outcome_t *outcome)
+{
+    uint8_t request[10];
+    uint8_t reply[REMOTE_PAYLOAD_MAX];
+
+    request[0] = outcome->round;
+    request[1] = outcome->winner;
+    payload_putU32(&request[2], outcome->leaderUs);
+    payload_putU32(&request[6], outcome->followerUs);
+    return remote_request(REMOTE_CMD_DUEL_OUTCOME, request, sizeof(request), reply, NULL,
+                          DUEL_REPLY_MS);
+}
+
+/*****************************************************************************
+** Function name:       duel_command
+**
+** Description:         Follower side of the link commands, called from
+**                      the game's remote-control handler.
+**
+** Parameters:          cmd      - REMOTE_CMD_DUEL_* command
+**                      payload  - command payload
+**                      len      - payload length
+**                      reply    - reply payload to fill
+**                      replyLen - reply payload length
+** Returned value:      0, or a REMOTE_ERR_* code
+*****************************************************************************/
+uint8_t duel_command(uint8_t cmd, const uint8_t *payload, uint8_t len,
+                     uint8_t *reply, uint8_t *replyLen)
+{
+    switch (cmd) {
+    case REMOTE_CMD_DUEL_JOIN:
+        invited = 1;
+        roundReady = 0;
+        outcomeReady = 0;
+        return 0;
+
+    case REMOTE_CMD_DUEL_ROUND:
+        if (len != 9) {
+            return REMOTE_ERR_LENGTH;
+        }
+        roundIndex = payload[0];
+        roundStimulusUs = payload_getU64(&payload[1]);
+        followerClick.state = DUEL_CLICK_PENDING;
+        roundReady = 1;
+        return 0;
+
+    case REMOTE_CMD_DUEL_CLICK:
+        reply[0] = followerClick.state;
+        payload_putU64(&reply[1], followerClick.us);
+        *replyLen = 9;
+        return 0;
+
+    case REMOTE_CMD_DUEL_OUTCOME:
+        if (len != 10) {
+            return REMOTE_ERR_LENGTH;
+        }
+        outcomeReceived.round = payload[0];
+        outcomeReceived.winner = payload[1];
+        outcomeReceived.leaderUs = payload_getU32(&payload[2]);
+        outcomeReceived.followerUs = payload_getU32(&payload[6]);
+        outcomeReady = 1;
+        return 0;
+    }
+    return REMOTE_ERR_UNKNOWN;
+}
+
+/*****************************************************************************
+** Function name:       duel_isInvited
+**
+** Description:         Whether a leader has asked this board to follow.
+**
+** Parameters:          None
+** Returned value:      1 if invited
+*****************************************************************************/
+uint8_t duel_isInvited(void)
+{
+    return invited;
+}
+
+/*****************************************************************************
+** Function name:       duel_acceptInvite
+**
+** Description:         Starts following: clears the invitation.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void duel_acceptInvite(void)
+{
+    invited = 0;
+}
+
+/*****************************************************************************
+** Function name:       duel_takeRound
+**
+** Description:         Takes the round the leader scheduled, if any.
+**
+** Parameters:          round      - round number
+**                      stimulusUs - stimulus time on this board's clock
+** Returned value:      1 if a round was scheduled since the last call
+*****************************************************************************/
+uint8_t duel_takeRound(uint8_t *round, uint64_t *stimulusUs)
+{
+    if (!roundReady) {
+        return 0;
+    }
+    roundReady = 0;
+    *round = roundIndex;
+    *stimulusUs = roundStimulusUs;
+    return 1;
+}
+
+/*****************************************************************************
+** Function name:       duel_setClick
+**
+** Description:         Records this board's click for the leader to
+**                      collect.
+**
+** Parameters:          click - state and time stamp on this board's clock
+** Returned value:      None
+*****************************************************************************/
+void duel_setClick(const duel_click_t *click)
+{
+    followerClick = *click;
+}
+
+/*****************************************************************************
+** Function name:       duel_takeOutcome
+**
+** Description:         Takes the leader's verdict on the round, if any.
+**
+** Parameters:          outcome - filled in
+** Returned value:      1 if an outcome arrived since the last call
+*****************************************************************************/
+uint8_t duel_takeOutcome(duel_outcome_t *outcome)
+{
+    if (!outcomeReady) {
+        return 0;
+    }
+    outcomeReady = 0;
+    *outcome = outcomeReceived;
+    return 1;
+}
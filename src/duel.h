@@ -0,0 +1,93 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Head-to-head mode: two boards linked by their UARTs show
+ *                the same stimulus at the same instant and the earlier
+ *                click wins.
+ *
+ *                The leading board estimates the follower's clock NTP
+ *                style. It sends its time t1, the follower answers with
+ *                its own time t2 on receipt, the leader notes t4 when the
+ *                reply arrives. Both frames have the same length, so
+ *                transmission time cancels and the offset t2 - (t1+t4)/2
+ *                is good to half the round trip. Of each burst only the
+ *                exchange with the shortest round trip is kept; the drift
+ *                is the least-squares slope of those offsets over the
+ *                session. The leader schedules every stimulus in the
+ *                follower's time and judges the two click time stamps in
+ *                its own.
+ *
+ *                Built with CLOCK_VIRTUAL, two host instances talk over a
+ *                pseudo-terminal pair, in real-time mode with a simulated
+ *                clock skew (clock_setRealtime); host/test/duel_test.c runs
+ *                such a pair through five rounds.
+ *
+ ******************************************************************************/
+
+#ifndef __DUEL_H
+#define __DUEL_H
+
+#define DUEL_ROUNDS             5
+
+/* Link commands, sent by the leader (payloads in remote.h style) */
+#define REMOTE_CMD_DUEL_JOIN    0x20    /* invite the follower */
+#define REMOTE_CMD_DUEL_ROUND   0x21    /* round u8, stimulusUs u64 (follower time) */
+#define REMOTE_CMD_DUEL_CLICK   0x22    /* -> state u8, clickUs u64 (follower time) */
+#define REMOTE_CMD_DUEL_OUTCOME 0x23    /* round u8, winner u8, leaderUs u32, followerUs u32 */
+
+/* Click states */
+#define DUEL_CLICK_PENDING      0
+#define DUEL_CLICK_DONE         1
+#define DUEL_CLICK_EARLY        2       /* held from before the stimulus */
+#define DUEL_CLICK_MISSED       3
+
+/* Round winners */
+#define DUEL_WIN_LEADER         0
+#define DUEL_WIN_FOLLOWER       1
+#define DUEL_TIE                2       /* closer than the clock error bound */
+#define DUEL_NO_WINNER          3
+
+/* Reaction time of a click that does not count */
+#define DUEL_NO_TIME            0xFFFFFFFFUL
+
+typedef struct {
+    uint8_t state;              /* DUEL_CLICK_* */
+    uint64_t us;                /* click time stamp */
+} duel_click_t;
+
+typedef struct {
+    uint8_t round;
+    uint8_t winner;             /* DUEL_WIN_*, DUEL_TIE or DUEL_NO_WINNER */
+    uint32_t leaderUs;          /* reaction times, DUEL_NO_TIME if none */
+    uint32_t followerUs;
+} duel_outcome_t;
+
+typedef struct {
+    int64_t offsetUs;           /* follower minus leader clock at refUs */
+    uint64_t refUs;             /* leader time of the latest sample */
+    int32_t driftPpb;           /* follower minus leader rate */
+    uint32_t errorUs;           /* half the best round trip of the latest burst */
+    uint8_t samples;            /* bursts in the drift fit */
+} duel_sync_t;
+
+/* Leader */
+uint8_t duel_invite(void);
+uint8_t duel_sync(void);
+const duel_sync_t *duel_getSync(void);
+uint64_t duel_toFollowerUs(uint64_t leaderUs);
+uint64_t duel_toLeaderUs(uint64_t followerUs);
+uint8_t duel_schedule(uint8_t round, uint64_t stimulusUs);
+uint8_t duel_getFollowerClick(duel_click_t *click);
+void duel_judge(uint8_t round, uint64_t stimulusUs, const duel_click_t *leader,
+                const duel_click_t *follower, duel_outcome_t *outcome);
+uint8_t duel_sendOutcome(const duel_outcome_t *outcome);
+
+/* Follower */
+uint8_t duel_command(uint8_t cmd, const uint8_t *payload, uint8_t len,
+                     uint8_t *reply, uint8_t *replyLen);
+uint8_t duel_isInvited(void);
+void duel_acceptInvite(void);
+uint8_t duel_takeRound(uint8_t *round, uint64_t *stimulusUs);
+void duel_setClick(const duel_click_t *click);
+uint8_t duel_takeOutcome(duel_outcome_t *outcome);
+
+#endif /* end __DUEL_H */
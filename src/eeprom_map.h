@@ -0,0 +1,24 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Layout of the persistent data kept in the 24LC08B EEPROM
+ *                (1024 bytes, 16-byte write pages).
+ *
+ ******************************************************************************/
+
+#ifndef __EEPROM_MAP_H
+#define __EEPROM_MAP_H
+
+#define EEPROM_PAGE_SIZE        16
+
+/* High score, 2 bytes big-endian (milliseconds) */
+#define EEPROM_HIGH_SCORE_ADDR  8
+
+/* Accelerometer calibration record, see TILT_CAL_SIZE */
+#define EEPROM_TILT_CAL_ADDR    16
+
+/* Lifetime histogram: header page, then one page per 8 big-endian bins */
+#define EEPROM_LIFETIME_HDR_ADDR    32
+#define EEPROM_LIFETIME_BINS_ADDR   48
+#define EEPROM_LIFETIME_BINS_PAGES  4
+
+#endif /* end __EEPROM_MAP_H */
@@ -0,0 +1,184 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Streaming ex-Gaussian estimate of reaction times. Adding
+ *                a result updates exact integer sums of x, x^2 and x^3
+ *                (a few integer multiply-adds). An estimate converts them
+ *                to central moments in single-precision float and solves
+ *                the method-of-moments equations
+ *
+ *                    mean = mu + tau, m2 = sigma^2 + tau^2, m3 = 2 tau^3
+ *
+ *                with fixed-iteration roots, so its cost is bounded and
+ *                no libm is needed.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "exgauss.h"
+
+/* Results are clamped so that n * x^3 cannot overflow 64 bits */
+#define EXGAUSS_MAX_MS      10000
+#define EXGAUSS_MAX_COUNT   0xFFFF
+
+/* Newton steps after the power-of-two starting guess */
+#define ROOT_ITERATIONS     8
+
+typedef struct {
+    uint16_t count;
+    uint32_t sum1;
+    uint64_t sum2;
+    uint64_t sum3;
+} Moments;
+
+static Moments players[EXGAUSS_PLAYERS];
+
+/*****************************************************************************
+** Function name:       squareRoot
+**
+** Description:         Square root by Newton's method from the first power
+**                      of two above the result, which converges from above.
+**
+** Parameters:          v - non-negative value
+** Returned value:      sqrt(v)
+*****************************************************************************/
+static float squareRoot(float v)
+{
+    float y = 1.0f;
+
+    if (v <= 0.0f) {
+        return 0.0f;
+    }
+    while (y * y < v) {
+        y *= 2.0f;
+    }
+    for (uint8_t i = 0; i < ROOT_ITERATIONS; i++) {
+        y = 0.5f * (y + v / y);
+    }
+    return y;
+}
+
+/*****************************************************************************
+** Function name:       cubeRoot
+**
+** Description:         Cube root by Newton's method, started like
+**                      squareRoot().
+**
+** Parameters:          v - non-negative value
+** Returned value:      cbrt(v)
+*****************************************************************************/
+static float cubeRoot(float v)
+{
+    float y = 1.0f;
+
+    if (v <= 0.0f) {
+        return 0.0f;
+    }
+    while (y * y * y < v) {
+        y *= 2.0f;
+    }
+    for (uint8_t i = 0; i < ROOT_ITERATIONS; i++) {
+        y = (2.0f * y + v / (y * y)) / 3.0f;
+    }
+    return y;
+}
+
+/*****************************************************************************
+** Function name:       exgauss_addResult
+**
+** Description:         Adds a reaction time to a player's sums. Stops
+**                      counting once the count saturates.
+**
+** Parameters:          player - player slot
+**                      ms     - reaction time in milliseconds
+** Returned value:      None
+*****************************************************************************/
+void exgauss_addResult(uint8_t player, uint32_t ms)
+{
+    Moments *m = &players[player % EXGAUSS_PLAYERS];
+    uint64_t x = (ms > EXGAUSS_MAX_MS) ? EXGAUSS_MAX_MS : ms;
+
+    if (m->count == EXGAUSS_MAX_COUNT) {
+        return;
+    }
+    m->count++;
+    m->sum1 += (uint32_t)x;
+    m->sum2 += x * x;
+    m->sum3 += x * x * x;
+}
+
+/*****************************************************************************
+** Function name:       exgauss_reset
+**
+** Description:         Forgets all results of a player.
+**
+** Parameters:          player - player slot
+** Returned value:      None
+*****************************************************************************/
+void exgauss_reset(uint8_t player)
+{
+    Moments *m = &players[player % EXGAUSS_PLAYERS];
+
+    m->count = 0;
+    m->sum1 = 0;
+    m->sum2 = 0;
+    m->sum3 = 0;
+}
+
+/*****************************************************************************
+** Function name:       exgauss_getCount
+**
+** Description:         Number of results of a player.
+**
+** Parameters:          player - player slot
+** Returned value:      Result count
+*****************************************************************************/
+uint16_t exgauss_getCount(uint8_t player)
+{
+    return players[player % EXGAUSS_PLAYERS].count;
+}
+
+/*****************************************************************************
+** Function name:       exgauss_estimate
+**
+** Description:         Method-of-moments ex-Gaussian fit of a player's
+**                      results. Negative skew gives tau = 0. Skew beyond
+**                      what the model allows is capped at tau^2 = 8/9 of
+**                      the variance, so sigma stays at least a third of
+**                      the standard deviation.
+**
+** Parameters:          player - player slot
+**                      params - receives mu, sigma and tau in ms
+** Returned value:      1 on success, 0 if there are too few results
+*****************************************************************************/
+uint8_t exgauss_estimate(uint8_t player, exgauss_params_t *params)
+{
+    const Moments *m = &players[player % EXGAUSS_PLAYERS];
+
+    if (m->count < EXGAUSS_MIN_SAMPLES) {
+        return 0;
+    }
+
+    float n = (float)m->count;
+    float mean = (float)m->sum1 / n;
+    float raw2 = (float)m->sum2 / n;
+    float raw3 = (float)m->sum3 / n;
+
+    float m2 = raw2 - mean * mean;
+    float m3 = raw3 - 3.0f * mean * raw2 + 2.0f * mean * mean * mean;
+    if (m2 < 0.0f) {
+        m2 = 0.0f;
+    }
+
+    float tau = cubeRoot(0.5f * m3);
+    if (tau * tau > m2 * (8.0f / 9.0f)) {
+        tau = squareRoot(m2 * (8.0f / 9.0f));
+    }
+    float sigma = squareRoot(m2 - tau * tau);
+    float mu = mean - tau;
+
+    params->mu = (mu > 0.0f) ? (uint16_t)(mu + 0.5f) : 0;
+    params->sigma = (uint16_t)(sigma + 0.5f);
+    params->tau = (uint16_t)(tau + 0.5f);
+    return 1;
+}
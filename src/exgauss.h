@@ -0,0 +1,29 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Streaming ex-Gaussian estimate of reaction times per
+ *                player. Exact integer power sums are kept per result;
+ *                mu, sigma and tau are derived on request by the method
+ *                of moments.
+ *
+ ******************************************************************************/
+
+#ifndef __EXGAUSS_H
+#define __EXGAUSS_H
+
+#define EXGAUSS_PLAYERS         4
+
+/* Fewer results give no meaningful third moment */
+#define EXGAUSS_MIN_SAMPLES     10
+
+typedef struct {
+    uint16_t mu;        /* Gaussian mean, ms */
+    uint16_t sigma;     /* Gaussian standard deviation, ms */
+    uint16_t tau;       /* exponential mean, ms */
+} exgauss_params_t;
+
+void exgauss_addResult(uint8_t player, uint32_t ms);
+void exgauss_reset(uint8_t player);
+uint16_t exgauss_getCount(uint8_t player);
+uint8_t exgauss_estimate(uint8_t player, exgauss_params_t *params);
+
+#endif /* end __EXGAUSS_H */
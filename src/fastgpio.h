@@ -0,0 +1,57 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Single-store GPIO pin access through the LPC13xx masked
+ *                DATA address window. With constant port/pin arguments each
+ *                operation compiles to one store to a constant address, so
+ *                no read-modify-write of DATA and no out-of-line call.
+ *
+ *   Note: GPIOSetValue() keeps no shadow; it does a read-modify-write of
+ *         LPC_GPIOn->DATA. Mixing it with these macros from thread code is
+ *         safe. The hazard is an interrupt handler that changes a pin of
+ *         the same port (by its own read-modify-write) between that read
+ *         and write: the write-back restores the old level. Ports that an
+ *         ISR drives must use these single-store macros everywhere.
+ *
+ ******************************************************************************/
+
+#ifndef __FASTGPIO_H
+#define __FASTGPIO_H
+
+#ifndef CLOCK_VIRTUAL
+
+/* GPIO port blocks are 64 KB apart on the AHB */
+#define FASTGPIO_PORT_BASE(port)    (0x50000000UL + ((uint32_t)(port) << 16))
+
+#else /* CLOCK_VIRTUAL */
+
+/* Host: port blocks are arrays of the board model, pin n is word 1 << n */
+extern volatile uint32_t hostGpio[4][0x1000];
+#define FASTGPIO_PORT_BASE(port)    ((uintptr_t)hostGpio[(port)])
+
+#endif /* CLOCK_VIRTUAL */
+
+/* Address bits [13:2] select the pins a DATA access is allowed to touch */
+#define FASTGPIO_MASKED(port, bit)  (*(volatile uint32_t *)(FASTGPIO_PORT_BASE(port) + \
+                                                             ((0x1UL << (bit)) << 2)))
+
+#define FASTGPIO_HIGH(port, bit)    (FASTGPIO_MASKED(port, bit) = 0xFFF)
+#define FASTGPIO_LOW(port, bit)     (FASTGPIO_MASKED(port, bit) = 0)
+#define FASTGPIO_READ(port, bit)    (FASTGPIO_MASKED(port, bit) != 0)
+
+/*****************************************************************************
+** Function name:       fastgpio_write
+**
+** Description:         Drives a single pin with one store. Folds to a
+**                      constant address when port and pin are constants.
+**
+** Parameters:          port  - GPIO port number (PORT0..PORT3)
+**                      bit   - pin number within the port
+**                      value - 0 for low, anything else for high
+** Returned value:      None
+*****************************************************************************/
+static inline void fastgpio_write(uint32_t port, uint32_t bit, uint32_t value)
+{
+    FASTGPIO_MASKED(port, bit) = value ? 0xFFF : 0;
+}
+
+#endif /* end __FASTGPIO_H */
@@ -0,0 +1,102 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Joystick input of the game, from the joystick driver or
+ *                from a scripted source in simulated time that also
+ *                follows stimulus and result events.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "clock.h"
+#include "latency.h"
+#include "input.h"
+#include "remote.h"
+
+#ifndef CLOCK_VIRTUAL
+
+#include "joystick.h"
+
+/*****************************************************************************
+** Function name:       input_read
+**
+** Description:         Reads the joystick, together with any keys a test
+**                      rig holds over the remote-control link.
+**
+** Parameters:          None
+** Returned value:      JOYSTICK_* bits of the directions held
+*****************************************************************************/
+uint8_t input_read(void)
+{
+    remote_poll();
+    return joystick_read() | remote_getKeys();
+}
+
+#else /* CLOCK_VIRTUAL */
+
+/* Scripted input, nothing held when unset */
+static const input_source_t *inputSource;
+
+/*****************************************************************************
+** Function name:       input_setSource
+**
+** Description:         Installs the scripted input of a simulated run.
+**
+** Parameters:          source - input script, NULL for no input
+** Returned value:      None
+*****************************************************************************/
+void input_setSource(const input_source_t *source)
+{
+    inputSource = source;
+}
+
+/*****************************************************************************
+** Function name:       input_read
+**
+** Description:         Asks the script for the input held at the current
+**                      simulated time. Sampling input ends the handling
+**                      of the last event for the latency harness. Keys
+**                      held over the remote-control link are added.
+**
+** Parameters:          None
+** Returned value:      JOYSTICK_* bits of the directions held
+*****************************************************************************/
+uint8_t input_read(void)
+{
+    latency_poll();
+    remote_poll();
+    return ((inputSource != NULL) ? inputSource->read(clock_nowMs()) : 0) | remote_getKeys();
+}
+
+/*****************************************************************************
+** Function name:       input_stimulus
+**
+** Description:         Tells the script that the stimulus is now visible.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void input_stimulus(void)
+{
+    if ((inputSource != NULL) && (inputSource->stimulus != NULL)) {
+        inputSource->stimulus(clock_nowMs());
+    }
+}
+
+/*****************************************************************************
+** Function name:       input_result
+**
+** Description:         Tells the script what reaction time the game
+**                      measured.
+**
+** Parameters:          ms - measured reaction time
+** Returned value:      None
+*****************************************************************************/
+void input_result(uint32_t ms)
+{
+    if ((inputSource != NULL) && (inputSource->result != NULL)) {
+        inputSource->result(ms);
+    }
+}
+
+#endif /* CLOCK_VIRTUAL */
@@ -0,0 +1,38 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Joystick input of the game. On the board this reads the
+ *                joystick; built with CLOCK_VIRTUAL it asks a scripted
+ *                source for the state at the current simulated time and
+ *                tells it when a stimulus is shown and what was measured.
+ *
+ ******************************************************************************/
+
+#ifndef __INPUT_H
+#define __INPUT_H
+
+uint8_t input_read(void);
+
+#ifndef CLOCK_VIRTUAL
+
+/* Only a scripted source needs to follow the game */
+#define input_stimulus()
+#define input_result(ms)
+
+#else /* CLOCK_VIRTUAL */
+
+typedef struct {
+    /* Returns the JOYSTICK_* bits held at simulated time nowMs */
+    uint8_t (*read)(uint32_t nowMs);
+    /* Stimulus became visible at nowMs */
+    void (*stimulus)(uint32_t nowMs);
+    /* Reaction time the game measured for the last stimulus */
+    void (*result)(uint32_t ms);
+} input_source_t;
+
+void input_setSource(const input_source_t *source);
+void input_stimulus(void);
+void input_result(uint32_t ms);
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __INPUT_H */
@@ -0,0 +1,46 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Interrupt priority plan, see irqprio.h.
+ *
+ ******************************************************************************/
+
+#ifndef CLOCK_VIRTUAL
+
+#include "mcu_regs.h"
+#include "type.h"
+
+#include "perf.h"
+#include "irqprio.h"
+
+/* Device interrupts are numbered 0 to EINT0_IRQn on the LPC1343 */
+#define DEVICE_IRQ_COUNT    (EINT0_IRQn + 1)
+
+volatile uint32_t irqMaskMaxCycles;
+uint32_t irqMaskStart;
+
+/*****************************************************************************
+** Function name:       irqprio_init
+**
+** Description:         Applies the priority plan. Call before any
+**                      interrupt is enabled.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void irqprio_init(void)
+{
+    for (int32_t irq = 0; irq < DEVICE_IRQ_COUNT; irq++) {
+        NVIC_SetPriority((IRQn_Type)irq, IRQ_PRIO_OTHER);
+    }
+
+    NVIC_SetPriority(EINT2_IRQn, IRQ_PRIO_CAPTURE);
+    NVIC_SetPriority(TIMER_32_1_IRQn, IRQ_PRIO_AUDIO);
+    NVIC_SetPriority(SysTick_IRQn, IRQ_PRIO_TICK);
+    NVIC_SetPriority(SSP_IRQn, IRQ_PRIO_BUS);
+    NVIC_SetPriority(I2C_IRQn, IRQ_PRIO_BUS);
+    NVIC_SetPriority(UART_IRQn, IRQ_PRIO_SERIAL);
+
+    irqMaskMaxCycles = 0;
+}
+
+#endif /* CLOCK_VIRTUAL */
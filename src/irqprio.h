@@ -0,0 +1,88 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Interrupt priority plan. The LPC1343 implements three
+ *                priority bits (0 most urgent, 7 least). Response capture
+ *                outranks everything so a click is time stamped on the
+ *                edge, whatever else is running; the audio sample timer
+ *                comes next so notes do not jitter; bus and serial
+ *                handlers are free to wait.
+ *
+ *                Critical sections use BASEPRI, not PRIMASK: they mask
+ *                from a given level down and never hold off capture. The
+ *                longest outermost section is recorded in core cycles.
+ *
+ ******************************************************************************/
+
+#ifndef __IRQPRIO_H
+#define __IRQPRIO_H
+
+#define IRQ_PRIO_CAPTURE    0   /* PIOINT2: joystick center edge */
+#define IRQ_PRIO_AUDIO      1   /* TIMER32_1: audio sample timer */
+#define IRQ_PRIO_TICK       2   /* SysTick: millisecond clock */
+#define IRQ_PRIO_BUS        4   /* SSP, I2C */
+#define IRQ_PRIO_SERIAL     5   /* UART */
+#define IRQ_PRIO_OTHER      6   /* all remaining interrupts */
+
+/* BASEPRI value that masks the given priority and everything below it */
+#define IRQ_BASEPRI(prio)   ((uint32_t)(prio) << (8 - __NVIC_PRIO_BITS))
+
+#ifndef CLOCK_VIRTUAL
+
+/* Longest outermost critical section so far, in core cycles */
+extern volatile uint32_t irqMaskMaxCycles;
+extern uint32_t irqMaskStart;
+
+void irqprio_init(void);
+
+#define irq_getMaskMaxCycles()  (irqMaskMaxCycles)
+
+/*****************************************************************************
+** Function name:       irq_maskFrom
+**
+** Description:         Enters a critical section: interrupts of the given
+**                      priority and below are held off, more urgent ones
+**                      still run. Sections nest; only the outermost one is
+**                      timed. Requires the DWT cycle counter (perf_init).
+**
+** Parameters:          prio - most urgent IRQ_PRIO_* level to mask
+** Returned value:      Previous mask, to pass to irq_unmask()
+*****************************************************************************/
+static inline uint32_t irq_maskFrom(uint8_t prio)
+{
+    uint32_t saved;
+
+    __asm volatile ("mrs %0, basepri" : "=r" (saved));
+    __asm volatile ("msr basepri_max, %0" : : "r" (IRQ_BASEPRI(prio)) : "memory");
+    if (saved == 0) {
+        irqMaskStart = PERF_CYCLES();
+    }
+    return saved;
+}
+
+/*****************************************************************************
+** Function name:       irq_unmask
+**
+** Description:         Leaves a critical section entered by irq_maskFrom().
+**
+** Parameters:          saved - value returned by irq_maskFrom()
+** Returned value:      None
+*****************************************************************************/
+static inline void irq_unmask(uint32_t saved)
+{
+    if (saved == 0) {
+        uint32_t held = PERF_CYCLES() - irqMaskStart;
+        if (held > irqMaskMaxCycles) {
+            irqMaskMaxCycles = held;
+        }
+    }
+    __asm volatile ("msr basepri, %0" : : "r" (saved) : "memory");
+}
+
+#else /* CLOCK_VIRTUAL */
+
+#define irqprio_init()
+#define irq_getMaskMaxCycles()  0
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __IRQPRIO_H */
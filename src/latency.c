@@ -0,0 +1,354 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Event-handling latency harness for simulated runs. Host
+ *                only: latencies are measured in simulated time, so they
+ *                cover every wait, note and delay a handler performs.
+ *
+ ******************************************************************************/
+
+#ifdef CLOCK_VIRTUAL
+
+#include "type.h"
+#include "joystick.h"
+
+#include "clock.h"
+#include "input.h"
+#include "latency.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Latency histogram resolution 1 ms, the last bin collects the rest */
+#define LATENCY_BINS        4096
+
+/* Trail entry kinds */
+#define TRAIL_INPUT         0   /* joystick state changed to code */
+#define TRAIL_EVENT         1   /* handling of event type code started */
+
+#define NO_EVENT            0xFF
+
+typedef struct {
+    uint32_t atMs;
+    uint8_t kind;
+    uint8_t code;
+} TrailEntry;
+
+typedef struct {
+    uint32_t count;
+    uint32_t maxUs;
+    uint32_t maxAtMs;
+    uint32_t bins[LATENCY_BINS];
+    TrailEntry trail[LATENCY_TRAIL];    // Oldest first
+    uint8_t trailLen;
+} EventStats;
+
+static const char *const eventNames[LATENCY_EVENT_TYPES] = {
+    "nav", "select", "click", "theme", "tilt", "wake"
+};
+
+static EventStats stats[LATENCY_EVENT_TYPES];
+
+/* Recent inputs and events, ring buffer */
+static TrailEntry ring[LATENCY_TRAIL];
+static uint8_t ringHead;
+static uint8_t ringLen;
+
+/* Event whose handling is in progress */
+static uint8_t openEvent = NO_EVENT;
+static uint64_t openStartUs;
+
+/* Fuzzing input source state */
+static latency_fuzz_t fuzz;
+static uint32_t rngState;
+static uint8_t heldKeys;
+static uint32_t nextChangeMs;
+
+/* End of the fuzzing run, and where the UI is left from when it is reached */
+static uint32_t runEndMs;
+static jmp_buf runEnd;
+
+/*****************************************************************************
+** Function name:       remember
+**
+** Description:         Appends an entry to the ring of recent activity.
+**
+** Parameters:          kind - TRAIL_INPUT or TRAIL_EVENT
+**                      code - joystick bits or event type
+** Returned value:      None
+*****************************************************************************/
+static void remember(uint8_t kind, uint8_t code)
+{
+    TrailEntry *entry = &ring[(ringHead + ringLen) % LATENCY_TRAIL];
+
+    entry->atMs = clock_nowMs();
+    entry->kind = kind;
+    entry->code = code;
+    if (ringLen < LATENCY_TRAIL) {
+        ringLen++;
+    } else {
+        ringHead = (ringHead + 1) % LATENCY_TRAIL;
+    }
+}
+
+/*****************************************************************************
+** Function name:       closeEvent
+**
+** Description:         Records the latency of the open event. A new
+**                      maximum keeps a copy of the recent activity.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void closeEvent(void)
+{
+    EventStats *s = &stats[openEvent];
+    uint32_t us = (uint32_t)(clock_nowUs() - openStartUs);
+    uint32_t bin = us / 1000;
+
+    s->count++;
+    s->bins[(bin < LATENCY_BINS) ? bin : (LATENCY_BINS - 1)]++;
+    if (us >= s->maxUs) {
+        s->maxUs = us;
+        s->maxAtMs = clock_nowMs();
+        for (uint8_t i = 0; i < ringLen; i++) {
+            s->trail[i] = ring[(ringHead + i) % LATENCY_TRAIL];
+        }
+        s->trailLen = ringLen;
+    }
+    openEvent = NO_EVENT;
+}
+
+/*****************************************************************************
+** Function name:       latency_event
+**
+** Description:         Marks the start of an event's handling. An event
+**                      still open ends here.
+**
+** Parameters:          type - LATENCY_* event type
+** Returned value:      None
+*****************************************************************************/
+void latency_event(uint8_t type)
+{
+    if (openEvent != NO_EVENT) {
+        closeEvent();
+    }
+    openEvent = type;
+    openStartUs = clock_nowUs();
+    remember(TRAIL_EVENT, type);
+}
+
+/*****************************************************************************
+** Function name:       latency_poll
+**
+** Description:         Input is being sampled: ends the open event.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void latency_poll(void)
+{
+    if (openEvent != NO_EVENT) {
+        closeEvent();
+    }
+}
+
+/*****************************************************************************
+** Function name:       latency_reset
+**
+** Description:         Clears all statistics and the activity ring.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void latency_reset(void)
+{
+    memset(stats, 0, sizeof(stats));
+    ringHead = 0;
+    ringLen = 0;
+    openEvent = NO_EVENT;
+}
+
+/*****************************************************************************
+** Function name:       latency_getCount
+**
+** Description:         Number of events of a type recorded since the last
+**                      reset.
+**
+** Parameters:          type - LATENCY_* event type
+** Returned value:      Event count
+*****************************************************************************/
+uint32_t latency_getCount(uint8_t type)
+{
+    return (type < LATENCY_EVENT_TYPES) ? stats[type].count : 0;
+}
+
+/*****************************************************************************
+** Function name:       nextRandom
+**
+** Description:         xorshift32 step.
+**
+** Parameters:          None
+** Returned value:      Next pseudo-random value
+*****************************************************************************/
+static uint32_t nextRandom(void)
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+/*****************************************************************************
+** Function name:       fuzzRead
+**
+** Description:         Input source: alternates random joystick directions
+**                      held for a random time with random idle gaps. Once
+**                      the run time is used up it ends the run: the UI is
+**                      left where it polls input, so the budget holds on
+**                      any screen, not only between ui() calls.
+**
+** Parameters:          nowMs - simulated time
+** Returned value:      JOYSTICK_* bits held
+*****************************************************************************/
+static uint8_t fuzzRead(uint32_t nowMs)
+{
+    static const uint8_t keys[] = {
+        JOYSTICK_CENTER, JOYSTICK_UP, JOYSTICK_DOWN, JOYSTICK_LEFT, JOYSTICK_RIGHT
+    };
+
+    if (nowMs >= runEndMs) {
+        longjmp(runEnd, 1);
+    }
+
+    if ((int32_t)(nowMs - nextChangeMs) >= 0) {
+        if (heldKeys != 0) {
+            heldKeys = 0;
+            nextChangeMs = nowMs + nextRandom() % (fuzz.gapMaxMs + 1);
+        } else {
+            heldKeys = keys[nextRandom() % sizeof(keys)];
+            nextChangeMs = nowMs + fuzz.holdMinMs +
+                           nextRandom() % (fuzz.holdMaxMs - fuzz.holdMinMs + 1);
+        }
+        remember(TRAIL_INPUT, heldKeys);
+    }
+    return heldKeys;
+}
+
+static const input_source_t fuzzSource = { fuzzRead, NULL, NULL };
+
+/*****************************************************************************
+** Function name:       latency_runFuzz
+**
+** Description:         Runs the UI against random input until the given
+**                      simulated time has passed. The UI function is called
+**                      again whenever it returns; the run ends at the
+**                      first input poll after the time is up, wherever
+**                      the UI is (see fuzzRead()).
+**
+** Parameters:          cfg         - fuzzing parameters
+**                      simulatedMs - simulated run time
+**                      ui          - UI entry point, e.g. show_main_menu
+** Returned value:      None
+*****************************************************************************/
+void latency_runFuzz(const latency_fuzz_t *cfg, uint32_t simulatedMs, void (*ui)(void))
+{
+    fuzz = *cfg;
+    if (fuzz.holdMaxMs < fuzz.holdMinMs) {
+        fuzz.holdMaxMs = fuzz.holdMinMs;
+    }
+    rngState = (fuzz.seed != 0) ? fuzz.seed : 1;
+    heldKeys = 0;
+    nextChangeMs = 0;
+
+    clock_init();
+    latency_reset();
+    runEndMs = simulatedMs;
+    input_setSource(&fuzzSource);
+
+    if (setjmp(runEnd) == 0) {
+        while (clock_nowMs() < simulatedMs) {
+            ui();
+        }
+    }
+    input_setSource(NULL);
+}
+
+/*****************************************************************************
+** Function name:       percentileMs
+**
+** Description:         Nearest-rank percentile from the 1 ms histogram.
+**
+** Parameters:          s       - event statistics
+**                      percent - 1-100
+** Returned value:      Latency in ms
+*****************************************************************************/
+static uint32_t percentileMs(const EventStats *s, uint8_t percent)
+{
+    uint32_t rank = (uint32_t)(((uint64_t)percent * s->count + 99) / 100);
+    uint32_t seen = 0;
+
+    for (uint32_t bin = 0; bin < LATENCY_BINS; bin++) {
+        seen += s->bins[bin];
+        if (seen >= rank) {
+            return bin;
+        }
+    }
+    return LATENCY_BINS - 1;
+}
+
+/*****************************************************************************
+** Function name:       latency_printReport
+**
+** Description:         Prints count, p50, p99 and max per event type, then
+**                      the event types with the largest maxima together
+**                      with the activity that preceded them.
+**
+** Parameters:          worstCount - number of worst event types to detail
+** Returned value:      None
+*****************************************************************************/
+void latency_printReport(uint8_t worstCount)
+{
+    uint8_t order[LATENCY_EVENT_TYPES];
+
+    printf("event      count    p50 ms   p99 ms   max ms\n");
+    for (uint8_t type = 0; type < LATENCY_EVENT_TYPES; type++) {
+        const EventStats *s = &stats[type];
+        order[type] = type;
+        if (s->count == 0) {
+            printf("%-8s %7u        -        -        -\n", eventNames[type], 0u);
+            continue;
+        }
+        printf("%-8s %7lu %8lu %8lu %8.1f\n", eventNames[type], (unsigned long)s->count,
+               (unsigned long)percentileMs(s, 50), (unsigned long)percentileMs(s, 99),
+               s->maxUs / 1000.0);
+    }
+
+    /* Few types: insertion sort by maximum, largest first */
+    for (uint8_t i = 1; i < LATENCY_EVENT_TYPES; i++) {
+        for (uint8_t j = i; (j > 0) && (stats[order[j]].maxUs > stats[order[j - 1]].maxUs); j--) {
+            uint8_t t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+    }
+
+    for (uint8_t i = 0; (i < worstCount) && (i < LATENCY_EVENT_TYPES); i++) {
+        const EventStats *s = &stats[order[i]];
+        if (s->count == 0) {
+            break;
+        }
+        printf("\nworst %s: %.1f ms, ended at %lu ms, preceded by:\n", eventNames[order[i]],
+               s->maxUs / 1000.0, (unsigned long)s->maxAtMs);
+        for (uint8_t k = 0; k < s->trailLen; k++) {
+            const TrailEntry *e = &s->trail[k];
+            if (e->kind == TRAIL_INPUT) {
+                printf("  %10lu ms  input 0x%02x\n", (unsigned long)e->atMs, e->code);
+            } else {
+                printf("  %10lu ms  %s\n", (unsigned long)e->atMs, eventNames[e->code]);
+            }
+        }
+    }
+}
+
+#endif /* CLOCK_VIRTUAL */
@@ -0,0 +1,52 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Event-handling latency harness for simulated runs
+ *                (CLOCK_VIRTUAL only). The game marks where the handling
+ *                of each event starts; the handling ends when input is
+ *                sampled again, so the recorded time is how long input
+ *                was stalled. A fuzzing input source fires randomised
+ *                joystick sequences, and for every event type the report
+ *                gives count, p50/p99/max and the event sequence that led
+ *                to the maximum.
+ *
+ ******************************************************************************/
+
+#ifndef __LATENCY_H
+#define __LATENCY_H
+
+/* Event types */
+#define LATENCY_NAV         0   /* menu up/down */
+#define LATENCY_SELECT      1   /* menu item chosen */
+#define LATENCY_CLICK       2   /* prompt confirmed */
+#define LATENCY_THEME       3   /* theme switched by the light sensor */
+#define LATENCY_TILT        4   /* tilt easter egg */
+#define LATENCY_WAKE        5   /* panel restored after inactivity sleep */
+#define LATENCY_EVENT_TYPES 6
+
+#ifndef CLOCK_VIRTUAL
+
+#define latency_event(type)
+#define latency_poll()
+
+#else /* CLOCK_VIRTUAL */
+
+/* Events remembered before each recorded maximum */
+#define LATENCY_TRAIL       16
+
+typedef struct {
+    uint32_t seed;
+    uint16_t holdMinMs;     /* joystick hold time range */
+    uint16_t holdMaxMs;
+    uint16_t gapMaxMs;      /* idle time between inputs */
+} latency_fuzz_t;
+
+void latency_event(uint8_t type);
+void latency_poll(void);
+void latency_reset(void);
+uint32_t latency_getCount(uint8_t type);
+void latency_runFuzz(const latency_fuzz_t *fuzz, uint32_t simulatedMs, void (*ui)(void));
+void latency_printReport(uint8_t worstCount);
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __LATENCY_H */
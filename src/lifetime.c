@@ -0,0 +1,216 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Lifetime reaction-time histogram persisted in EEPROM.
+ *                Counters live in RAM and are written back once per
+ *                session, one 16-byte page write per page that changed.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "eeprom_map.h"
+#include "nvstore.h"
+#include "lifetime.h"
+
+#include <string.h>
+
+/* Header page contents identifying an initialised histogram */
+#define LIFETIME_MAGIC0     'R'
+#define LIFETIME_MAGIC1     'H'
+#define LIFETIME_VERSION    1
+#define LIFETIME_HDR_SIZE   4
+
+#define BINS_PER_PAGE       (EEPROM_PAGE_SIZE / 2)
+
+/*
+ * Bin edges in ms, ratio 25^(1/31) (about 1.11). Bin i covers
+ * [binEdge[i], binEdge[i + 1]); bin 0 also takes faster results and the
+ * last bin slower ones. The final edge only bounds interpolation.
+ */
+static const uint16_t binEdge[LIFETIME_BINS + 1] = {
+      80,   89,   98,  109,  121,  134,  149,  165,
+     184,  204,  226,  251,  278,  309,  342,  380,
+     421,  467,  519,  575,  638,  708,  786,  872,
+     967, 1073, 1190, 1320, 1465, 1625, 1803, 2000,
+    2219
+};
+
+static uint16_t bins[LIFETIME_BINS];
+static uint32_t totalCount;
+
+/* Pages changed since the last commit, bit n is bin page n */
+static uint8_t dirtyPages;
+
+/*****************************************************************************
+** Function name:       binOf
+**
+** Description:         Finds the bin of a reaction time by binary search
+**                      over the edges.
+**
+** Parameters:          ms - reaction time in milliseconds
+** Returned value:      Bin index
+*****************************************************************************/
+static uint8_t binOf(uint32_t ms)
+{
+    uint8_t lo = 0;
+    uint8_t hi = LIFETIME_BINS - 1;
+
+    while (lo < hi) {
+        uint8_t mid = (lo + hi + 1) / 2;
+        if (ms >= binEdge[mid]) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/*****************************************************************************
+** Function name:       writePage
+**
+** Description:         Stores one page of bins in EEPROM, big-endian like
+**                      the high score.
+**
+** Parameters:          page - bin page number
+** Returned value:      None
+*****************************************************************************/
+static void writePage(uint8_t page)
+{
+    uint8_t buf[EEPROM_PAGE_SIZE];
+
+    for (uint8_t i = 0; i < BINS_PER_PAGE; i++) {
+        uint16_t count = bins[page * BINS_PER_PAGE + i];
+        buf[2 * i] = (uint8_t)(count >> 8);
+        buf[2 * i + 1] = (uint8_t)(count & 0xFF);
+    }
+    nvstore_write(buf, EEPROM_LIFETIME_BINS_ADDR + page * EEPROM_PAGE_SIZE, EEPROM_PAGE_SIZE);
+}
+
+/*****************************************************************************
+** Function name:       lifetime_init
+**
+** Description:         Loads the histogram from EEPROM. A missing or
+**                      foreign header starts a new, empty histogram.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void lifetime_init(void)
+{
+    uint8_t header[LIFETIME_HDR_SIZE];
+
+    nvstore_read(header, EEPROM_LIFETIME_HDR_ADDR, LIFETIME_HDR_SIZE);
+
+    if ((header[0] != LIFETIME_MAGIC0) || (header[1] != LIFETIME_MAGIC1) ||
+        (header[2] != LIFETIME_VERSION) || (header[3] != LIFETIME_BINS)) {
+        memset(bins, 0, sizeof(bins));
+        for (uint8_t page = 0; page < EEPROM_LIFETIME_BINS_PAGES; page++) {
+            writePage(page);
+        }
+        header[0] = LIFETIME_MAGIC0;
+        header[1] = LIFETIME_MAGIC1;
+        header[2] = LIFETIME_VERSION;
+        header[3] = LIFETIME_BINS;
+        nvstore_write(header, EEPROM_LIFETIME_HDR_ADDR, LIFETIME_HDR_SIZE);
+    } else {
+        uint8_t buf[2 * LIFETIME_BINS];
+        nvstore_read(buf, EEPROM_LIFETIME_BINS_ADDR, sizeof(buf));
+        for (uint8_t i = 0; i < LIFETIME_BINS; i++) {
+            bins[i] = ((uint16_t)buf[2 * i] << 8) | buf[2 * i + 1];
+        }
+    }
+
+    totalCount = 0;
+    for (uint8_t i = 0; i < LIFETIME_BINS; i++) {
+        totalCount += bins[i];
+    }
+    dirtyPages = 0;
+}
+
+/*****************************************************************************
+** Function name:       lifetime_addResult
+**
+** Description:         Counts a reaction time in RAM. The counter saturates
+**                      at 0xFFFF. Persisted by lifetime_commit().
+**
+** Parameters:          ms - reaction time in milliseconds
+** Returned value:      None
+*****************************************************************************/
+void lifetime_addResult(uint32_t ms)
+{
+    uint8_t bin = binOf(ms);
+
+    if (bins[bin] < 0xFFFF) {
+        bins[bin]++;
+        totalCount++;
+        dirtyPages |= (uint8_t)(1 << (bin / BINS_PER_PAGE));
+    }
+}
+
+/*****************************************************************************
+** Function name:       lifetime_commit
+**
+** Description:         Writes every page changed since the last commit.
+**                      Meant to be called once per session; results of a
+**                      session usually fall into one page.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void lifetime_commit(void)
+{
+    for (uint8_t page = 0; page < EEPROM_LIFETIME_BINS_PAGES; page++) {
+        if (dirtyPages & (1 << page)) {
+            writePage(page);
+        }
+    }
+    dirtyPages = 0;
+}
+
+/*****************************************************************************
+** Function name:       lifetime_getCount
+**
+** Description:         Number of results counted in the histogram.
+**
+** Parameters:          None
+** Returned value:      Result count
+*****************************************************************************/
+uint32_t lifetime_getCount(void)
+{
+    return totalCount;
+}
+
+/*****************************************************************************
+** Function name:       lifetime_percentile
+**
+** Description:         Estimates a percentile by a cumulative scan to the
+**                      bin holding the nearest-rank result, interpolating
+**                      linearly inside that bin.
+**
+** Parameters:          percent - 1-99
+** Returned value:      Reaction time in ms, 0 if the histogram is empty
+*****************************************************************************/
+uint16_t lifetime_percentile(uint8_t percent)
+{
+    if (totalCount == 0) {
+        return 0;
+    }
+
+    uint32_t rank = ((uint32_t)percent * totalCount + 99) / 100;
+    uint32_t below = 0;
+    uint8_t bin = 0;
+
+    if (rank == 0) {
+        rank = 1;
+    }
+    while (below + bins[bin] < rank) {
+        below += bins[bin];
+        bin++;
+    }
+
+    /* Place the result at the centre of its share of the bin */
+    uint32_t width = binEdge[bin + 1] - binEdge[bin];
+    uint32_t offset = (width * (2 * (rank - below) - 1)) / (2 * (uint32_t)bins[bin]);
+    return (uint16_t)(binEdge[bin] + offset);
+}
@@ -0,0 +1,21 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Lifetime reaction-time histogram persisted in EEPROM.
+ *                Log-scale bins (about 11% wide, 80 ms to 2 s) with 16-bit
+ *                saturating counters, so it never needs rescaling and
+ *                percentiles stay within about half a bin width.
+ *
+ ******************************************************************************/
+
+#ifndef __LIFETIME_H
+#define __LIFETIME_H
+
+#define LIFETIME_BINS   32
+
+void lifetime_init(void);
+void lifetime_addResult(uint32_t ms);
+void lifetime_commit(void);
+uint32_t lifetime_getCount(void);
+uint16_t lifetime_percentile(uint8_t percent);
+
+#endif /* end __LIFETIME_H */
@@ -0,0 +1,212 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Scrolling list widget. Moving the selection repaints only
+ *                the two affected rows; scrolling moves the window contents
+ *                in the display shadow and paints just the exposed rows.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "display.h"
+#include "listview.h"
+
+/* Width of one character cell of the display font */
+#define CHAR_WIDTH  6
+
+/*****************************************************************************
+** Function name:       drawRow
+**
+** Description:         Paints one visible row: background, selection
+**                      marker and item text clipped to the window width.
+**
+** Parameters:          list  - list widget
+**                      index - item to paint, must be in the visible window
+** Returned value:      None
+*****************************************************************************/
+static void drawRow(listview_t *list, uint16_t index)
+{
+    uint8_t y = list->y + (uint8_t)(index - list->top) * list->rowHeight;
+    uint8_t maxChars = list->width / CHAR_WIDTH;
+    char text[LISTVIEW_TEXT_MAX + 1];
+    char line[LISTVIEW_TEXT_MAX + 3];
+    uint8_t len = 0;
+
+    display_fillRect(list->x, y, list->width, list->rowHeight, list->bg);
+
+    const char *item = list->itemText(index, text);
+    line[len++] = (index == list->selected) ? '>' : ' ';
+    line[len++] = ' ';
+    while ((*item != '\0') && (len < maxChars) && (len < sizeof(line) - 1)) {
+        line[len++] = *item++;
+    }
+    line[len] = '\0';
+
+    display_putString(list->x, y, line, list->fg, list->bg);
+}
+
+/*****************************************************************************
+** Function name:       isVisible
+**
+** Description:         Tells whether an item lies in the visible window.
+**
+** Parameters:          list  - list widget
+**                      index - item index
+** Returned value:      1 if visible, else 0
+*****************************************************************************/
+static uint8_t isVisible(listview_t *list, uint16_t index)
+{
+    return (index >= list->top) && (index < list->top + list->rows) && (index < list->count);
+}
+
+/*****************************************************************************
+** Function name:       listview_init
+**
+** Description:         Sets up a list with the first item selected. Does
+**                      not draw.
+**
+** Parameters:          list      - list widget to initialise
+**                      x, y      - top left corner of the window
+**                      width     - window width in pixels
+**                      rows      - number of visible rows
+**                      rowHeight - row pitch in pixels, at least 8
+**                      count     - number of items
+**                      itemText  - item text callback
+** Returned value:      None
+*****************************************************************************/
+void listview_init(listview_t *list, uint8_t x, uint8_t y, uint8_t width, uint8_t rows,
+                   uint8_t rowHeight, uint16_t count, listview_itemText_t itemText)
+{
+    list->itemText = itemText;
+    list->count = count;
+    list->selected = 0;
+    list->top = 0;
+    list->x = x;
+    list->y = y;
+    list->width = width;
+    list->rows = rows;
+    list->rowHeight = rowHeight;
+    list->fg = OLED_COLOR_WHITE;
+    list->bg = OLED_COLOR_BLACK;
+}
+
+/*****************************************************************************
+** Function name:       listview_setColors
+**
+** Description:         Changes the colors used by later drawing. Call
+**                      listview_draw() to apply them to the visible rows.
+**
+** Parameters:          list - list widget
+**                      fg   - text color
+**                      bg   - background color
+** Returned value:      None
+*****************************************************************************/
+void listview_setColors(listview_t *list, oled_color_t fg, oled_color_t bg)
+{
+    list->fg = fg;
+    list->bg = bg;
+}
+
+/*****************************************************************************
+** Function name:       listview_draw
+**
+** Description:         Repaints the whole visible window.
+**
+** Parameters:          list - list widget
+** Returned value:      None
+*****************************************************************************/
+void listview_draw(listview_t *list)
+{
+    display_fillRect(list->x, list->y, list->width, list->rows * list->rowHeight, list->bg);
+
+    for (uint16_t index = list->top; isVisible(list, index); index++) {
+        drawRow(list, index);
+    }
+}
+
+/*****************************************************************************
+** Function name:       listview_select
+**
+** Description:         Moves the selection and scrolls it into view. When
+**                      the window moves by less than its height, the rows
+**                      still visible are moved in the shadow and only the
+**                      exposed rows are rendered.
+**
+** Parameters:          list  - list widget
+**                      index - item to select
+** Returned value:      None
+*****************************************************************************/
+void listview_select(listview_t *list, uint16_t index)
+{
+    uint16_t previous = list->selected;
+    uint16_t top = list->top;
+
+    if (index >= list->count) {
+        return;
+    }
+
+    if (index < top) {
+        top = index;
+    } else if (index >= top + list->rows) {
+        top = index - list->rows + 1;
+    }
+
+    int16_t shift = (int16_t)(top - list->top);
+    list->selected = index;
+
+    if (shift == 0) {
+        drawRow(list, previous);
+        drawRow(list, index);
+        return;
+    }
+
+    if ((shift >= list->rows) || (-shift >= list->rows)) {
+        list->top = top;
+        listview_draw(list);
+        return;
+    }
+
+    display_scrollRect(list->x, list->y, list->width, list->rows * list->rowHeight,
+                       (int8_t)(-shift * list->rowHeight));
+    list->top = top;
+
+    /* Paint the rows scrolled into view, then fix the old marker */
+    uint16_t first = (shift > 0) ? (top + list->rows - shift) : top;
+    uint16_t last = (shift > 0) ? (top + list->rows - 1) : (top - shift - 1);
+
+    for (uint16_t row = first; (row <= last) && isVisible(list, row); row++) {
+        drawRow(list, row);
+    }
+    if (isVisible(list, previous)) {
+        drawRow(list, previous);
+    }
+    if ((index < first) || (index > last)) {
+        drawRow(list, index);
+    }
+}
+
+/*****************************************************************************
+** Function name:       listview_next
+**
+** Description:         Selects the next item, wrapping to the first.
+**
+** Parameters:          list - list widget
+** Returned value:      None
+*****************************************************************************/
+void listview_next(listview_t *list)
+{
+    listview_select(list, (list->selected + 1 < list->count) ? (list->selected + 1) : 0);
+}
+
+/*****************************************************************************
+** Function name:       listview_prev
+**
+** Description:         Selects the previous item, wrapping to the last.
+**
+** Parameters:          list - list widget
+** Returned value:      None
+*****************************************************************************/
+void listview_prev(listview_t *list)
+{
+    listview_select(list, (list->selected > 0) ? (list->selected - 1) : (list->count - 1));
+}
@@ -0,0 +1,43 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Scrolling list widget. Only the visible window of rows is
+ *                rendered and item text is fetched through a callback, so
+ *                memory use does not depend on the list length.
+ *
+ ******************************************************************************/
+
+#ifndef __LISTVIEW_H
+#define __LISTVIEW_H
+
+#include "oled.h"
+
+/* Longest item text drawn, in characters */
+#define LISTVIEW_TEXT_MAX   16
+
+/*
+ * Returns the text of item index. The callback may format into buf
+ * (LISTVIEW_TEXT_MAX + 1 bytes) and return it, or return a constant string.
+ */
+typedef const char *(*listview_itemText_t)(uint16_t index, char *buf);
+
+typedef struct {
+    listview_itemText_t itemText;
+    uint16_t count;         /* number of items */
+    uint16_t selected;      /* selected item */
+    uint16_t top;           /* first visible item */
+    uint8_t x, y;           /* top left corner of the window */
+    uint8_t width;          /* window width in pixels */
+    uint8_t rows;           /* visible rows */
+    uint8_t rowHeight;      /* row pitch in pixels, at least 8 */
+    oled_color_t fg, bg;
+} listview_t;
+
+void listview_init(listview_t *list, uint8_t x, uint8_t y, uint8_t width, uint8_t rows,
+                   uint8_t rowHeight, uint16_t count, listview_itemText_t itemText);
+void listview_setColors(listview_t *list, oled_color_t fg, oled_color_t bg);
+void listview_draw(listview_t *list);
+void listview_select(listview_t *list, uint16_t index);
+void listview_next(listview_t *list);
+void listview_prev(listview_t *list);
+
+#endif /* end __LISTVIEW_H */
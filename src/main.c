@@ -24,12 +24,40 @@
 #include "rgb.h"
 #include "led7seg.h"
 
+#include "busmon.h"
+#include "capture.h"
+#include "clock.h"
+#include "eeprom_map.h"
+#include "fastgpio.h"
+#include "sspbus.h"
+#include "display.h"
+#include "dlog.h"
+#include "duel.h"
+#include "exgauss.h"
+#include "input.h"
+#include "perf.h"
+#include "irqprio.h"
+#include "power.h"
+#include "profile.h"
+#include "qr.h"
+#include "remote.h"
+#include "latency.h"
+#include "listview.h"
+#include "nvstore.h"
+#include "lifetime.h"
+#include "seg7.h"
+#include "serial.h"
+#include "sleep.h"
+#include "stack.h"
+#include "stats.h"
+#include "trace.h"
+
 #include <stdlib.h>
 #include <string.h>
 
 /* Macros for controlling speaker pin */
-#define P1_2_HIGH() (LPC_GPIO1->DATA |= ((uint16_t)0x1<<2))
-#define P1_2_LOW()  (LPC_GPIO1->DATA &= ~((uint16_t)0x1<<2))
+#define P1_2_HIGH() FASTGPIO_HIGH(PORT1, 2)
+#define P1_2_LOW()  FASTGPIO_LOW(PORT1, 2)
 
 /* I/O direction macros */
 #define LOW 0
@@ -38,7 +66,61 @@
 #define INPUT 0
 
 /* Menu system constants */
-#define MENU_ITEM_COUNT 5
+#define MENU_ITEM_COUNT   10
+#define MENU_ROW_HEIGHT   10
+#define MENU_VISIBLE_ROWS 6
+
+/* Diagnostics screen: one value per row, refreshed at a low rate */
+#define DIAG_ROWS           7
+#define DIAG_ROW_HEIGHT     9
+#define DIAG_TEXT_MAX       17
+#define DIAG_REFRESH_MS     250
+
+#define DIAG_ROW_I2C        0
+#define DIAG_ROW_SSP        1
+#define DIAG_ROW_LOOP       2
+#define DIAG_ROW_ACC        3
+#define DIAG_ROW_LIGHT      4
+#define DIAG_ROW_STACK      5
+#define DIAG_ROW_CAPTURE    6
+
+/* Injected edges per capture self-test on the diagnostics screen */
+#define CAPTURE_TEST_ROUNDS 200
+
+/* Rounds per game session */
+#define SESSION_ROUNDS      5
+#define RESULT_HOLD_MS      600     // Result stays up at least this long
+#define SESSION_IDLE        0xFF
+
+/* Default foreperiod: stimulus 0.5-3.5 s after the wait screen */
+#define FOREPERIOD_MIN_MS   500
+#define FOREPERIOD_RANGE_MS 3000
+#define FOREPERIOD_MAX_MS   10000   // Longest foreperiod a rig may ask for
+
+/* Head-to-head: response window, wait for the leader, result display */
+#define DUEL_RESPONSE_MS    2000
+#define DUEL_IDLE_MS        10000
+#define DUEL_SETTLE_MS      300     // Follower leaves its menu after the invite
+#define DUEL_RESULT_MS      1500
+#define DUEL_POLL_US        50
+
+/* ISL29003 interrupt output (open-drain, active low) */
+#define LIGHT_INT_PORT PORT2
+#define LIGHT_INT_PIN  5
+#define LIGHT_INT_ASSERTED() (!FASTGPIO_READ(LIGHT_INT_PORT, LIGHT_INT_PIN))
+
+/* Persisted tilt calibration record: magic, x/y/z offsets, checksum */
+#define TILT_CAL_MAGIC    0x7C
+#define TILT_CAL_SIZE     5
+#define TILT_CAL_SAMPLES  8
+#define TILT_OFFSET_LIMIT 40    // Larger offsets are not a plausible sensor bias
+#define TILT_GRAVITY_MIN  48    // Accepted band for corrected |g| (64 LSB/g)
+#define TILT_GRAVITY_MAX  80
+
+/* Theme switching boundary and hysteresis band (lux) */
+#define THEME_THRESHOLD_LUX  125
+#define THEME_HYSTERESIS_LUX 15
+#define LIGHT_RANGE_LUX      1000
 
 /*****************************************************************************
  * Enumeration: MenuItem
@@ -46,8 +128,13 @@
  *****************************************************************************/
 typedef enum {
     MENU_START_GAME = 0,
+    MENU_DUEL,
+    MENU_PLAYER,
     MENU_RESET_SCORE,
 	SHOW_HIGH_SCORE,
+    MENU_STATISTICS,
+    MENU_SHARE,
+    MENU_CALIBRATE,
     MENU_CREDITS,
     MENU_EXIT
 } MenuItem;
@@ -55,14 +142,39 @@ typedef enum {
 /* Menu item text strings */
 static const char *menuItems[MENU_ITEM_COUNT] = {
     "Start game",
+    "Duel",
+    "Player",
     "Reset score",
 	"High score",
+    "Statistics",
+    "Share results",
+    "Calibrate",
     "Credits",
     "Exit"
 };
 
-/* Currently selected menu index */
-static int selectedIndex = 0;
+/* Main menu list, holds the selected menu index */
+static listview_t menuList;
+
+/* Player whose results feed the ex-Gaussian estimate */
+static uint8_t currentPlayer = 0;
+
+/* Foreperiod drawn uniformly from [min, min + range), set over the remote link */
+static uint16_t foreperiodMinMs = FOREPERIOD_MIN_MS;
+static uint16_t foreperiodRangeMs = FOREPERIOD_RANGE_MS;
+
+/* Round in progress, SESSION_IDLE once the session's screens are left */
+static uint8_t sessionRound = SESSION_IDLE;
+
+/* Reaction times of the current or last session */
+static uint16_t sessionTimes[SESSION_ROUNDS];
+static uint8_t sessionCount;
+
+/* A rig asked for a session; handle_menu() starts it */
+static uint8_t remoteStartPending;
+
+/* A rig changed what the menu shows; handle_menu() redraws it */
+static uint8_t remoteMenuStale;
 
 /*****************************************************************************
  * Structure: TiltState
@@ -104,6 +216,9 @@ static uint32_t notes[] = {
 static oled_color_t fontColor;
 static oled_color_t backgroundColor;
 
+/* Theme changes beep before the note player is defined */
+void play_note(uint32_t note, uint32_t durationMs);
+
 /*****************************************************************************
 ** Function name:       set_led_bar_position
 **
@@ -116,8 +231,12 @@ static oled_color_t backgroundColor;
 static void set_led_bar_position(uint8_t pos)
 {
     uint16_t ledOn;
+    power_acquire(POWER_LEDS);
+    uint32_t start = busmon_now();
     ledOn = (uint16_t)0x01 << pos;  // Create bitmask for single LED
     pca9532_setLeds(ledOn, 0xffff); // Turn on specified LED, turn off all others
+    busmon_addI2c(busmon_now() - start);
+    power_release(POWER_LEDS);
 }
 
 /*****************************************************************************
@@ -130,7 +249,43 @@ static void set_led_bar_position(uint8_t pos)
 *****************************************************************************/
 void clear_led_bar(void)
 {
+    power_acquire(POWER_LEDS);
+    uint32_t start = busmon_now();
     pca9532_setLeds(0, 0xffff); // Turn off all leds
+    busmon_addI2c(busmon_now() - start);
+    power_release(POWER_LEDS);
+}
+
+/*****************************************************************************
+** Function name:       menu_itemText
+**
+** Description:         Item text callback of the main menu list.
+**
+** Parameters:          index - menu item index
+**                      buf   - buffer for items with live values
+** Returned value:      Menu item text
+*****************************************************************************/
+static const char *menu_itemText(uint16_t index, char *buf)
+{
+    if (index == MENU_PLAYER) {
+        snprintf(buf, LISTVIEW_TEXT_MAX + 1, "%s %u", menuItems[index], currentPlayer + 1);
+        return buf;
+    }
+    return menuItems[index];
+}
+
+/*****************************************************************************
+** Function name:       init_menu
+**
+** Description:         Sets up the menu list view with the first item
+**                      selected.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void init_menu(void) {
+    listview_init(&menuList, 4, 2, OLED_DISPLAY_WIDTH - 4, MENU_VISIBLE_ROWS, MENU_ROW_HEIGHT,
+                  MENU_ITEM_COUNT, menu_itemText);
 }
 
 /*****************************************************************************
@@ -143,17 +298,10 @@ void clear_led_bar(void)
 ** Returned value:      None
 *****************************************************************************/
 void draw_menu(void) {
-    oled_clearScreen(backgroundColor);
-
-    for (int i = 0; i < MENU_ITEM_COUNT; i++) {
-        uint8_t y = 2 + i * 12;  // Calculate vertical position for each menu item
-
-        // Add arrow indicator to selected item, space for others
-        char buffer[20];
-        snprintf(buffer, sizeof(buffer), "%c %s", (i == selectedIndex ? '>' : ' '), menuItems[i]);
-
-        oled_putString(4, y, (uint8_t *)buffer, fontColor, backgroundColor);
-    }
+    display_clearScreen(backgroundColor);
+    listview_setColors(&menuList, fontColor, backgroundColor);
+    listview_draw(&menuList);
+    display_flush();
 }
 
 
@@ -168,7 +316,7 @@ void draw_menu(void) {
 ** Returned value:      true if board is tilted beyond threshold, false otherwise
 *****************************************************************************/
  uint32_t is_board_tilted(void) {
-    acc_read(&tilt.x, &tilt.y, &tilt.z);
+    busmon_accRead(&tilt.x, &tilt.y, &tilt.z);
 
     // Apply calibration offsets
     tilt.x += tilt.xOffset;
@@ -184,33 +332,95 @@ void draw_menu(void) {
 }
 
  /*****************************************************************************
- ** Function name:       adjust_theme
+ ** Function name:       init_light_interrupt
  **
- ** Description:         Reads ambient light sensor and dynamically adjusts
- **                      display theme between dark mode (low light) and light
- **                      mode (bright light). Provides audio feedback on changes.
+ ** Description:         Switches the ISL29003 to a short 12-bit integration
+ **                      and routes its threshold interrupt to LIGHT_INT_PIN,
+ **                      so theme changes are signalled by the sensor instead
+ **                      of being polled over I2C.
  **
  ** Parameters:          None
  ** Returned value:      None
  *****************************************************************************/
+ void init_light_interrupt(void) {
+     GPIOSetDir(LIGHT_INT_PORT, LIGHT_INT_PIN, INPUT);
+
+     power_acquire(POWER_LIGHT);
+     light_setRange(LIGHT_RANGE_1000);
+     light_setWidth(LIGHT_WIDTH_12BITS);      // ~6 ms integration instead of ~90 ms
+     light_setIrqInCycles(LIGHT_CYCLE_4);     // Ignore single-cycle flicker
+     power_release(POWER_LIGHT);
+ }
+
+ /*****************************************************************************
+ ** Function name:       arm_light_thresholds
+ **
+ ** Description:         Programs the ISL29003 window so that its interrupt
+ **                      fires only when the light crosses the theme boundary
+ **                      (plus hysteresis) away from the current theme.
+ **
+ ** Parameters:          None
+ ** Returned value:      None
+ *****************************************************************************/
+ static void arm_light_thresholds(void) {
+     power_acquire(POWER_LIGHT);
+     if (fontColor == OLED_COLOR_WHITE) {
+         // Dark theme: only a brighter environment is of interest
+         light_setLoThreshold(0);
+         light_setHiThreshold(THEME_THRESHOLD_LUX + THEME_HYSTERESIS_LUX);
+     } else {
+         // Light theme: only a darker environment is of interest
+         light_setLoThreshold(THEME_THRESHOLD_LUX - THEME_HYSTERESIS_LUX);
+         light_setHiThreshold(LIGHT_RANGE_LUX);
+     }
+     light_clearIrqStatus();
+     power_release(POWER_LIGHT);
+ }
+
+ /*****************************************************************************
+ ** Function name:       adjust_theme
+ **
+ ** Description:         Adjusts display theme between dark mode (low light)
+ **                      and light mode (bright light). The sensor is only
+ **                      read when its interrupt line reports a threshold
+ **                      crossing; the first call always reads it. Provides
+ **                      audio feedback on changes.
+ **
+ ** Parameters:          None
+ ** Returned value:      1 if the theme changed, 0 otherwise
+ *****************************************************************************/
  uint8_t adjust_theme(void) {
-     uint32_t reading = light_read();
+     static uint8_t thresholdsArmed = 0;
+
+     // Steady state: interrupt line idle means the theme is still valid
+     if (thresholdsArmed && !LIGHT_INT_ASSERTED()) return 0;
+
+     uint32_t reading = busmon_lightRead();
      uint32_t prev_fontColor = fontColor;
 
-     // Threshold-based theme switching
-     if (reading < 125) {
-         // Dark environment
-         fontColor = OLED_COLOR_WHITE;
-         backgroundColor = OLED_COLOR_BLACK;
-     } else {
+     // Threshold-based theme switching, hysteresis once a theme is set
+     if (!thresholdsArmed) {
+         if (reading < THEME_THRESHOLD_LUX) {
+             fontColor = OLED_COLOR_WHITE;
+         } else {
+             fontColor = OLED_COLOR_BLACK;
+         }
+     } else if (reading >= THEME_THRESHOLD_LUX + THEME_HYSTERESIS_LUX) {
          // Bright environment
          fontColor = OLED_COLOR_BLACK;
-         backgroundColor = OLED_COLOR_WHITE;
+     } else if (reading < THEME_THRESHOLD_LUX - THEME_HYSTERESIS_LUX) {
+         // Dark environment
+         fontColor = OLED_COLOR_WHITE;
      }
+     backgroundColor = (fontColor == OLED_COLOR_WHITE) ? OLED_COLOR_BLACK : OLED_COLOR_WHITE;
+
+     arm_light_thresholds();
+     thresholdsArmed = 1;
 
      // Audio feedback when theme changes
      if (fontColor == prev_fontColor) return 0;
 
+     latency_event(LATENCY_THEME);
      play_note(notes[0], 200);
      return 1;
  }
@@ -253,22 +463,114 @@ void play_star_wars_theme(void) {
     play_note(notes[8], 1000); // G
 }
 
+/*****************************************************************************
+** Function name:       tilt_cal_checksum
+**
+** Description:         Computes the check byte of a calibration record.
+**
+** Parameters:          record - calibration record (TILT_CAL_SIZE bytes)
+** Returned value:      Checksum over all bytes but the last
+*****************************************************************************/
+static uint8_t tilt_cal_checksum(const uint8_t *record) {
+    uint8_t sum = 0xA5;
+    for (int i = 0; i < TILT_CAL_SIZE - 1; i++) {
+        sum = (uint8_t)((sum << 1) | (sum >> 7)) ^ record[i];
+    }
+    return sum;
+}
+
+/*****************************************************************************
+** Function name:       save_tilt_calibration
+**
+** Description:         Stores the current accelerometer offsets in EEPROM.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void save_tilt_calibration(void) {
+    uint8_t record[TILT_CAL_SIZE];
+    record[0] = TILT_CAL_MAGIC;
+    record[1] = (uint8_t)tilt.xOffset;
+    record[2] = (uint8_t)tilt.yOffset;
+    record[3] = (uint8_t)tilt.zOffset;
+    record[4] = tilt_cal_checksum(record);
+    nvstore_write(record, EEPROM_TILT_CAL_ADDR, TILT_CAL_SIZE);
+    DLOG("tilt calibration %d %d %d", tilt.xOffset, tilt.yOffset, tilt.zOffset);
+}
+
+/*****************************************************************************
+** Function name:       load_tilt_calibration
+**
+** Description:         Restores accelerometer offsets from EEPROM and checks
+**                      that they are plausible: intact record, offsets within
+**                      sensor bias limits and a corrected reading whose
+**                      magnitude is close to 1 g. The last check holds in
+**                      any orientation, so the board need not lie still.
+**
+** Parameters:          None
+** Returned value:      1 if stored calibration was applied, 0 otherwise
+*****************************************************************************/
+uint8_t load_tilt_calibration(void) {
+    uint8_t record[TILT_CAL_SIZE];
+    nvstore_read(record, EEPROM_TILT_CAL_ADDR, TILT_CAL_SIZE);
+
+    if ((record[0] != TILT_CAL_MAGIC) || (record[4] != tilt_cal_checksum(record))) {
+        return 0;
+    }
+
+    int8_t xOffset = (int8_t)record[1];
+    int8_t yOffset = (int8_t)record[2];
+    int8_t zOffset = (int8_t)record[3];
+    if ((abs(xOffset) > TILT_OFFSET_LIMIT) || (abs(yOffset) > TILT_OFFSET_LIMIT) ||
+        (abs(zOffset) > TILT_OFFSET_LIMIT)) {
+        return 0;
+    }
+
+    // One live sample: corrected vector must still look like gravity
+    busmon_accRead(&tilt.x, &tilt.y, &tilt.z);
+    int32_t x = tilt.x + xOffset;
+    int32_t y = tilt.y + yOffset;
+    int32_t z = tilt.z + zOffset;
+    int32_t magnitude2 = x * x + y * y + z * z;
+    if ((magnitude2 < TILT_GRAVITY_MIN * TILT_GRAVITY_MIN) ||
+        (magnitude2 > TILT_GRAVITY_MAX * TILT_GRAVITY_MAX)) {
+        return 0;
+    }
+
+    tilt.xOffset = xOffset;
+    tilt.yOffset = yOffset;
+    tilt.zOffset = zOffset;
+    return 1;
+}
+
 /*****************************************************************************
 ** Function name:       init_tilt_calibration
 **
-** Description:         Calibrates the accelerometer by reading current
-**                      position and calculating offset values. Should be
-**                      called when device is in neutral position.
+** Description:         Calibrates the accelerometer by averaging a few
+**                      readings of the current position, calculating offset
+**                      values and persisting them. Should be called when
+**                      device is in neutral position.
 **
 ** Parameters:          None
 ** Returned value:      None
 *****************************************************************************/
 void init_tilt_calibration(void) {
-    acc_read(&tilt.x, &tilt.y, &tilt.z);
+    int16_t sumX = 0;
+    int16_t sumY = 0;
+    int16_t sumZ = 0;
+
+    for (int i = 0; i < TILT_CAL_SAMPLES; i++) {
+        busmon_accRead(&tilt.x, &tilt.y, &tilt.z);
+        sumX += tilt.x;
+        sumY += tilt.y;
+        sumZ += tilt.z;
+    }
+
+    tilt.xOffset = -(sumX / TILT_CAL_SAMPLES);
+    tilt.yOffset = -(sumY / TILT_CAL_SAMPLES);
+    tilt.zOffset = 64 - (sumZ / TILT_CAL_SAMPLES);
 
-    tilt.xOffset = -tilt.x;
-    tilt.yOffset = -tilt.y;
-    tilt.zOffset = 64 - tilt.z;
+    save_tilt_calibration();
 }
 
 /*****************************************************************************
@@ -276,14 +578,25 @@ void init_tilt_calibration(void) {
 **
 ** Description:         Blocking function that waits until the joystick center
 **                      button is pressed. Used for user confirmation prompts.
+**                      The panel goes to sleep while nobody answers.
 **
 ** Parameters:          None
 ** Returned value:      None
 *****************************************************************************/
 void wait_for_joystick_center_click(void) {
-	while ((joystick_read() & JOYSTICK_CENTER) == 0) {
-		delay32Ms(0, 1);
+	sleep_touch();
+	while (1) {
+		uint8_t joy = input_read();
+
+		if (sleep_poll(joy)) {
+			continue;
+		}
+		if (joy & JOYSTICK_CENTER) {
+			break;
+		}
+		clock_delayMs(1);
 	}
+	latency_event(LATENCY_CLICK);
 }
 
 /*****************************************************************************
@@ -303,14 +616,14 @@ void draw_circle(uint8_t x0, uint8_t y0, uint8_t radius, oled_color_t color) {
     int16_t err = 0;
 
     while (x >= y) {
-        oled_putPixel(x0 + x, y0 + y, color);
-        oled_putPixel(x0 + y, y0 + x, color);
-        oled_putPixel(x0 - y, y0 + x, color);
-        oled_putPixel(x0 - x, y0 + y, color);
-        oled_putPixel(x0 - x, y0 - y, color);
-        oled_putPixel(x0 - y, y0 - x, color);
-        oled_putPixel(x0 + y, y0 - x, color);
-        oled_putPixel(x0 + x, y0 - y, color);
+        display_putPixel(x0 + x, y0 + y, color);
+        display_putPixel(x0 + y, y0 + x, color);
+        display_putPixel(x0 - y, y0 + x, color);
+        display_putPixel(x0 - x, y0 + y, color);
+        display_putPixel(x0 - x, y0 - y, color);
+        display_putPixel(x0 - y, y0 - x, color);
+        display_putPixel(x0 + y, y0 - x, color);
+        display_putPixel(x0 + x, y0 - y, color);
 
         y += 1;
         if (err <= 0) {
@@ -341,7 +654,7 @@ void fill_circle(uint8_t x0, uint8_t y0, uint8_t radius, oled_color_t color) {
         for (int16_t x = -radius; x <= radius; x++) {
             // Use distance formula: if x²+y² ≤ r², point is inside circle
             if (x * x + y * y <= radius * radius) {
-                oled_putPixel(x0 + x, y0 + y, color);
+                display_putPixel(x0 + x, y0 + y, color);
             }
         }
     }
@@ -359,20 +672,24 @@ void fill_circle(uint8_t x0, uint8_t y0, uint8_t radius, oled_color_t color) {
 ** Returned value:      None
 *****************************************************************************/
 void play_note(uint32_t note, uint32_t durationMs) {
+    trace_begin(TRACE_AUDIO, (uint16_t)note);
     if (note > (uint32_t)0) {
+        power_acquire(POWER_AUDIO);
         uint32_t t = 0;
         // Generate square wave for specified duration
         while (t < (durationMs * (uint32_t)1000)) {
             P1_2_HIGH();                        // Set speaker pin high
-            delay32Us(0, note / (uint32_t)4);   // Half period delay
+            clock_delayUs(note / (uint32_t)4);   // Half period delay
             P1_2_LOW();                         // Set speaker pin low
-            delay32Us(0, note / (uint32_t)4);   // Half period delay
+            clock_delayUs(note / (uint32_t)4);   // Half period delay
             t += note;                          // Track elapsed time
         }
+        power_release(POWER_AUDIO);
     }
     else {
-        delay32Ms(0, durationMs);
+        clock_delayMs(durationMs);
     }
+    trace_end(TRACE_AUDIO, (uint16_t)note);
 }
 
 /*****************************************************************************
@@ -389,7 +706,8 @@ void set_high_score(uint16_t value) {
     // Split 16-bit value into two bytes (big-endian format)
     buf[0] = (value & (uint16_t)0xFF00) >> 8;  // High byte
     buf[1] = (value & (uint16_t)0x00FF);       // Low byte
-    eeprom_write(buf, 8, 2);                   // Write to EEPROM address 0
+    nvstore_write(buf, EEPROM_HIGH_SCORE_ADDR, 2);
+    DLOG("high score set to %u ms", value);
 }
 
 /*****************************************************************************
@@ -403,7 +721,7 @@ void set_high_score(uint16_t value) {
 *****************************************************************************/
 static uint16_t read_high_score(void) {
     uint8_t readBuf[2];
-    eeprom_read(readBuf, 8, 2);  // Read 2 bytes from EEPROM address 8
+    nvstore_read(readBuf, EEPROM_HIGH_SCORE_ADDR, 2);  // Read 2 bytes of high score
     // Reconstruct 16-bit value from bytes (big-endian format)
     return ((uint16_t)readBuf[0] << 8) | (uint16_t)readBuf[1];
 }
@@ -412,27 +730,25 @@ static uint16_t read_high_score(void) {
 ** Function name:       measure_reaction_time
 **
 ** Description:         Measures user reaction time from visual stimulus to
-**                      joystick button press. Configures Timer32 for millisecond
-**                      precision timing measurement.
+**                      joystick button press. The press is time stamped
+**                      by the capture interrupt, not by the polling loop.
+**                      There is no inactivity sleep during a trial: the
+**                      press that woke the panel would be captured as the
+**                      response.
 **
 ** Parameters:          None
-** Returned value:      Reaction time in milliseconds (incomplete implementation)
+** Returned value:      Reaction time in milliseconds
 *****************************************************************************/
 uint32_t measure_reaction_time(void) {
-    // Configure Timer32_1 for millisecond counting
-    init_timer32(1, 72000);
-    LPC_TMR32B1->TCR = 0x02;  // Reset timer
+    uint32_t start = clock_nowMs();
 
-    // Calculate prescaler for 1ms resolution
-    uint32_t prescalerValue = ((SystemFrequency/LPC_SYSCON->SYSAHBCLKDIV) / 1000) - 1;
-    LPC_TMR32B1->PR = prescalerValue;
-    LPC_TMR32B1->MCR = 0x00;  // No match control
-    LPC_TMR32B1->TCR = 0x01;  // Start timer
-
-    wait_for_joystick_center_click();
+    capture_arm();
+    while ((input_read() & JOYSTICK_CENTER) == 0) {
+        clock_delayMs(1);
+    }
+    latency_event(LATENCY_CLICK);
 
-    uint32_t reactionTimeMs = LPC_TMR32B1->TC;  // Read timer value
-    return reactionTimeMs;
+    return capture_elapsedMs(start);
 }
 
 /*****************************************************************************
@@ -450,7 +766,7 @@ void oled_putStringHorizontallyCentered(uint8_t y, const char text[]) {
     int textLength = strlen(text);
     // Calculate horizontal center position (assuming 5 pixels per character)
     uint8_t x = (OLED_DISPLAY_WIDTH - (textLength * 5)) / 2;
-    oled_putString(x, y, (uint8_t *)text, fontColor, backgroundColor);
+    display_putString(x, y, text, fontColor, backgroundColor);
 }
 
 /*****************************************************************************
@@ -464,16 +780,17 @@ void oled_putStringHorizontallyCentered(uint8_t y, const char text[]) {
 ** Returned value:      None
 *****************************************************************************/
 void show_welcome_screen(void) {
-    oled_clearScreen(backgroundColor);
+    display_clearScreen(backgroundColor);
     oled_putStringHorizontallyCentered(2, "Welcome");
     oled_putStringHorizontallyCentered(12, "REFLEKS");
     oled_putStringHorizontallyCentered(32, "High score:");
 
     uint16_t highScoreMs = read_high_score();
 
-    char highScoreMsString[8];
+    char highScoreMsString[12];
     sprintf(highScoreMsString, "%u ms", highScoreMs);
     oled_putStringHorizontallyCentered(42, highScoreMsString);
+    display_flush();
 
     wait_for_joystick_center_click();  // Wait for user to continue
 }
@@ -483,12 +800,17 @@ void show_welcome_screen(void) {
 **
 ** Description:         Shows animated "boot up" sequence with sci-fi themed
 **                      loading messages and animated dots. Includes audio
-**                      feedback and accelerometer calibration.
+**                      feedback. The full sequence only runs when there is
+**                      no usable stored calibration, to give the user time
+**                      to put the board down before it is sampled.
 **
 ** Parameters:          None
 ** Returned value:      None
 *****************************************************************************/
 void play_startup_animation(void) {
+    uint8_t calibrated = load_tilt_calibration();
+    int quoteCount = calibrated ? 3 : 9;
+
     play_note(notes[3], 200);
 
     const char *frames[] = {".", "..", "..."};
@@ -497,20 +819,330 @@ void play_startup_animation(void) {
         "AI synced", "Engines online", "Core stable", "Warp ready", "Scanning"
     };
 
-    // Display 3 different startup messages with animated dots
-    for (int i = 0; i < 9; i++) {
+    // Display startup messages with animated dots
+    for (int i = 0; i < quoteCount; i++) {
         const char *str = quotes[i];
         for (int f = 0; f < 3; f++) {
-            oled_clearScreen(backgroundColor);
+            display_clearScreen(backgroundColor);
             oled_putStringHorizontallyCentered(24, str);
             oled_putStringHorizontallyCentered(36, frames[f]);
-            delay32Ms(0, 300);
+            display_flush();
+            clock_delayMs(300);
+        }
+    }
+
+    if (!calibrated) {
+        init_tilt_calibration();  // Calibrate accelerometer during startup
+    }
+}
+
+
+/*****************************************************************************
+** Function name:       show_stats_screen
+**
+** Description:         Shows the histogram of all reaction times since
+**                      power-on and the trend of session averages, then
+**                      waits for a click.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void show_stats_screen(void) {
+    char line[16];
+
+    display_clearScreen(backgroundColor);
+    if (stats_getResultCount() == 0) {
+        oled_putStringHorizontallyCentered(28, "No results yet");
+    } else {
+        snprintf(line, sizeof(line), "Times n=%u", stats_getResultCount());
+        display_putString(0, 0, line, fontColor, backgroundColor);
+        stats_drawHistogram(0, 9, OLED_DISPLAY_WIDTH, 24, fontColor, backgroundColor);
+
+        snprintf(line, sizeof(line), "Avg %u-%u", stats_getTrendLow(), stats_getTrendHigh());
+        display_putString(0, 35, line, fontColor, backgroundColor);
+        stats_drawTrend(0, 44, OLED_DISPLAY_WIDTH, 20, fontColor, backgroundColor);
+    }
+    display_flush();
+
+    clock_delayMs(500);
+    wait_for_joystick_center_click();
+}
+
+/*****************************************************************************
+** Function name:       append_share_line
+**
+** Description:         Appends a line to the shared summary if it still
+**                      fits in a QR code.
+**
+** Parameters:          text - summary so far
+**                      line - line to append
+** Returned value:      None
+*****************************************************************************/
+static void append_share_line(char *text, const char *line)
+{
+    size_t used = strlen(text);
+
+    if (used + strlen(line) <= QR_TEXT_MAX) {
+        strcpy(text + used, line);
+    }
+}
+
+/*****************************************************************************
+** Function name:       show_share_screen
+**
+** Description:         Shows the last session as a QR code that a phone
+**                      can scan: player, round times, average and best,
+**                      and the player's ex-Gaussian fit when there is room.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void show_share_screen(void)
+{
+    char text[QR_TEXT_MAX + 1];
+    char line[24];
+    qr_code_t code;
+    exgauss_params_t fit;
+    uint32_t total = 0;
+    uint16_t best = 0xFFFF;
+
+    if (sessionCount == 0) {
+        oled_putStringHorizontallyCentered(28, "No session yet");
+        display_flush();
+        clock_delayMs(1000);
+        return;
+    }
+
+    snprintf(text, sizeof(text), "P%u", currentPlayer + 1);
+    for (uint8_t i = 0; i < sessionCount; i++) {
+        snprintf(line, sizeof(line), " %u", sessionTimes[i]);
+        append_share_line(text, line);
+        total += sessionTimes[i];
+        if (sessionTimes[i] < best) {
+            best = sessionTimes[i];
         }
     }
+    snprintf(line, sizeof(line), "\navg %lu best %u", (unsigned long)(total / sessionCount), best);
+    append_share_line(text, line);
+    if (exgauss_estimate(currentPlayer, &fit)) {
+        snprintf(line, sizeof(line), "\nexG %u/%u/%u", fit.mu, fit.sigma, fit.tau);
+        append_share_line(text, line);
+    }
+
+    trace_begin(TRACE_QR, strlen(text));
+    uint8_t encoded = qr_encode(text, &code);
+    trace_end(TRACE_QR, strlen(text));
 
-    init_tilt_calibration();  // Calibrate accelerometer during startup
+    if (encoded) {
+        qr_draw(&code, 0, 0, OLED_DISPLAY_HEIGHT, OLED_COLOR_BLACK, OLED_COLOR_WHITE);
+    } else {
+        oled_putStringHorizontallyCentered(28, "Too long");
+    }
+    display_flush();
+    clock_delayMs(500);
+    wait_for_joystick_center_click();
 }
 
+/*****************************************************************************
+** Function name:       draw_diagnostics_field
+**
+** Description:         Redraws one row of the diagnostics screen if its
+**                      text changed since it was last drawn.
+**
+** Parameters:          row   - row index
+**                      text  - new text of the row
+**                      shown - texts currently on screen, per row
+** Returned value:      None
+*****************************************************************************/
+static void draw_diagnostics_field(uint8_t row, const char *text,
+                                   char shown[DIAG_ROWS][DIAG_TEXT_MAX]) {
+    if (strcmp(shown[row], text) == 0) {
+        return;
+    }
+    display_fillRect(0, row * DIAG_ROW_HEIGHT, OLED_DISPLAY_WIDTH, DIAG_ROW_HEIGHT, backgroundColor);
+    display_putString(0, row * DIAG_ROW_HEIGHT, text, fontColor, backgroundColor);
+    strncpy(shown[row], text, DIAG_TEXT_MAX - 1);
+}
+
+/*****************************************************************************
+** Function name:       permille
+**
+** Description:         Share of a window, in tenths of a percent.
+**
+** Parameters:          part  - busy time
+**                      whole - window length
+** Returned value:      0-1000
+*****************************************************************************/
+static uint32_t permille(uint32_t part, uint32_t whole) {
+    if (whole == 0) {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)part * 1000) / whole);
+}
+
+/*****************************************************************************
+** Function name:       show_diagnostics_screen
+**
+** Description:         Live diagnostics: I2C and SSP utilization over the
+**                      last refresh window, main-loop period, latest
+**                      accelerometer and light sensor read times and free
+**                      stack. The first draw is a full-screen flush whose
+**                      throughput is shown on the SSP row and sent over
+**                      the serial link. Refreshes every DIAG_REFRESH_MS
+**                      and redraws only rows whose text changed. UP runs
+**                      the capture latency self-test, a click leaves.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void show_diagnostics_screen(void) {
+    char shown[DIAG_ROWS][DIAG_TEXT_MAX];
+    char line[DIAG_TEXT_MAX];
+    busmon_counters_t previous, current;
+    uint8_t previous_joy = input_read();
+    uint32_t nextRefresh = clock_nowMs();
+    uint32_t flushRate;
+
+    memset(shown, 0, sizeof(shown));
+    display_clearScreen(backgroundColor);
+    draw_diagnostics_field(DIAG_ROW_CAPTURE, "UP: capture test", shown);
+    flushRate = display_measureFullFlush();
+
+    serial_printf("stack used=%lu size=%lu isr=%lu\r\n", (unsigned long)stack_getHighWater(),
+                  (unsigned long)stack_getSize(), (unsigned long)stack_getIsrDepth());
+    serial_printf("flush full=%lu B/s\r\n", (unsigned long)flushRate);
+    busmon_getCounters(&previous);
+
+    while (1) {
+        uint8_t joy = input_read();
+        busmon_loopTick();
+
+        if ((joy & JOYSTICK_CENTER) && !(previous_joy & JOYSTICK_CENTER)) {
+            latency_event(LATENCY_CLICK);
+            return;
+        }
+        if ((joy & JOYSTICK_UP) && !(previous_joy & JOYSTICK_UP)) {
+            capture_report_t capture;
+
+            latency_event(LATENCY_SELECT);
+            draw_diagnostics_field(DIAG_ROW_CAPTURE, "Testing...", shown);
+            display_flush();
+            capture_selfTest(CAPTURE_TEST_ROUNDS, &capture);
+            snprintf(line, sizeof(line), "Cap %lu/%lu cy", (unsigned long)capture.threadMaxCycles,
+                     (unsigned long)capture.isrMaxCycles);
+            draw_diagnostics_field(DIAG_ROW_CAPTURE, line, shown);
+            display_flush();
+
+            serial_printf("capture rounds=%u missed=%u thread=%lu isr=%lu\r\n",
+                          capture.rounds, capture.missed, (unsigned long)capture.threadMaxCycles,
+                          (unsigned long)capture.isrMaxCycles);
+            serial_printf("capture sum=%lu mask_max=%lu\r\n",
+                          (unsigned long)capture.sumCycles, (unsigned long)irq_getMaskMaxCycles());
+
+            // The test's own bus load is not part of the next window
+            busmon_getCounters(&previous);
+            nextRefresh = clock_nowMs();
+        }
+        previous_joy = joy;
+
+        if ((int32_t)(clock_nowMs() - nextRefresh) >= 0) {
+            int8_t x, y, z;
+
+            // Fresh sensor read times; the screen's own small I2C share
+            busmon_accRead(&x, &y, &z);
+            busmon_lightRead();
+            busmon_getCounters(&current);
+
+            uint32_t window = current.now - previous.now;
+            uint32_t i2c = permille(current.i2cTicks - previous.i2cTicks, window);
+            uint32_t ssp = permille(current.sspTicks - previous.sspTicks, window);
+            uint32_t loopUs = busmon_ticksToUs(current.loopTicks);
+
+            snprintf(line, sizeof(line), "I2C  %3lu.%lu %%", (unsigned long)(i2c / 10),
+                     (unsigned long)(i2c % 10));
+            draw_diagnostics_field(DIAG_ROW_I2C, line, shown);
+            snprintf(line, sizeof(line), "SSP %3lu.%lu%% %4luk", (unsigned long)(ssp / 10),
+                     (unsigned long)(ssp % 10), (unsigned long)(flushRate / 1000));
+            draw_diagnostics_field(DIAG_ROW_SSP, line, shown);
+            snprintf(line, sizeof(line), "Loop %3lu.%lu ms", (unsigned long)(loopUs / 1000),
+                     (unsigned long)((loopUs % 1000) / 100));
+            draw_diagnostics_field(DIAG_ROW_LOOP, line, shown);
+            snprintf(line, sizeof(line), "Acc  %5lu us", (unsigned long)busmon_ticksToUs(current.accTicks));
+            draw_diagnostics_field(DIAG_ROW_ACC, line, shown);
+            snprintf(line, sizeof(line), "Lux  %5lu us", (unsigned long)busmon_ticksToUs(current.lightTicks));
+            draw_diagnostics_field(DIAG_ROW_LIGHT, line, shown);
+            snprintf(line, sizeof(line), "Stack free %lu",
+                     (unsigned long)(stack_getSize() - stack_getHighWater()));
+            draw_diagnostics_field(DIAG_ROW_STACK, line, shown);
+            display_flush();
+
+            previous = current;
+            nextRefresh += DIAG_REFRESH_MS;
+        }
+        clock_delayMs(10);
+    }
+}
+
+/*****************************************************************************
+** Function name:       prepare_round_screen
+**
+** Description:         Decides the theme and composes the waiting screen
+**                      of the next round in the shadow, without flushing,
+**                      and samples its foreperiod.
+**
+** Parameters:          None
+** Returned value:      Foreperiod in ms
+*****************************************************************************/
+static uint32_t prepare_round_screen(void)
+{
+    adjust_theme();
+
+    // Waiting screen with circle outline
+    display_clearScreen(backgroundColor);
+    draw_circle(OLED_DISPLAY_WIDTH / 2, OLED_DISPLAY_HEIGHT / 2, 28, fontColor);
+    oled_putStringHorizontallyCentered(OLED_DISPLAY_HEIGHT / 2 - 4, "WAIT...");
+
+    // Random delay before stimulus (0.5-3.5 seconds unless a rig changed it)
+    return (rand() % foreperiodRangeMs) + foreperiodMinMs;
+}
+
+/*****************************************************************************
+** Function name:       prepare_summary_screen
+**
+** Description:         Records the session and composes the end-of-game
+**                      summary in the shadow, without flushing.
+**
+** Parameters:          totalTime - sum of the session's reaction times
+** Returned value:      None
+*****************************************************************************/
+static void prepare_summary_screen(uint32_t totalTime)
+{
+    stats_addSession(totalTime / SESSION_ROUNDS);
+    lifetime_commit();
+
+    display_clearScreen(backgroundColor);
+    oled_putStringHorizontallyCentered(2, "Game Complete!");
+
+    char avgTimeStr[16];
+    snprintf(avgTimeStr, sizeof(avgTimeStr), "Avg: %u ms", totalTime / SESSION_ROUNDS);
+    oled_putStringHorizontallyCentered(14, avgTimeStr);
+
+    char bestTimeStr[16];
+    snprintf(bestTimeStr, sizeof(bestTimeStr), "Best: %u ms", read_high_score());
+    oled_putStringHorizontallyCentered(26, bestTimeStr);
+
+    // Ex-Gaussian fit over all results of the current player
+    char fitStr[17];
+    exgauss_params_t fit;
+    if (exgauss_estimate(currentPlayer, &fit)) {
+        snprintf(fitStr, sizeof(fitStr), "P%u mu%u sd%u", currentPlayer + 1, fit.mu, fit.sigma);
+        oled_putStringHorizontallyCentered(40, fitStr);
+        snprintf(fitStr, sizeof(fitStr), "tau%u n=%u", fit.tau, exgauss_getCount(currentPlayer));
+    } else {
+        snprintf(fitStr, sizeof(fitStr), "P%u n=%u", currentPlayer + 1, exgauss_getCount(currentPlayer));
+    }
+    oled_putStringHorizontallyCentered(52, fitStr);
+}
 
 /*****************************************************************************
 ** Function name:       start_game
@@ -518,7 +1150,9 @@ void play_startup_animation(void) {
 ** Description:         Main game loop that runs 5 rounds of reaction time
 **                      testing. Each round shows visual stimulus after random
 **                      delay and measures response time. Updates high score
-**                      and provides visual/audio feedback.
+**                      and provides visual/audio feedback. While a result is
+**                      shown the next screen is composed in the shadow, so
+**                      the click moves on with a single flush.
 **
 ** Parameters:          None
 ** Returned value:      None
@@ -527,39 +1161,49 @@ void start_game(void) {
     uint8_t round = 0;
     uint32_t totalTime = 0;
     uint16_t highScoreMs = read_high_score();
-
-    while (round < 5) {
+    uint32_t foreperiodMs = prepare_round_screen();
+
+    sessionCount = 0;
+    power_beginSession();
+    while (round < SESSION_ROUNDS) {
+        sessionRound = round;
+        trace_begin(TRACE_ROUND, round);
+        display_flush();  // Waiting screen, composed while the last result was shown
         set_led_bar_position(round);  // Show progress on LED bar
-        led7seg_setChar('0' + round, FALSE);
-        adjust_theme();
-
-        // Display waiting screen with circle outline
-        oled_clearScreen(backgroundColor);
-        draw_circle(OLED_DISPLAY_WIDTH / 2, OLED_DISPLAY_HEIGHT / 2, 28, fontColor);
-        oled_putStringHorizontallyCentered(OLED_DISPLAY_HEIGHT / 2 - 4, "WAIT...");
+        seg7_setChar('0' + round);
         play_note(notes[2], 250);
 
-        // Random delay before stimulus (0.5-3.5 seconds)
-        uint32_t randomDelay = (rand() % 3000) + 500;
-        delay32Ms(0, randomDelay);
+        // Foreperiod after the cue, sampled while the last result was shown
+        clock_delayMs(foreperiodMs);
 
         fill_circle(OLED_DISPLAY_WIDTH / 2, OLED_DISPLAY_HEIGHT / 2, 28, fontColor);
+        display_flush();  // Stimulus onset
+        trace_instant(TRACE_STIMULUS, round);
+        input_stimulus();
 
         // Measure reaction time
         uint32_t reactionTimeMs = measure_reaction_time();
+        trace_instant(TRACE_RESULT, (uint16_t)reactionTimeMs);
+        DLOG("player %u round %u: %lu ms", currentPlayer, round, reactionTimeMs);
+        input_result(reactionTimeMs);
+        sessionTimes[sessionCount++] = (uint16_t)reactionTimeMs;
         totalTime += reactionTimeMs;
+        stats_addResult(reactionTimeMs);
+        exgauss_addResult(currentPlayer, reactionTimeMs);
+        lifetime_addResult(reactionTimeMs);
 
         // Display results
-        char reactionTimeMsString[5];
-        sprintf(reactionTimeMsString, "%u", reactionTimeMs);
-        oled_clearScreen(backgroundColor);
-        strcat(reactionTimeMsString, " ms");
-        oled_clearScreen(backgroundColor);
+        char reactionTimeMsString[16];
+        snprintf(reactionTimeMsString, sizeof(reactionTimeMsString), "%lu ms",
+                 (unsigned long)reactionTimeMs);
+        display_clearScreen(backgroundColor);
         oled_putStringHorizontallyCentered(OLED_DISPLAY_HEIGHT / 2, reactionTimeMsString);
+        display_flush();
 
         // Update high score if new record achieved
         if ((reactionTimeMs < highScoreMs) || (highScoreMs == (uint16_t)0)) {
             oled_putStringHorizontallyCentered(OLED_DISPLAY_HEIGHT / 2 + 12, "NEW RECORD!");
+            display_flush();
             set_high_score(reactionTimeMs);
             highScoreMs = reactionTimeMs;
             play_note(notes[0], 100);
@@ -567,23 +1211,299 @@ void start_game(void) {
             play_note(notes[10], 400);
         }
 
-        round++;
-        delay32Ms(0, 600);
+        // Compose the next screen; the panel keeps the result until it is flushed
+        uint32_t composeStartMs = clock_nowMs();
+        if (round + 1 < SESSION_ROUNDS) {
+            foreperiodMs = prepare_round_screen();
+        } else {
+            prepare_summary_screen(totalTime);
+        }
+        uint32_t composeMs = clock_nowMs() - composeStartMs;
+        if (composeMs < RESULT_HOLD_MS) {
+            clock_delayMs(RESULT_HOLD_MS - composeMs);
+        }
         wait_for_joystick_center_click();
+        trace_end(TRACE_ROUND, round);
+        round++;
     }
-    oled_clearScreen(backgroundColor);
-    oled_putStringHorizontallyCentered(10, "Game Complete!");
+    display_flush();  // Summary, composed while the last result was shown
+    clear_led_bar();
+    seg7_setChar('0');
+    power_endSession();
+    clock_delayMs(1000);
+    wait_for_joystick_center_click();
 
-    char avgTimeStr[16];
-    snprintf(avgTimeStr, sizeof(avgTimeStr), "Avg: %u ms", totalTime / 5);
-    oled_putStringHorizontallyCentered(25, avgTimeStr);
+    show_stats_screen();
+    sessionRound = SESSION_IDLE;
+}
 
-    char bestTimeStr[16];
-    snprintf(bestTimeStr, sizeof(bestTimeStr), "Best: %u ms", read_high_score());
-    oled_putStringHorizontallyCentered(40, bestTimeStr);
+/*****************************************************************************
+** Function name:       duel_round
+**
+** Description:         Shows the stimulus of a duel round at the given
+**                      time and times the click. The stimulus is composed
+**                      ahead, so only the flush happens at the scheduled
+**                      time, and timing starts once it is on the panel,
+**                      as in start_game(). Waits by polling input, which
+**                      keeps the link served with low latency.
+**
+** Parameters:          stimulusUs - stimulus time on this board's clock
+**                      click      - state and time stamp of the click
+** Returned value:      None
+*****************************************************************************/
+static void duel_round(uint64_t stimulusUs, duel_click_t *click)
+{
+    fill_circle(OLED_DISPLAY_WIDTH / 2, OLED_DISPLAY_HEIGHT / 2, 28, fontColor);
+
+    while (clock_nowUs() < stimulusUs) {
+        input_read();
+        clock_delayUs(DUEL_POLL_US);
+    }
+
+    display_flush();  // Stimulus onset
+    uint64_t armUs = clock_nowUs();
+    capture_arm();
+    input_stimulus();
+
+    click->us = armUs;
+    if (input_read() & JOYSTICK_CENTER) {
+        click->state = DUEL_CLICK_EARLY;
+        return;
+    }
+    while ((input_read() & JOYSTICK_CENTER) == 0) {
+        if (clock_nowUs() - armUs >= (uint64_t)DUEL_RESPONSE_MS * 1000) {
+            click->state = DUEL_CLICK_MISSED;
+            return;
+        }
+        clock_delayUs(DUEL_POLL_US);
+    }
+    click->state = DUEL_CLICK_DONE;
+    click->us = armUs + capture_elapsedUs(armUs);
+    input_result((uint32_t)((click->us - armUs) / 1000));
+}
+
+/*****************************************************************************
+** Function name:       show_duel_text
+**
+** Description:         Clears the screen and shows up to two lines.
+**
+** Parameters:          first  - upper line
+**                      second - lower line, may be NULL
+** Returned value:      None
+*****************************************************************************/
+static void show_duel_text(const char *first, const char *second)
+{
+    display_clearScreen(backgroundColor);
+    oled_putStringHorizontallyCentered(20, first);
+    if (second != NULL) {
+        oled_putStringHorizontallyCentered(32, second);
+    }
+    display_flush();
+}
+
+/*****************************************************************************
+** Function name:       show_duel_wait
+**
+** Description:         Waiting screen of a duel round.
+**
+** Parameters:          round - round number
+** Returned value:      None
+*****************************************************************************/
+static void show_duel_wait(uint8_t round)
+{
+    set_led_bar_position(round);
+    seg7_setChar('0' + round);
+    display_clearScreen(backgroundColor);
+    draw_circle(OLED_DISPLAY_WIDTH / 2, OLED_DISPLAY_HEIGHT / 2, 28, fontColor);
+    oled_putStringHorizontallyCentered(OLED_DISPLAY_HEIGHT / 2 - 4, "DUEL");
+    display_flush();
+}
+
+/*****************************************************************************
+** Function name:       show_duel_outcome
+**
+** Description:         Shows both reaction times of a round and who won,
+**                      from this board's side.
+**
+** Parameters:          outcome - judged round
+**                      leader  - 1 on the leading board
+** Returned value:      1 if this board won the round
+*****************************************************************************/
+static uint8_t show_duel_outcome(const duel_outcome_t *outcome, uint8_t leader)
+{
+    uint32_t mineUs = leader ? outcome->leaderUs : outcome->followerUs;
+    uint32_t theirsUs = leader ? outcome->followerUs : outcome->leaderUs;
+    uint8_t won = (outcome->winner == (leader ? DUEL_WIN_LEADER : DUEL_WIN_FOLLOWER));
+    char line[17];
+
+    display_clearScreen(backgroundColor);
+    if (mineUs != DUEL_NO_TIME) {
+        snprintf(line, sizeof(line), "You  %lu.%lu ms", (unsigned long)(mineUs / 1000),
+                 (unsigned long)((mineUs % 1000) / 100));
+    } else {
+        snprintf(line, sizeof(line), "You  --");
+    }
+    oled_putStringHorizontallyCentered(14, line);
+    if (theirsUs != DUEL_NO_TIME) {
+        snprintf(line, sizeof(line), "Them %lu.%lu ms", (unsigned long)(theirsUs / 1000),
+                 (unsigned long)((theirsUs % 1000) / 100));
+    } else {
+        snprintf(line, sizeof(line), "Them --");
+    }
+    oled_putStringHorizontallyCentered(26, line);
+
+    if (outcome->winner == DUEL_TIE) {
+        oled_putStringHorizontallyCentered(44, "TIE");
+    } else if (outcome->winner == DUEL_NO_WINNER) {
+        oled_putStringHorizontallyCentered(44, "NO WINNER");
+    } else {
+        oled_putStringHorizontallyCentered(44, won ? "YOU WIN" : "YOU LOSE");
+    }
+    display_flush();
+    if (won) {
+        play_note(notes[10], 200);
+    }
+    return won;
+}
+
+/*****************************************************************************
+** Function name:       duel_lead
+**
+** Description:         Leading side of a duel: synchronizes the peer's
+**                      clock before every round, schedules the stimulus on
+**                      both boards and judges the clicks.
+**
+** Parameters:          wins - rounds won by this board
+**                      losses - rounds won by the peer
+** Returned value:      1 if all rounds were played
+*****************************************************************************/
+static uint8_t duel_lead(uint8_t *wins, uint8_t *losses)
+{
+    show_duel_text("Duel", "Calling peer...");
+    if (duel_invite() != 0) {
+        return 0;
+    }
+    clock_delayMs(DUEL_SETTLE_MS);
+
+    for (uint8_t round = 0; round < DUEL_ROUNDS; round++) {
+        duel_click_t mine;
+        duel_click_t theirs;
+        duel_outcome_t outcome;
+
+        sessionRound = round;
+        show_duel_wait(round);
+        if (duel_sync() != 0) {
+            return 0;
+        }
+
+        uint64_t stimulusUs = clock_nowUs() +
+                              (uint64_t)((rand() % foreperiodRangeMs) + foreperiodMinMs) * 1000;
+        if (duel_schedule(round, stimulusUs) != 0) {
+            return 0;
+        }
+        duel_round(stimulusUs, &mine);
+
+        // The peer has the same response window; allow for the link
+        do {
+            if (duel_getFollowerClick(&theirs) != 0) {
+                return 0;
+            }
+        } while ((theirs.state == DUEL_CLICK_PENDING) &&
+                 (clock_nowUs() - stimulusUs < (uint64_t)(DUEL_RESPONSE_MS + DUEL_SETTLE_MS) * 1000));
+
+        duel_judge(round, stimulusUs, &mine, &theirs, &outcome);
+        if (duel_sendOutcome(&outcome) != 0) {
+            return 0;
+        }
+        if (show_duel_outcome(&outcome, 1)) {
+            (*wins)++;
+        } else if (outcome.winner == DUEL_WIN_FOLLOWER) {
+            (*losses)++;
+        }
+        clock_delayMs(DUEL_RESULT_MS);
+    }
+    return 1;
+}
+
+/*****************************************************************************
+** Function name:       duel_follow
+**
+** Description:         Following side of a duel: shows each stimulus when
+**                      the leader scheduled it and reports the click.
+**
+** Parameters:          wins - rounds won by this board
+**                      losses - rounds won by the peer
+** Returned value:      1 if all rounds were played
+*****************************************************************************/
+static uint8_t duel_follow(uint8_t *wins, uint8_t *losses)
+{
+    duel_acceptInvite();
+
+    for (uint8_t played = 0; played < DUEL_ROUNDS; played++) {
+        uint8_t round;
+        uint64_t stimulusUs;
+        duel_click_t mine;
+        duel_outcome_t outcome;
+        uint32_t startMs = clock_nowMs();
+
+        show_duel_wait(played);
+        while (!duel_takeRound(&round, &stimulusUs)) {
+            if (clock_nowMs() - startMs >= DUEL_IDLE_MS) {
+                return 0;
+            }
+            input_read();
+            clock_delayUs(DUEL_POLL_US);
+        }
+        sessionRound = round;
+        duel_round(stimulusUs, &mine);
+        duel_setClick(&mine);
+
+        startMs = clock_nowMs();
+        while (!duel_takeOutcome(&outcome)) {
+            if (clock_nowMs() - startMs >= DUEL_IDLE_MS) {
+                return 0;
+            }
+            input_read();
+            clock_delayUs(DUEL_POLL_US);
+        }
+        if (show_duel_outcome(&outcome, 0)) {
+            (*wins)++;
+        } else if (outcome.winner == DUEL_WIN_LEADER) {
+            (*losses)++;
+        }
+    }
+    return 1;
+}
+
+/*****************************************************************************
+** Function name:       start_duel
+**
+** Description:         Head-to-head game against a second board on the
+**                      serial link. The board whose player picks "Duel"
+**                      leads; a board invited from its main menu follows.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void start_duel(void)
+{
+    uint8_t wins = 0;
+    uint8_t losses = 0;
+    uint8_t completed;
+    char line[17];
+
+    if (duel_isInvited()) {
+        completed = duel_follow(&wins, &losses);
+    } else {
+        completed = duel_lead(&wins, &losses);
+    }
+    sessionRound = SESSION_IDLE;
     clear_led_bar();
-    led7seg_setChar('0', FALSE);
-    delay32Ms(0, 1000);
+    seg7_setChar('0');
+
+    snprintf(line, sizeof(line), "You %u - %u Them", wins, losses);
+    show_duel_text(completed ? "Duel over" : "Link lost", line);
+    clock_delayMs(1000);
     wait_for_joystick_center_click();
 }
 
@@ -593,6 +1513,8 @@ void start_game(void) {
 ** Description:         Processes menu navigation using joystick input.
 **                      Handles up/down navigation and center button selection.
 **                      Also monitors for board tilt to reset high score.
+**                      After a while without input the panel sleeps and
+**                      the sensors are left alone until the next press.
 **
 ** Parameters:          None
 ** Returned value:      Selected menu item index (MenuItem enum value)
@@ -600,37 +1522,76 @@ void start_game(void) {
 int handle_menu(void) {
     uint8_t previous_joy = 0xFF;  // Store previous joystick state for edge detection
 
+    sleep_touch();
     while (1) {
-        uint8_t joy = joystick_read();
+        uint8_t joy = input_read();
+
+        // Inactivity sleep; the press that wakes the menu selects nothing
+        if (sleep_poll(joy)) {
+            previous_joy = 0xFF;
+            continue;
+        }
+        busmon_loopTick();
+
+        // Session requested over the remote-control link
+        if (remoteStartPending) {
+            remoteStartPending = 0;
+            return MENU_START_GAME;
+        }
+        // Invited to a duel by the board at the other end of the link
+        if (duel_isInvited()) {
+            return MENU_DUEL;
+        }
 
         // Navigate down (with edge detection to prevent rapid scrolling)
         if ((joy & JOYSTICK_DOWN) && !(previous_joy & JOYSTICK_DOWN)) {
-            selectedIndex = (selectedIndex + 1) % MENU_ITEM_COUNT;
-            draw_menu();
+            latency_event(LATENCY_NAV);
+            listview_next(&menuList);
+            display_flush();
         }
         // Navigate up (with wraparound)
         else if ((joy & JOYSTICK_UP) && !(previous_joy & JOYSTICK_UP)) {
-            selectedIndex = (selectedIndex - 1 + MENU_ITEM_COUNT) % MENU_ITEM_COUNT;
-            draw_menu();
+            latency_event(LATENCY_NAV);
+            listview_prev(&menuList);
+            display_flush();
         }
         // Select current item
         else if ((joy & JOYSTICK_CENTER) && !(previous_joy & JOYSTICK_CENTER)) {
-            return selectedIndex;
+            latency_event(LATENCY_SELECT);
+            return menuList.selected;
+        }
+        // Hidden diagnostics screen
+        else if ((joy & JOYSTICK_LEFT) && !(previous_joy & JOYSTICK_LEFT)) {
+            latency_event(LATENCY_SELECT);
+            show_diagnostics_screen();
+            draw_menu();
+            joy = input_read();
+        }
+        // Send the log, the event trace, in PROFILE builds the sampling
+        // profile, and the power report of the last session over serial
+        else if ((joy & JOYSTICK_RIGHT) && !(previous_joy & JOYSTICK_RIGHT)) {
+            dlog_dump();
+            trace_dump();
+            profile_dump();
+            power_dump();
         }
 
         previous_joy = joy;
 
         // Easter egg: Reset high score when board is tilted
         if (is_board_tilted()) {
+            latency_event(LATENCY_TILT);
             set_high_score(9999);
             oled_putStringHorizontallyCentered((OLED_DISPLAY_HEIGHT / 2) + 16, "Reset HS");
-            delay32Ms(0, 500);
+            display_flush();
+            clock_delayMs(500);
         }
 
-        if (adjust_theme()) {
+        if (adjust_theme() || remoteMenuStale) {
+            remoteMenuStale = 0;
         	draw_menu();
         }
-        delay32Ms(0, 50);
+        clock_delayMs(50);
     }
 }
 
@@ -645,10 +1606,13 @@ int handle_menu(void) {
 ** Returned value:      None
 *****************************************************************************/
 void show_main_menu(void) {
+    init_menu();
+
     while(1) {
         draw_menu();
         MenuItem selection = handle_menu();
-        oled_clearScreen(backgroundColor);
+        display_clearScreen(backgroundColor);
+        display_flush();
         play_note(notes[0], 200);
 
         switch (selection) {
@@ -656,41 +1620,174 @@ void show_main_menu(void) {
                 start_game();
                 break;
 
+            case MENU_DUEL:
+                start_duel();
+                break;
+
+            case MENU_PLAYER:
+                currentPlayer = (currentPlayer + 1) % EXGAUSS_PLAYERS;
+                break;
+
             case MENU_RESET_SCORE:
                 set_high_score(9999);
                 oled_putStringHorizontallyCentered((OLED_DISPLAY_HEIGHT / 2) + 16, "Reset HS");
-                delay32Ms(0, 800);
+                display_flush();
+                clock_delayMs(800);
                 break;
 
 			case SHOW_HIGH_SCORE:
+				if (lifetime_getCount() > 0) {
+					char line[16];
+					static const uint8_t percents[3] = { 10, 50, 90 };
+					for (uint8_t i = 0; i < 3; i++) {
+						snprintf(line, sizeof(line), "p%u: %u ms", percents[i], lifetime_percentile(percents[i]));
+						oled_putStringHorizontallyCentered(2 + i * 10, line);
+					}
+				}
 				oled_putStringHorizontallyCentered(32, "High score:");
 				uint16_t highScoreMs = read_high_score();
-				char highScoreMsString[8];
+				char highScoreMsString[12];
 				sprintf(highScoreMsString, "%u ms", highScoreMs);
 				oled_putStringHorizontallyCentered(42, highScoreMsString);
-				delay32Ms(0, 1000);
+				display_flush();
+				clock_delayMs(1000);
 				wait_for_joystick_center_click();
 				break;
 
+            case MENU_STATISTICS:
+                show_stats_screen();
+                break;
+
+            case MENU_SHARE:
+                show_share_screen();
+                break;
+
+            case MENU_CALIBRATE:
+                oled_putStringHorizontallyCentered(20, "Lay board flat");
+                oled_putStringHorizontallyCentered(32, "and press");
+                display_flush();
+                clock_delayMs(500);
+                wait_for_joystick_center_click();
+                clock_delayMs(500);  // Let the board settle after the click
+                init_tilt_calibration();
+                oled_putStringHorizontallyCentered(48, "Calibrated");
+                display_flush();
+                play_note(notes[12], 150);
+                clock_delayMs(800);
+                break;
+
             case MENU_CREDITS:
                 oled_putStringHorizontallyCentered(20, "by");
                 oled_putStringHorizontallyCentered(32, "group");
                 oled_putStringHorizontallyCentered(44, "G02 :D");
+                display_flush();
                 play_star_wars_theme();
                 break;
 
             case MENU_EXIT:
                 oled_putStringHorizontallyCentered(20, "Exiting...");
+                display_flush();
                 play_note(notes[10], 200);
                 play_note(notes[5], 200);
                 play_note(notes[1], 200);
-                delay32Ms(0, 400);
-                oled_clearScreen(backgroundColor);
+                clock_delayMs(400);
+                display_clearScreen(backgroundColor);
+                display_flush();
                 return;
         }
     }
 }
 
+/*****************************************************************************
+** Function name:       remote_command
+**
+** Description:         Handles the game commands of the remote-control
+**                      link (see remote.h). Runs inside input_read(), so
+**                      it only records requests; a session is started by
+**                      handle_menu(), from the main menu only. Commands
+**                      from a duel leader go on to duel_command().
+**
+** Parameters:          cmd      - REMOTE_CMD_* command
+**                      payload  - command payload
+**                      len      - payload length
+**                      reply    - reply payload to fill
+**                      replyLen - reply payload length
+** Returned value:      0, or a REMOTE_ERR_* code
+*****************************************************************************/
+static uint8_t remote_command(uint8_t cmd, const uint8_t *payload, uint8_t len,
+                              uint8_t *reply, uint8_t *replyLen)
+{
+    uint32_t total = 0;
+
+    switch (cmd) {
+    case REMOTE_CMD_STATUS:
+        reply[0] = sessionRound;
+        reply[1] = currentPlayer;
+        reply[2] = (uint8_t)foreperiodMinMs;
+        reply[3] = (uint8_t)(foreperiodMinMs >> 8);
+        reply[4] = (uint8_t)foreperiodRangeMs;
+        reply[5] = (uint8_t)(foreperiodRangeMs >> 8);
+        *replyLen = 6;
+        return 0;
+
+    case REMOTE_CMD_PLAYER:
+        if (len != 1) {
+            return REMOTE_ERR_LENGTH;
+        }
+        if (payload[0] >= EXGAUSS_PLAYERS) {
+            return REMOTE_ERR_VALUE;
+        }
+        if (sessionRound != SESSION_IDLE) {
+            return REMOTE_ERR_BUSY;
+        }
+        currentPlayer = payload[0];
+        remoteMenuStale = 1;
+        return 0;
+
+    case REMOTE_CMD_FOREPERIOD: {
+        if (len != 4) {
+            return REMOTE_ERR_LENGTH;
+        }
+        uint16_t minMs = (uint16_t)(payload[0] | (payload[1] << 8));
+        uint16_t rangeMs = (uint16_t)(payload[2] | (payload[3] << 8));
+        if ((rangeMs == 0) || ((uint32_t)minMs + rangeMs > FOREPERIOD_MAX_MS)) {
+            return REMOTE_ERR_VALUE;
+        }
+        foreperiodMinMs = minMs;
+        foreperiodRangeMs = rangeMs;
+        return 0;
+    }
+
+    case REMOTE_CMD_START:
+        if ((sessionRound != SESSION_IDLE) || remoteStartPending) {
+            return REMOTE_ERR_BUSY;
+        }
+        remoteStartPending = 1;
+        return 0;
+
+    case REMOTE_CMD_RESULTS:
+        reply[0] = currentPlayer;
+        reply[1] = sessionCount;
+        for (uint8_t i = 0; i < sessionCount; i++) {
+            reply[2 + 2 * i] = (uint8_t)sessionTimes[i];
+            reply[3 + 2 * i] = (uint8_t)(sessionTimes[i] >> 8);
+            total += sessionTimes[i];
+        }
+        total = (sessionCount > 0) ? total / sessionCount : 0;
+        reply[2 + 2 * sessionCount] = (uint8_t)total;
+        reply[3 + 2 * sessionCount] = (uint8_t)(total >> 8);
+        *replyLen = 4 + 2 * sessionCount;
+        return 0;
+
+    case REMOTE_CMD_DUEL_JOIN:
+        if ((sessionRound != SESSION_IDLE) || remoteStartPending) {
+            return REMOTE_ERR_BUSY;
+        }
+        break;
+    }
+    return duel_command(cmd, payload, len, reply, replyLen);
+}
+
 /*****************************************************************************
 ** Function name:       main
 **
@@ -703,11 +1800,18 @@ void show_main_menu(void) {
 ** Returned value:      Integer
 *****************************************************************************/
 int main(void) {
+    // Paint the free stack first so its high-water mark covers everything
+    stack_paint();
+
+    // Interrupt priorities before anything enables an interrupt
+    irqprio_init();
+
     // Initialize GPIO subsystem (required for most peripherals)
     GPIOInit();
 
     // Initialize 32-bit timers for timing functions
     init_timer32(0, 10);  // Timer 0
+    clock_init();         // Millisecond clock for time stamps
 
     // Initialize I2C bus as master for sensor communication
     I2CInit((uint32_t)I2CMASTER, 0);
@@ -715,21 +1819,30 @@ int main(void) {
     // Initialize SPI (SSP) for OLED communication
     SSPInit();
 
-    // Initialize OLED display module
+    // Initialize OLED and 7-segment displays, then arbitrate the shared
+    // SSP bus between them and take over drawing
     oled_init();
+    led7seg_init();
+    sspbus_init();
+    display_init();
     
     // Initialize and enable ambient light sensor (ISL29003)
     light_init();
     light_enable();
-    led7seg_init();
 
     // Seed random number generator with light sensor reading
 	srand(light_read());
+    init_light_interrupt();
     pca9532_init();
     clear_led_bar();
     eeprom_init();
+    lifetime_init();
+    serial_init();
+    remote_init(remote_command);
+    DLOG("boot, reset source %lx", LPC_SYSCON->SYSRESSTAT);
     acc_init();
     joystick_init();
+    capture_init();
 
     /* ---- Speaker Hardware Setup ---- */
 
@@ -750,6 +1863,9 @@ int main(void) {
 
     /* ---- End Speaker Setup ---- */
 
+    // Every driver is up: from here on peripheral clocks run on demand
+    power_init();
+
     // Initialize display theme based on ambient light
     adjust_theme();
 
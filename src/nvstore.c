@@ -0,0 +1,77 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Access to the persistent store with a page write counter.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+#include "eeprom.h"
+
+#include "busmon.h"
+#include "eeprom_map.h"
+#include "nvstore.h"
+#include "power.h"
+#include "trace.h"
+
+/* EEPROM page write cycles since power-on */
+static uint32_t pageWrites;
+
+/*****************************************************************************
+** Function name:       nvstore_read
+**
+** Description:         Reads a byte range.
+**
+** Parameters:          buf  - destination
+**                      addr - EEPROM address
+**                      len  - number of bytes
+** Returned value:      None
+*****************************************************************************/
+void nvstore_read(uint8_t *buf, uint16_t addr, uint16_t len)
+{
+    power_acquire(POWER_EEPROM);
+    uint32_t start = busmon_now();
+
+    eeprom_read(buf, addr, len);
+    busmon_addI2c(busmon_now() - start);
+    power_release(POWER_EEPROM);
+}
+
+/*****************************************************************************
+** Function name:       nvstore_write
+**
+** Description:         Writes a byte range and counts one write cycle for
+**                      every EEPROM page it touches.
+**
+** Parameters:          buf  - source
+**                      addr - EEPROM address
+**                      len  - number of bytes
+** Returned value:      None
+*****************************************************************************/
+void nvstore_write(uint8_t *buf, uint16_t addr, uint16_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    power_acquire(POWER_EEPROM);
+    uint32_t start = busmon_now();
+
+    trace_begin(TRACE_EEPROM, addr);
+    eeprom_write(buf, addr, len);
+    trace_end(TRACE_EEPROM, addr);
+    busmon_addI2c(busmon_now() - start);
+    power_release(POWER_EEPROM);
+    pageWrites += ((addr + len - 1) / EEPROM_PAGE_SIZE) - (addr / EEPROM_PAGE_SIZE) + 1;
+}
+
+/*****************************************************************************
+** Function name:       nvstore_getWriteCount
+**
+** Description:         Number of page write cycles since power-on.
+**
+** Parameters:          None
+** Returned value:      Page writes
+*****************************************************************************/
+uint32_t nvstore_getWriteCount(void)
+{
+    return pageWrites;
+}
@@ -0,0 +1,16 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Access to the persistent store (24LC08B EEPROM). Thin
+ *                wrapper over the eeprom driver that counts page writes,
+ *                so wear and write batching can be checked.
+ *
+ ******************************************************************************/
+
+#ifndef __NVSTORE_H
+#define __NVSTORE_H
+
+void nvstore_read(uint8_t *buf, uint16_t addr, uint16_t len);
+void nvstore_write(uint8_t *buf, uint16_t addr, uint16_t len);
+uint32_t nvstore_getWriteCount(void);
+
+#endif /* end __NVSTORE_H */
@@ -0,0 +1,84 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Little-endian fields of remote-link payloads, shared by
+ *                the protocol (remote.c) and the duel commands (duel.c).
+ *                The put functions return the byte after the field so a
+ *                payload can be written field by field.
+ *
+ ******************************************************************************/
+
+#ifndef __PAYLOAD_H
+#define __PAYLOAD_H
+
+/*****************************************************************************
+** Function name:       payload_getU16
+**
+** Description:         Reads a little-endian u16 of a payload.
+**
+** Parameters:          p - first byte
+** Returned value:      Value
+*****************************************************************************/
+static inline uint16_t payload_getU16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/*****************************************************************************
+** Function name:       payload_getU32
+**
+** Description:         Reads a little-endian u32 of a payload.
+**
+** Parameters:          p - first byte
+** Returned value:      Value
+*****************************************************************************/
+static inline uint32_t payload_getU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*****************************************************************************
+** Function name:       payload_getU64
+**
+** Description:         Reads a little-endian u64 of a payload.
+**
+** Parameters:          p - first byte
+** Returned value:      Value
+*****************************************************************************/
+static inline uint64_t payload_getU64(const uint8_t *p)
+{
+    return (uint64_t)payload_getU32(p) | ((uint64_t)payload_getU32(p + 4) << 32);
+}
+
+/*****************************************************************************
+** Function name:       payload_putU32
+**
+** Description:         Writes a little-endian u32 into a payload.
+**
+** Parameters:          p     - first byte
+**                      value - value to write
+** Returned value:      Byte after the value
+*****************************************************************************/
+static inline uint8_t *payload_putU32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+/*****************************************************************************
+** Function name:       payload_putU64
+**
+** Description:         Writes a little-endian u64 into a payload.
+**
+** Parameters:          p     - first byte
+**                      value - value to write
+** Returned value:      Byte after the value
+*****************************************************************************/
+static inline uint8_t *payload_putU64(uint8_t *p, uint64_t value)
+{
+    return payload_putU32(payload_putU32(p, (uint32_t)value), (uint32_t)(value >> 32));
+}
+
+#endif /* end __PAYLOAD_H */
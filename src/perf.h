@@ -0,0 +1,50 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Cycle-accurate timing through the Cortex-M3 DWT cycle
+ *                counter (CYCCNT, core clock, wraps every ~59 s at 72 MHz).
+ *                Built with CLOCK_VIRTUAL the count follows simulated time.
+ *
+ ******************************************************************************/
+
+#ifndef __PERF_H
+#define __PERF_H
+
+#ifndef CLOCK_VIRTUAL
+
+#define PERF_DEMCR          (*(volatile uint32_t *)0xE000EDFC)
+#define PERF_DWT_CTRL       (*(volatile uint32_t *)0xE0001000)
+#define PERF_DWT_CYCCNT     (*(volatile uint32_t *)0xE0001004)
+
+#define PERF_DEMCR_TRCENA   ((uint32_t)1 << 24)
+#define PERF_DWT_CYCCNTENA  ((uint32_t)1 << 0)
+
+/* Current core cycle count; differences are valid across one wrap */
+#define PERF_CYCLES()       (PERF_DWT_CYCCNT)
+
+/*****************************************************************************
+** Function name:       perf_init
+**
+** Description:         Enables the DWT cycle counter.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static inline void perf_init(void)
+{
+    PERF_DEMCR |= PERF_DEMCR_TRCENA;
+    PERF_DWT_CYCCNT = 0;
+    PERF_DWT_CTRL |= PERF_DWT_CYCCNTENA;
+}
+
+#else /* CLOCK_VIRTUAL */
+
+#include "clock.h"
+
+/* Host: core cycles at SystemFrequency, counted from simulated time */
+#define PERF_CYCLES()       ((uint32_t)(clock_nowUs() * (SystemFrequency / 1000000)))
+
+#define perf_init()
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __PERF_H */
@@ -0,0 +1,332 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Peripheral clock gating and energy accounting, see
+ *                power.h.
+ *
+ ******************************************************************************/
+
+#include "mcu_regs.h"
+#include "type.h"
+#include "i2c.h"
+#include "ssp.h"
+
+#include "busmon.h"
+#include "clock.h"
+#include "dlog.h"
+#include "serial.h"
+#include "power.h"
+
+#define POWER_NO_CLOCK      0xFF
+
+/* SYSAHBCLKCTRL bits */
+#define AHBCLK_I2C          (1 << 5)
+#define AHBCLK_CT16B0       (1 << 7)
+#define AHBCLK_CT16B1       (1 << 8)
+#define AHBCLK_CT32B1       (1 << 10)
+#define AHBCLK_SSP          (1 << 11)
+#define AHBCLK_ADC          (1 << 13)
+#define AHBCLK_USBREG       (1 << 14)
+#define AHBCLK_WDT          (1 << 15)
+
+/* Blocks the game never uses */
+#define AHBCLK_UNUSED       (AHBCLK_CT16B0 | AHBCLK_CT16B1 | AHBCLK_ADC | AHBCLK_USBREG | AHBCLK_WDT)
+
+/* Supply voltage of the energy estimate, in tenths of a volt */
+#define SUPPLY_DECIVOLTS    33
+
+static const uint8_t consumerClock[POWER_CONSUMERS] = {
+    POWER_CLOCK_I2C, POWER_CLOCK_I2C, POWER_CLOCK_I2C, POWER_CLOCK_I2C,
+    POWER_CLOCK_SSP, POWER_NO_CLOCK, POWER_CLOCK_CT32B1
+};
+
+/*
+ * Typical supply current while a consumer is held: bus block, pull-ups
+ * and the device at the other end. The speaker figure is the amplifier
+ * driving the square wave.
+ */
+static const uint16_t consumerMicroAmps[POWER_CONSUMERS] = {
+    500, 400, 2000, 600, 1500, 15000, 150
+};
+
+/* Typical current of a clocked but idle block at 72 MHz */
+static const uint16_t clockMicroAmps[POWER_CLOCKS] = {
+    250, 400, 150
+};
+
+static const char *const consumerNames[POWER_CONSUMERS] = {
+    "acc", "light", "eeprom", "leds", "displays", "audio", "load"
+};
+
+static const char *const clockNames[POWER_CLOCKS] = {
+    "i2c", "ssp", "ct32b1"
+};
+
+/* Reference counts and the start of the current held period */
+static uint8_t consumerRefs[POWER_CONSUMERS];
+static uint32_t consumerSince[POWER_CONSUMERS];
+static uint8_t clockUsers[POWER_CLOCKS];
+static uint32_t clockSince[POWER_CLOCKS];
+
+/* Held time since power-on, and its value at the start of the session */
+static power_report_t totals;
+static power_report_t baseline;
+static uint64_t sessionStartUs;
+
+/* Report of the last finished session */
+static power_report_t session;
+
+/* Clocks are only gated once power_init() has run */
+static uint8_t gating;
+
+#ifndef CLOCK_VIRTUAL
+
+static const uint32_t clockMask[POWER_CLOCKS] = {
+    AHBCLK_I2C, AHBCLK_SSP, AHBCLK_CT32B1
+};
+
+/*****************************************************************************
+** Function name:       waitIdle
+**
+** Description:         Waits until a block has finished its last bus
+**                      cycle, so its clock can be stopped.
+**
+** Parameters:          clock - POWER_CLOCK_* index
+** Returned value:      None
+*****************************************************************************/
+static void waitIdle(uint8_t clock)
+{
+    if (clock == POWER_CLOCK_I2C) {
+        while (LPC_I2C->CONSET & I2CONSET_STO);
+    } else if (clock == POWER_CLOCK_SSP) {
+        while (LPC_SSP->SR & SSPSR_BSY);
+    }
+}
+
+#define CLOCK_ON(clock)     (LPC_SYSCON->SYSAHBCLKCTRL |= clockMask[clock])
+#define CLOCK_OFF(clock)    do { waitIdle(clock); LPC_SYSCON->SYSAHBCLKCTRL &= ~clockMask[clock]; } while (0)
+
+#else /* CLOCK_VIRTUAL */
+
+#define CLOCK_ON(clock)
+#define CLOCK_OFF(clock)
+
+#endif /* CLOCK_VIRTUAL */
+
+/*****************************************************************************
+** Function name:       settle
+**
+** Description:         Adds the running held periods to the totals and
+**                      restarts them, so the totals are current.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void settle(void)
+{
+    uint32_t now = busmon_now();
+
+    for (uint8_t i = 0; i < POWER_CONSUMERS; i++) {
+        if (consumerRefs[i] > 0) {
+            totals.activeUs[i] += busmon_ticksToUs(now - consumerSince[i]);
+            consumerSince[i] = now;
+        }
+    }
+    for (uint8_t k = 0; k < POWER_CLOCKS; k++) {
+        if (clockUsers[k] > 0) {
+            totals.clockOnUs[k] += busmon_ticksToUs(now - clockSince[k]);
+            clockSince[k] = now;
+        }
+    }
+}
+
+/*****************************************************************************
+** Function name:       power_init
+**
+** Description:         Starts gating, after the library drivers have
+**                      brought their devices up with all clocks running:
+**                      switches off the blocks the game never uses and
+**                      the gated clocks nobody holds.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void power_init(void)
+{
+#ifndef CLOCK_VIRTUAL
+    LPC_SYSCON->SYSAHBCLKCTRL &= ~AHBCLK_UNUSED;
+#endif
+    for (uint8_t k = 0; k < POWER_CLOCKS; k++) {
+        if (clockUsers[k] == 0) {
+            CLOCK_OFF(k);
+        }
+    }
+    gating = 1;
+}
+
+/*****************************************************************************
+** Function name:       power_acquire
+**
+** Description:         Takes a reference on a consumer, starting the clock
+**                      of its block if it was stopped. Calls nest.
+**
+** Parameters:          consumer - POWER_* consumer
+** Returned value:      None
+*****************************************************************************/
+void power_acquire(uint8_t consumer)
+{
+    if (consumerRefs[consumer]++ > 0) {
+        return;
+    }
+    uint32_t now = busmon_now();
+    uint8_t clock = consumerClock[consumer];
+
+    consumerSince[consumer] = now;
+    if ((clock != POWER_NO_CLOCK) && (clockUsers[clock]++ == 0)) {
+        CLOCK_ON(clock);
+        clockSince[clock] = now;
+    }
+}
+
+/*****************************************************************************
+** Function name:       power_release
+**
+** Description:         Drops a reference taken by power_acquire(). The
+**                      last reference on a block stops its clock once the
+**                      block is idle.
+**
+** Parameters:          consumer - POWER_* consumer
+** Returned value:      None
+*****************************************************************************/
+void power_release(uint8_t consumer)
+{
+    if ((consumerRefs[consumer] == 0) || (--consumerRefs[consumer] > 0)) {
+        return;
+    }
+    uint32_t now = busmon_now();
+    uint8_t clock = consumerClock[consumer];
+
+    totals.activeUs[consumer] += busmon_ticksToUs(now - consumerSince[consumer]);
+    if ((clock != POWER_NO_CLOCK) && (--clockUsers[clock] == 0)) {
+        totals.clockOnUs[clock] += busmon_ticksToUs(now - clockSince[clock]);
+        if (gating) {
+            CLOCK_OFF(clock);
+        }
+    }
+}
+
+/*****************************************************************************
+** Function name:       power_beginSession
+**
+** Description:         Starts the accounting of a session.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void power_beginSession(void)
+{
+    settle();
+    baseline = totals;
+    sessionStartUs = clock_nowUs();
+}
+
+/*****************************************************************************
+** Function name:       power_endSession
+**
+** Description:         Ends the accounting of a session and keeps its
+**                      report for power_getReport() and power_dump().
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void power_endSession(void)
+{
+    settle();
+    session.sessionUs = (uint32_t)(clock_nowUs() - sessionStartUs);
+    session.microJoules = 0;
+    for (uint8_t i = 0; i < POWER_CONSUMERS; i++) {
+        session.activeUs[i] = totals.activeUs[i] - baseline.activeUs[i];
+        session.microJoules += power_consumerMicroJoules(&session, i);
+    }
+    for (uint8_t k = 0; k < POWER_CLOCKS; k++) {
+        session.clockOnUs[k] = totals.clockOnUs[k] - baseline.clockOnUs[k];
+    }
+    DLOG("session power: %lu ms, %lu uJ in peripherals",
+         session.sessionUs / 1000, session.microJoules);
+}
+
+/*****************************************************************************
+** Function name:       power_consumerMicroJoules
+**
+** Description:         Energy estimate of a consumer over a session.
+**
+** Parameters:          report   - session report
+**                      consumer - POWER_* consumer
+** Returned value:      Energy in microjoules
+*****************************************************************************/
+uint32_t power_consumerMicroJoules(const power_report_t *report, uint8_t consumer)
+{
+    return (uint32_t)(((uint64_t)consumerMicroAmps[consumer] * report->activeUs[consumer] *
+                       SUPPLY_DECIVOLTS) / 10000000);
+}
+
+/*****************************************************************************
+** Function name:       power_savedMicroJoules
+**
+** Description:         Energy a gated clock saved over a session against
+**                      running all the time.
+**
+** Parameters:          report - session report
+**                      clock  - POWER_CLOCK_* index
+** Returned value:      Energy in microjoules
+*****************************************************************************/
+uint32_t power_savedMicroJoules(const power_report_t *report, uint8_t clock)
+{
+    uint32_t offUs = report->sessionUs - report->clockOnUs[clock];
+
+    if (report->clockOnUs[clock] > report->sessionUs) {
+        offUs = 0;
+    }
+    return (uint32_t)(((uint64_t)clockMicroAmps[clock] * offUs * SUPPLY_DECIVOLTS) / 10000000);
+}
+
+/*****************************************************************************
+** Function name:       power_getReport
+**
+** Description:         Report of the last finished session.
+**
+** Parameters:          None
+** Returned value:      Session report, all zero before the first session
+*****************************************************************************/
+const power_report_t *power_getReport(void)
+{
+    return &session;
+}
+
+/*****************************************************************************
+** Function name:       power_dump
+**
+** Description:         Sends the report of the last finished session over
+**                      the serial link:
+**
+**                          power begin session_us=N uj=E
+**                          p <consumer> <held us> <estimated uJ>
+**                          c <clock> <running us> <saved uJ>
+**                          power end
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void power_dump(void)
+{
+    serial_printf("power begin session_us=%lu uj=%lu\r\n", (unsigned long)session.sessionUs,
+                  (unsigned long)session.microJoules);
+    for (uint8_t i = 0; i < POWER_CONSUMERS; i++) {
+        serial_printf("p %s %lu %lu\r\n", consumerNames[i], (unsigned long)session.activeUs[i],
+                      (unsigned long)power_consumerMicroJoules(&session, i));
+    }
+    for (uint8_t k = 0; k < POWER_CLOCKS; k++) {
+        serial_printf("c %s %lu %lu\r\n", clockNames[k], (unsigned long)session.clockOnUs[k],
+                      (unsigned long)power_savedMicroJoules(&session, k));
+    }
+    serial_write("power end\r\n");
+}
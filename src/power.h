@@ -0,0 +1,57 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Peripheral clock gating. Drivers acquire the consumer
+ *                they are about to use and release it afterwards; the
+ *                AHB clock of a block (SYSAHBCLKCTRL) runs only while at
+ *                least one of its consumers is held. Blocks the game never
+ *                uses are switched off for good by power_init().
+ *
+ *                The time each consumer is held is accounted, and over a
+ *                session this gives an energy estimate per consumer and
+ *                the energy saved by gating each clock. The figures come
+ *                from typical currents, not a measurement; they are meant
+ *                for comparing sessions and firmware versions.
+ *
+ *                Thread level only, not from interrupt handlers. Built
+ *                with CLOCK_VIRTUAL only the accounting runs.
+ *
+ ******************************************************************************/
+
+#ifndef __POWER_H
+#define __POWER_H
+
+/* Consumers */
+#define POWER_ACC           0   /* accelerometer reads, I2C */
+#define POWER_LIGHT         1   /* light sensor, I2C */
+#define POWER_EEPROM        2   /* persistent store, I2C */
+#define POWER_LEDS          3   /* LED bar, I2C */
+#define POWER_DISPLAYS      4   /* OLED and 7-segment transfers, SSP */
+#define POWER_AUDIO         5   /* speaker, no clock of its own */
+#define POWER_LOAD          6   /* self-test load timer, Timer32_1 */
+#define POWER_CONSUMERS     7
+
+/* Gated clocks */
+#define POWER_CLOCK_I2C     0
+#define POWER_CLOCK_SSP     1
+#define POWER_CLOCK_CT32B1  2
+#define POWER_CLOCKS        3
+
+/* Accounting of one session, times in microseconds */
+typedef struct {
+    uint32_t sessionUs;
+    uint32_t microJoules;               /* estimate over all consumers */
+    uint32_t activeUs[POWER_CONSUMERS];
+    uint32_t clockOnUs[POWER_CLOCKS];
+} power_report_t;
+
+void power_init(void);
+void power_acquire(uint8_t consumer);
+void power_release(uint8_t consumer);
+void power_beginSession(void);
+void power_endSession(void);
+uint32_t power_consumerMicroJoules(const power_report_t *report, uint8_t consumer);
+uint32_t power_savedMicroJoules(const power_report_t *report, uint8_t clock);
+const power_report_t *power_getReport(void);
+void power_dump(void);
+
+#endif /* end __POWER_H */
@@ -0,0 +1,96 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Statistical sampling profiler, see profile.h.
+ *
+ ******************************************************************************/
+
+#if defined(PROFILE) && !defined(CLOCK_VIRTUAL)
+
+#include "type.h"
+
+#include "profile.h"
+#include "serial.h"
+
+#include <string.h>
+
+/* Samples per 64-byte block of flash, saturating */
+static uint16_t buckets[PROFILE_BUCKETS];
+
+/* Samples outside flash (e.g. code in RAM) and in total */
+static uint32_t outside;
+static uint32_t total;
+
+/* Set while dumping, so the dump itself is not profiled */
+static volatile uint8_t paused;
+
+/*****************************************************************************
+** Function name:       profile_sample
+**
+** Description:         Records one sample. Called from SysTick_Handler with
+**                      the PC stacked on exception entry.
+**
+** Parameters:          pc - interrupted program counter
+** Returned value:      None
+*****************************************************************************/
+void profile_sample(uint32_t pc)
+{
+    if (paused) {
+        return;
+    }
+    total++;
+    if (pc >= PROFILE_FLASH_SIZE) {
+        outside++;
+        return;
+    }
+    uint16_t *bucket = &buckets[pc >> PROFILE_BUCKET_SHIFT];
+    if (*bucket != 0xFFFF) {
+        (*bucket)++;
+    }
+}
+
+/*****************************************************************************
+** Function name:       profile_reset
+**
+** Description:         Clears the histogram.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void profile_reset(void)
+{
+    paused = 1;
+    memset(buckets, 0, sizeof(buckets));
+    outside = 0;
+    total = 0;
+    paused = 0;
+}
+
+/*****************************************************************************
+** Function name:       profile_dump
+**
+** Description:         Sends the histogram over the serial link, one line
+**                      per non-empty bucket with its start address, then
+**                      clears it. Format, read by tools/profsym.py:
+**
+**                          profile begin shift=6 total=N outside=M
+**                          p 00001a40 123
+**                          profile end
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void profile_dump(void)
+{
+    paused = 1;
+    serial_printf("profile begin shift=%u total=%lu outside=%lu\r\n", PROFILE_BUCKET_SHIFT,
+                  (unsigned long)total, (unsigned long)outside);
+    for (uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+        if (buckets[i] != 0) {
+            serial_printf("p %08lx %u\r\n", (unsigned long)(i << PROFILE_BUCKET_SHIFT), buckets[i]);
+        }
+    }
+    serial_write("profile end\r\n");
+    profile_reset();
+}
+
+#endif /* PROFILE */
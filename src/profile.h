@@ -0,0 +1,36 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Statistical sampling profiler. Every SysTick records the
+ *                interrupted program counter in a histogram over flash;
+ *                the histogram is dumped over the serial link and mapped
+ *                to functions on the host with tools/profsym.py and the
+ *                ELF symbols of the same build.
+ *
+ *                Costs 1 KB of RAM, so it is only built with PROFILE
+ *                defined; otherwise all calls compile away.
+ *
+ ******************************************************************************/
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#if defined(PROFILE) && !defined(CLOCK_VIRTUAL)
+
+/* Flash covered by the histogram and its resolution */
+#define PROFILE_FLASH_SIZE      0x8000
+#define PROFILE_BUCKET_SHIFT    6       /* 64-byte buckets */
+#define PROFILE_BUCKETS         (PROFILE_FLASH_SIZE >> PROFILE_BUCKET_SHIFT)
+
+void profile_sample(uint32_t pc);
+void profile_reset(void);
+void profile_dump(void);
+
+#else
+
+#define profile_sample(pc)
+#define profile_reset()
+#define profile_dump()
+
+#endif /* PROFILE */
+
+#endif /* end __PROFILE_H */
@@ -0,0 +1,489 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: QR code encoder, see qr.h. Follows ISO/IEC 18004: data
+ *                bits are placed in the two-column zigzag, all eight
+ *                masks are scored with the standard penalty rules and
+ *                the best one is kept.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "display.h"
+#include "qr.h"
+
+/* Error correction codewords and data capacity per version, level L */
+static const uint8_t eccCodewords[QR_VERSION_MAX] = { 7, 10, 15 };
+static const uint8_t dataCodewords[QR_VERSION_MAX] = { 19, 34, 55 };
+
+#define CODEWORDS_MAX       70
+
+/* Mode indicator and character count bits of byte mode, versions 1-9 */
+#define MODE_BYTE           0x4
+#define COUNT_BITS          8
+
+/* Level L format bits, before the BCH code */
+#define FORMAT_LEVEL_L      0x1
+
+/* GF(256) with polynomial x^8 + x^4 + x^3 + x^2 + 1: powers of 2 ... */
+static const uint8_t gfExp[255] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1D, 0x3A, 0x74, 0xE8, 0xCD, 0x87, 0x13, 0x26,
+    0x4C, 0x98, 0x2D, 0x5A, 0xB4, 0x75, 0xEA, 0xC9, 0x8F, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0,
+    0x9D, 0x27, 0x4E, 0x9C, 0x25, 0x4A, 0x94, 0x35, 0x6A, 0xD4, 0xB5, 0x77, 0xEE, 0xC1, 0x9F, 0x23,
+    0x46, 0x8C, 0x05, 0x0A, 0x14, 0x28, 0x50, 0xA0, 0x5D, 0xBA, 0x69, 0xD2, 0xB9, 0x6F, 0xDE, 0xA1,
+    0x5F, 0xBE, 0x61, 0xC2, 0x99, 0x2F, 0x5E, 0xBC, 0x65, 0xCA, 0x89, 0x0F, 0x1E, 0x3C, 0x78, 0xF0,
+    0xFD, 0xE7, 0xD3, 0xBB, 0x6B, 0xD6, 0xB1, 0x7F, 0xFE, 0xE1, 0xDF, 0xA3, 0x5B, 0xB6, 0x71, 0xE2,
+    0xD9, 0xAF, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0D, 0x1A, 0x34, 0x68, 0xD0, 0xBD, 0x67, 0xCE,
+    0x81, 0x1F, 0x3E, 0x7C, 0xF8, 0xED, 0xC7, 0x93, 0x3B, 0x76, 0xEC, 0xC5, 0x97, 0x33, 0x66, 0xCC,
+    0x85, 0x17, 0x2E, 0x5C, 0xB8, 0x6D, 0xDA, 0xA9, 0x4F, 0x9E, 0x21, 0x42, 0x84, 0x15, 0x2A, 0x54,
+    0xA8, 0x4D, 0x9A, 0x29, 0x52, 0xA4, 0x55, 0xAA, 0x49, 0x92, 0x39, 0x72, 0xE4, 0xD5, 0xB7, 0x73,
+    0xE6, 0xD1, 0xBF, 0x63, 0xC6, 0x91, 0x3F, 0x7E, 0xFC, 0xE5, 0xD7, 0xB3, 0x7B, 0xF6, 0xF1, 0xFF,
+    0xE3, 0xDB, 0xAB, 0x4B, 0x96, 0x31, 0x62, 0xC4, 0x95, 0x37, 0x6E, 0xDC, 0xA5, 0x57, 0xAE, 0x41,
+    0x82, 0x19, 0x32, 0x64, 0xC8, 0x8D, 0x07, 0x0E, 0x1C, 0x38, 0x70, 0xE0, 0xDD, 0xA7, 0x53, 0xA6,
+    0x51, 0xA2, 0x59, 0xB2, 0x79, 0xF2, 0xF9, 0xEF, 0xC3, 0x9B, 0x2B, 0x56, 0xAC, 0x45, 0x8A, 0x09,
+    0x12, 0x24, 0x48, 0x90, 0x3D, 0x7A, 0xF4, 0xF5, 0xF7, 0xF3, 0xFB, 0xEB, 0xCB, 0x8B, 0x0B, 0x16,
+    0x2C, 0x58, 0xB0, 0x7D, 0xFA, 0xE9, 0xCF, 0x83, 0x1B, 0x36, 0x6C, 0xD8, 0xAD, 0x47, 0x8E
+};
+
+/* ... and their logarithms (gfLog[0] unused) */
+static const uint8_t gfLog[256] = {
+    0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1A, 0xC6, 0x03, 0xDF, 0x33, 0xEE, 0x1B, 0x68, 0xC7, 0x4B,
+    0x04, 0x64, 0xE0, 0x0E, 0x34, 0x8D, 0xEF, 0x81, 0x1C, 0xC1, 0x69, 0xF8, 0xC8, 0x08, 0x4C, 0x71,
+    0x05, 0x8A, 0x65, 0x2F, 0xE1, 0x24, 0x0F, 0x21, 0x35, 0x93, 0x8E, 0xDA, 0xF0, 0x12, 0x82, 0x45,
+    0x1D, 0xB5, 0xC2, 0x7D, 0x6A, 0x27, 0xF9, 0xB9, 0xC9, 0x9A, 0x09, 0x78, 0x4D, 0xE4, 0x72, 0xA6,
+    0x06, 0xBF, 0x8B, 0x62, 0x66, 0xDD, 0x30, 0xFD, 0xE2, 0x98, 0x25, 0xB3, 0x10, 0x91, 0x22, 0x88,
+    0x36, 0xD0, 0x94, 0xCE, 0x8F, 0x96, 0xDB, 0xBD, 0xF1, 0xD2, 0x13, 0x5C, 0x83, 0x38, 0x46, 0x40,
+    0x1E, 0x42, 0xB6, 0xA3, 0xC3, 0x48, 0x7E, 0x6E, 0x6B, 0x3A, 0x28, 0x54, 0xFA, 0x85, 0xBA, 0x3D,
+    0xCA, 0x5E, 0x9B, 0x9F, 0x0A, 0x15, 0x79, 0x2B, 0x4E, 0xD4, 0xE5, 0xAC, 0x73, 0xF3, 0xA7, 0x57,
+    0x07, 0x70, 0xC0, 0xF7, 0x8C, 0x80, 0x63, 0x0D, 0x67, 0x4A, 0xDE, 0xED, 0x31, 0xC5, 0xFE, 0x18,
+    0xE3, 0xA5, 0x99, 0x77, 0x26, 0xB8, 0xB4, 0x7C, 0x11, 0x44, 0x92, 0xD9, 0x23, 0x20, 0x89, 0x2E,
+    0x37, 0x3F, 0xD1, 0x5B, 0x95, 0xBC, 0xCF, 0xCD, 0x90, 0x87, 0x97, 0xB2, 0xDC, 0xFC, 0xBE, 0x61,
+    0xF2, 0x56, 0xD3, 0xAB, 0x14, 0x2A, 0x5D, 0x9E, 0x84, 0x3C, 0x39, 0x53, 0x47, 0x6D, 0x41, 0xA2,
+    0x1F, 0x2D, 0x43, 0xD8, 0xB7, 0x7B, 0xA4, 0x76, 0xC4, 0x17, 0x49, 0xEC, 0x7F, 0x0C, 0x6F, 0xF6,
+    0x6C, 0xA1, 0x3B, 0x52, 0x29, 0x9D, 0x55, 0xAA, 0xFB, 0x60, 0x86, 0xB1, 0xBB, 0xCC, 0x3E, 0x5A,
+    0xCB, 0x59, 0x5F, 0xB0, 0x9C, 0xA9, 0xA0, 0x51, 0x0B, 0xF5, 0x16, 0xEB, 0x7A, 0x75, 0x2C, 0xD7,
+    0x4F, 0xAE, 0xD5, 0xE9, 0xE6, 0xE7, 0xAD, 0xE8, 0x74, 0xD6, 0xF4, 0xEA, 0xA8, 0x50, 0x58, 0xAF
+};
+
+/* Generator polynomials, highest degree first, leading 1 omitted */
+static const uint8_t generator7[7] = {
+    0x7F, 0x7A, 0x9A, 0xA4, 0x0B, 0x44, 0x75
+};
+static const uint8_t generator10[10] = {
+    0xD8, 0xC2, 0x9F, 0x6F, 0xC7, 0x5E, 0x5F, 0x71, 0x9D, 0xC1
+};
+static const uint8_t generator15[15] = {
+    0x1D, 0xC4, 0x6F, 0xA3, 0x70, 0x4A, 0x0A, 0x69, 0x69, 0x8B, 0x84, 0x97, 0x20, 0x86, 0x1A,
+
+};
+static const uint8_t *const generators[QR_VERSION_MAX] = { generator7, generator10, generator15 };
+
+/* Data codewords while building, then with the error correction appended */
+static uint8_t *codewords;
+static uint16_t bitCount;
+
+static uint8_t gfMul(uint8_t a, uint8_t b)
+{
+    if ((a == 0) || (b == 0)) {
+        return 0;
+    }
+    return gfExp[(gfLog[a] + gfLog[b]) % 255];
+}
+
+static void appendBits(uint32_t value, uint8_t bits)
+{
+    while (bits-- > 0) {
+        if (value & (1UL << bits)) {
+            codewords[bitCount >> 3] |= 0x80 >> (bitCount & 7);
+        }
+        bitCount++;
+    }
+}
+
+static void setModule(qr_code_t *code, uint8_t x, uint8_t y, uint8_t dark)
+{
+    uint16_t i = (uint16_t)y * code->size + x;
+
+    if (dark) {
+        code->modules[i >> 3] |= 1 << (i & 7);
+    } else {
+        code->modules[i >> 3] &= ~(1 << (i & 7));
+    }
+}
+
+/*****************************************************************************
+** Function name:       isFunction
+**
+** Description:         Whether a module belongs to a function pattern or
+**                      the format information, which data never uses.
+**
+** Parameters:          code - symbol being built (version and size)
+**                      x, y - module column and row
+** Returned value:      1 for function modules
+*****************************************************************************/
+static uint8_t isFunction(const qr_code_t *code, uint8_t x, uint8_t y)
+{
+    uint8_t far = code->size - 8;
+
+    /* Finders with separators and format areas */
+    if ((x <= 8) && (y <= 8)) {
+        return 1;
+    }
+    if ((x >= far) && (y <= 8)) {
+        return 1;
+    }
+    if ((x <= 8) && (y >= far)) {
+        return 1;
+    }
+    /* Timing patterns */
+    if ((x == 6) || (y == 6)) {
+        return 1;
+    }
+    /* The single alignment pattern of versions 2 and 3, centered at far + 1 */
+    if ((code->version >= 2) && (x >= far - 1) && (x <= far + 3) && (y >= far - 1) && (y <= far + 3)) {
+        return 1;
+    }
+    return 0;
+}
+
+static void drawFinder(qr_code_t *code, uint8_t cx, uint8_t cy)
+{
+    for (int8_t dy = -4; dy <= 4; dy++) {
+        for (int8_t dx = -4; dx <= 4; dx++) {
+            int8_t x = cx + dx;
+            int8_t y = cy + dy;
+            if ((x < 0) || (y < 0) || (x >= code->size) || (y >= code->size)) {
+                continue;
+            }
+            uint8_t ring = (dx < 0 ? -dx : dx) > (dy < 0 ? -dy : dy) ? (dx < 0 ? -dx : dx)
+                                                                    : (dy < 0 ? -dy : dy);
+            setModule(code, x, y, (ring != 2) && (ring != 4));
+        }
+    }
+}
+
+/*****************************************************************************
+** Function name:       drawFormat
+**
+** Description:         Writes both copies of the format information for
+**                      level L and the given mask, and the dark module.
+**
+** Parameters:          code - symbol
+**                      mask - mask pattern 0-7
+** Returned value:      None
+*****************************************************************************/
+static void drawFormat(qr_code_t *code, uint8_t mask)
+{
+    uint16_t data = (FORMAT_LEVEL_L << 3) | mask;
+    uint16_t rem = data;
+    uint8_t size = code->size;
+
+    for (uint8_t i = 0; i < 10; i++) {
+        rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+    }
+    uint16_t bits = ((data << 10) | rem) ^ 0x5412;
+
+    for (uint8_t i = 0; i <= 5; i++) {
+        setModule(code, 8, i, (bits >> i) & 1);
+    }
+    setModule(code, 8, 7, (bits >> 6) & 1);
+    setModule(code, 8, 8, (bits >> 7) & 1);
+    setModule(code, 7, 8, (bits >> 8) & 1);
+    for (uint8_t i = 9; i < 15; i++) {
+        setModule(code, 14 - i, 8, (bits >> i) & 1);
+    }
+
+    for (uint8_t i = 0; i < 8; i++) {
+        setModule(code, size - 1 - i, 8, (bits >> i) & 1);
+    }
+    for (uint8_t i = 8; i < 15; i++) {
+        setModule(code, 8, size - 15 + i, (bits >> i) & 1);
+    }
+    setModule(code, 8, size - 8, 1);
+}
+
+static void drawFunctionPatterns(qr_code_t *code)
+{
+    uint8_t far = code->size - 8;
+
+    for (uint8_t i = 0; i < code->size; i++) {
+        setModule(code, 6, i, (i & 1) == 0);
+        setModule(code, i, 6, (i & 1) == 0);
+    }
+    drawFinder(code, 3, 3);
+    drawFinder(code, code->size - 4, 3);
+    drawFinder(code, 3, code->size - 4);
+
+    if (code->version >= 2) {
+        for (int8_t dy = -2; dy <= 2; dy++) {
+            for (int8_t dx = -2; dx <= 2; dx++) {
+                uint8_t edge = (dx == -2) || (dx == 2) || (dy == -2) || (dy == 2);
+                setModule(code, far + 1 + dx, far + 1 + dy, edge || ((dx == 0) && (dy == 0)));
+            }
+        }
+    }
+    drawFormat(code, 0);    // Reserve the format area; rewritten per mask
+}
+
+/*****************************************************************************
+** Function name:       placeData
+**
+** Description:         Places the codewords in the two-column zigzag from
+**                      the bottom-right corner, skipping the vertical
+**                      timing pattern. Remainder modules stay light.
+**
+** Parameters:          code  - symbol with function patterns drawn
+**                      count - number of codewords
+** Returned value:      None
+*****************************************************************************/
+static void placeData(qr_code_t *code, uint8_t count)
+{
+    uint16_t i = 0;
+    uint16_t total = (uint16_t)count * 8;
+
+    for (int8_t right = code->size - 1; right >= 1; right -= 2) {
+        if (right == 6) {
+            right = 5;
+        }
+        uint8_t upward = ((right + 1) & 2) == 0;
+        for (uint8_t vert = 0; vert < code->size; vert++) {
+            uint8_t y = upward ? (code->size - 1 - vert) : vert;
+            for (uint8_t j = 0; j < 2; j++) {
+                uint8_t x = right - j;
+                if (isFunction(code, x, y)) {
+                    continue;
+                }
+                uint8_t dark = 0;
+                if (i < total) {
+                    dark = (codewords[i >> 3] >> (7 - (i & 7))) & 1;
+                    i++;
+                }
+                setModule(code, x, y, dark);
+            }
+        }
+    }
+}
+
+static uint8_t maskBit(uint8_t mask, uint8_t x, uint8_t y)
+{
+    switch (mask) {
+    case 0:  return ((x + y) % 2) == 0;
+    case 1:  return (y % 2) == 0;
+    case 2:  return (x % 3) == 0;
+    case 3:  return ((x + y) % 3) == 0;
+    case 4:  return ((x / 3 + y / 2) % 2) == 0;
+    case 5:  return ((x * y) % 2 + (x * y) % 3) == 0;
+    case 6:  return (((x * y) % 2 + (x * y) % 3) % 2) == 0;
+    default: return (((x + y) % 2 + (x * y) % 3) % 2) == 0;
+    }
+}
+
+/* Masks are their own inverse: applying one twice restores the data */
+static void applyMask(qr_code_t *code, uint8_t mask)
+{
+    for (uint8_t y = 0; y < code->size; y++) {
+        for (uint8_t x = 0; x < code->size; x++) {
+            if (!isFunction(code, x, y) && maskBit(mask, x, y)) {
+                setModule(code, x, y, !qr_getModule(code, x, y));
+            }
+        }
+    }
+}
+
+/*****************************************************************************
+** Function name:       penalty
+**
+** Description:         Penalty score of the symbol: runs of five or more
+**                      equal modules, 2x2 blocks, finder-like patterns
+**                      and dark/light imbalance.
+**
+** Parameters:          code - symbol with mask and format applied
+** Returned value:      Score, lower is better
+*****************************************************************************/
+static uint32_t penalty(const qr_code_t *code)
+{
+    uint8_t size = code->size;
+    uint32_t score = 0;
+    uint16_t dark = 0;
+
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint8_t a = 0; a < size; a++) {
+            uint8_t run = 0;
+            uint8_t last = 2;
+            uint16_t window = 0;    // last 11 modules of the line, newest in bit 0
+            for (uint8_t b = 0; b < size; b++) {
+                uint8_t m = pass ? qr_getModule(code, a, b) : qr_getModule(code, b, a);
+                if (m == last) {
+                    run++;
+                    if (run == 5) {
+                        score += 3;
+                    } else if (run > 5) {
+                        score++;
+                    }
+                } else {
+                    last = m;
+                    run = 1;
+                }
+                window = ((window << 1) | m) & 0x7FF;
+                if ((b >= 10) && ((window == 0x05D) || (window == 0x5D0))) {
+                    score += 40;
+                }
+            }
+        }
+    }
+
+    for (uint8_t y = 0; y < size; y++) {
+        for (uint8_t x = 0; x < size; x++) {
+            uint8_t m = qr_getModule(code, x, y);
+            dark += m;
+            if ((x + 1 < size) && (y + 1 < size) && (m == qr_getModule(code, x + 1, y)) &&
+                (m == qr_getModule(code, x, y + 1)) && (m == qr_getModule(code, x + 1, y + 1))) {
+                score += 3;
+            }
+        }
+    }
+
+    uint16_t total = (uint16_t)size * size;
+    uint16_t deviation = (dark * 20 > total * 10) ? (dark * 20 - total * 10) : (total * 10 - dark * 20);
+    score += 10 * ((deviation + total - 1) / total - 1);
+    return score;
+}
+
+/*****************************************************************************
+** Function name:       qr_encode
+**
+** Description:         Encodes text in the smallest version that holds
+**                      it.
+**
+** Parameters:          text - null-terminated, at most QR_TEXT_MAX bytes
+**                      code - symbol to fill in
+** Returned value:      Version used, 0 if the text is too long
+*****************************************************************************/
+uint8_t qr_encode(const char *text, qr_code_t *code)
+{
+    uint8_t buffer[CODEWORDS_MAX];
+    uint8_t ecc[15];
+    uint8_t len = 0;
+    uint8_t v;
+
+    while ((len <= QR_TEXT_MAX) && (text[len] != '\0')) {
+        len++;
+    }
+    for (v = 0; v < QR_VERSION_MAX; v++) {
+        if ((uint16_t)len + 2 <= dataCodewords[v]) {    // mode and count take 12 bits
+            break;
+        }
+    }
+    if (v == QR_VERSION_MAX) {
+        return 0;
+    }
+    uint8_t dataCount = dataCodewords[v];
+    uint8_t eccCount = eccCodewords[v];
+
+    /* Data: mode, count, bytes, terminator, then alternating pad bytes */
+    codewords = buffer;
+    bitCount = 0;
+    for (uint8_t i = 0; i < CODEWORDS_MAX; i++) {
+        buffer[i] = 0;
+    }
+    appendBits(MODE_BYTE, 4);
+    appendBits(len, COUNT_BITS);
+    for (uint8_t i = 0; i < len; i++) {
+        appendBits((uint8_t)text[i], 8);
+    }
+    appendBits(0, ((uint16_t)dataCount * 8 - bitCount < 4) ? (uint16_t)dataCount * 8 - bitCount : 4);
+    for (uint8_t i = (bitCount + 7) >> 3, pad = 0xEC; i < dataCount; i++, pad ^= 0xEC ^ 0x11) {
+        buffer[i] = pad;
+    }
+
+    /* Error correction: remainder of the division by the generator */
+    const uint8_t *gen = generators[v];
+    for (uint8_t i = 0; i < eccCount; i++) {
+        ecc[i] = 0;
+    }
+    for (uint8_t i = 0; i < dataCount; i++) {
+        uint8_t factor = buffer[i] ^ ecc[0];
+        for (uint8_t j = 0; j + 1 < eccCount; j++) {
+            ecc[j] = ecc[j + 1] ^ gfMul(gen[j], factor);
+        }
+        ecc[eccCount - 1] = gfMul(gen[eccCount - 1], factor);
+    }
+    for (uint8_t i = 0; i < eccCount; i++) {
+        buffer[dataCount + i] = ecc[i];
+    }
+
+    code->version = v + 1;
+    code->size = 17 + 4 * code->version;
+    for (uint16_t i = 0; i < sizeof(code->modules); i++) {
+        code->modules[i] = 0;
+    }
+    drawFunctionPatterns(code);
+    placeData(code, dataCount + eccCount);
+
+    uint8_t best = 0;
+    uint32_t bestScore = 0xFFFFFFFFUL;
+    for (uint8_t mask = 0; mask < 8; mask++) {
+        applyMask(code, mask);
+        drawFormat(code, mask);
+        uint32_t score = penalty(code);
+        if (score < bestScore) {
+            bestScore = score;
+            best = mask;
+        }
+        applyMask(code, mask);
+    }
+    applyMask(code, best);
+    drawFormat(code, best);
+    return code->version;
+}
+
+/*****************************************************************************
+** Function name:       qr_getModule
+**
+** Description:         Reads one module of an encoded symbol.
+**
+** Parameters:          code - symbol
+**                      x, y - module column and row
+** Returned value:      1 for dark
+*****************************************************************************/
+uint8_t qr_getModule(const qr_code_t *code, uint8_t x, uint8_t y)
+{
+    uint16_t i = (uint16_t)y * code->size + x;
+
+    return (code->modules[i >> 3] >> (i & 7)) & 1;
+}
+
+/*****************************************************************************
+** Function name:       qr_draw
+**
+** Description:         Draws the symbol centered in a full-width band of
+**                      the shadow, at the largest whole number of pixels
+**                      per module that fits the symbol and a quiet zone
+**                      of QR_QUIET_MIN modules on each side in the band's
+**                      height. The rest of the band is light as well.
+**
+** Parameters:          code   - symbol
+**                      x      - left edge of the band, normally 0
+**                      y      - top of the band
+**                      height - band height in pixels
+**                      dark   - color of dark modules
+**                      light  - background color
+** Returned value:      None
+*****************************************************************************/
+void qr_draw(const qr_code_t *code, uint8_t x, uint8_t y, uint8_t height, oled_color_t dark,
+             oled_color_t light)
+{
+    uint8_t scale = height / (code->size + 2 * QR_QUIET_MIN);
+    uint8_t side = code->size * scale;
+    uint8_t left = x + (OLED_DISPLAY_WIDTH - x - side) / 2;
+    uint8_t top = y + (height - side) / 2;
+
+    display_fillRect(x, y, OLED_DISPLAY_WIDTH - x, height, light);
+    for (uint8_t my = 0; my < code->size; my++) {
+        for (uint8_t mx = 0; mx < code->size; mx++) {
+            if (qr_getModule(code, mx, my)) {
+                display_fillRect(left + mx * scale, top + my * scale, scale, scale, dark);
+            }
+        }
+    }
+}
@@ -0,0 +1,41 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: QR code encoder for the OLED: byte mode, error
+ *                correction level L, versions 1 to 3. The smallest
+ *                version that holds the text is used and drawn at the
+ *                largest whole scale that leaves a light quiet zone of
+ *                QR_QUIET_MIN modules inside the band: two pixels per
+ *                module for versions 1 and 2, one for version 3 on the
+ *                64 pixel display height. ISO/IEC 18004 asks for four
+ *                modules; two is the compromise with the panel size.
+ *                Reed-Solomon coding uses GF(256) tables in flash; the
+ *                encoder needs about 200 bytes of RAM.
+ *
+ ******************************************************************************/
+
+#ifndef __QR_H
+#define __QR_H
+
+#include "oled.h"
+
+#define QR_VERSION_MAX      3
+#define QR_SIZE_MAX         (17 + 4 * QR_VERSION_MAX)
+
+/* Light modules drawn around the symbol, at least */
+#define QR_QUIET_MIN        2
+
+/* Longest text, byte mode at level L */
+#define QR_TEXT_MAX         53
+
+typedef struct {
+    uint8_t version;
+    uint8_t size;           /* modules per side */
+    uint8_t modules[(QR_SIZE_MAX * QR_SIZE_MAX + 7) / 8];  /* row-major, 1 = dark */
+} qr_code_t;
+
+uint8_t qr_encode(const char *text, qr_code_t *code);
+uint8_t qr_getModule(const qr_code_t *code, uint8_t x, uint8_t y);
+void qr_draw(const qr_code_t *code, uint8_t x, uint8_t y, uint8_t height, oled_color_t dark,
+             oled_color_t light);
+
+#endif /* end __QR_H */
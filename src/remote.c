@@ -0,0 +1,395 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Binary remote-control protocol, see remote.h.
+ *
+ ******************************************************************************/
+
+#include "mcu_regs.h"
+#include "type.h"
+
+#include "busmon.h"
+#include "clock.h"
+#include "perf.h"
+#include "irqprio.h"
+#include "nvstore.h"
+#include "payload.h"
+#include "remote.h"
+#include "serial.h"
+#include "sleep.h"
+#include "stack.h"
+
+/* Frame overhead: sync, length, command, sequence and crc */
+#define FRAME_OVERHEAD      5
+
+/* Receive polling period while a request waits for its reply */
+#define REQUEST_POLL_US     10
+
+/* Receive states, named after the byte expected next */
+#define RX_SYNC             0
+#define RX_LENGTH           1
+#define RX_COMMAND          2
+#define RX_SEQUENCE         3
+#define RX_PAYLOAD          4
+#define RX_CRC              5
+
+/* Game command handler, NULL until remote_init() */
+static remote_handler_t commandHandler;
+
+static uint8_t rxState = RX_SYNC;
+static uint8_t rxLength;
+static uint8_t rxCommand;
+static uint8_t rxSequence;
+static uint8_t rxCount;
+static uint8_t rxCrc;
+static uint8_t rxPayload[REMOTE_PAYLOAD_MAX];
+
+/* serial_getLostCount() when the parser last resynchronised */
+static uint32_t rxLostSeen;
+
+/* Keys held on behalf of the rig, released at heldUntilMs */
+static uint8_t heldKeys;
+static uint32_t heldUntilMs;
+
+/* Outgoing request awaiting its reply, see remote_request() */
+static uint8_t requestSequence;
+static uint8_t requestCommand;
+static uint8_t requestPending;
+static uint8_t requestError;
+static uint8_t *requestReply;
+static uint8_t requestReplyLen;
+
+/*****************************************************************************
+** Function name:       crc8
+**
+** Description:         One step of the frame CRC-8 (polynomial 0x07, MSB
+**                      first, initial value 0).
+**
+** Parameters:          crc  - CRC so far
+**                      byte - next byte
+** Returned value:      Updated CRC
+*****************************************************************************/
+static uint8_t crc8(uint8_t crc, uint8_t byte)
+{
+    crc ^= byte;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+/*****************************************************************************
+** Function name:       sendFrame
+**
+** Description:         Frames a payload and sends it on the serial link.
+**
+** Parameters:          command  - command byte
+**                      sequence - sequence number
+**                      payload  - payload bytes
+**                      len      - payload length
+** Returned value:      None
+*****************************************************************************/
+static void sendFrame(uint8_t command, uint8_t sequence, const uint8_t *payload, uint8_t len)
+{
+    uint8_t frame[REMOTE_PAYLOAD_MAX + FRAME_OVERHEAD];
+    uint8_t crc = 0;
+
+    frame[0] = REMOTE_SYNC;
+    frame[1] = len;
+    frame[2] = command;
+    frame[3] = sequence;
+    for (uint8_t i = 0; i < len; i++) {
+        frame[4 + i] = payload[i];
+    }
+    for (uint8_t i = 1; i < 4 + len; i++) {
+        crc = crc8(crc, frame[i]);
+    }
+    frame[4 + len] = crc;
+
+    serial_send(frame, len + FRAME_OVERHEAD);
+}
+
+/*****************************************************************************
+** Function name:       getCounters
+**
+** Description:         Fills the counters reply, all u32: uptime ms,
+**                      monitor time, I2C and SSP busy totals (monitor
+**                      ticks, for utilization over two snapshots), loop,
+**                      accelerometer and light read times in us, stack
+**                      high-water mark and interrupt depth in bytes,
+**                      EEPROM page writes, longest masked section in core
+**                      cycles, received bytes lost to overruns.
+**
+** Parameters:          reply - room for the reply payload
+** Returned value:      Reply length
+*****************************************************************************/
+static uint8_t getCounters(uint8_t *reply)
+{
+    busmon_counters_t counters;
+    uint8_t *p = reply;
+
+    busmon_getCounters(&counters);
+    p = payload_putU32(p, clock_nowMs());
+    p = payload_putU32(p, counters.now);
+    p = payload_putU32(p, counters.i2cTicks);
+    p = payload_putU32(p, counters.sspTicks);
+    p = payload_putU32(p, busmon_ticksToUs(counters.loopTicks));
+    p = payload_putU32(p, busmon_ticksToUs(counters.accTicks));
+    p = payload_putU32(p, busmon_ticksToUs(counters.lightTicks));
+    p = payload_putU32(p, stack_getHighWater());
+    p = payload_putU32(p, stack_getIsrDepth());
+    p = payload_putU32(p, nvstore_getWriteCount());
+    p = payload_putU32(p, irq_getMaskMaxCycles());
+    p = payload_putU32(p, serial_getLostCount());
+    return (uint8_t)(p - reply);
+}
+
+/*****************************************************************************
+** Function name:       dispatch
+**
+** Description:         Answers the command frame just received: link
+**                      commands here, the rest by the game's handler.
+**                      Errors are answered with a REMOTE_ERROR frame.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void dispatch(void)
+{
+    uint8_t reply[REMOTE_PAYLOAD_MAX];
+    uint8_t replyLen = 0;
+    uint8_t error = 0;
+
+    switch (rxCommand) {
+    case REMOTE_CMD_PING:
+        reply[0] = REMOTE_VERSION;
+        replyLen = 1;
+        break;
+
+    case REMOTE_CMD_KEYS:
+        if (rxLength != 3) {
+            error = REMOTE_ERR_LENGTH;
+            break;
+        }
+        heldKeys = rxPayload[0];
+        heldUntilMs = clock_nowMs() + payload_getU16(&rxPayload[1]);
+        break;
+
+    case REMOTE_CMD_COUNTERS:
+        replyLen = getCounters(reply);
+        break;
+
+    case REMOTE_CMD_CLOCK:
+        payload_putU64(reply, clock_nowUs());
+        replyLen = 8;
+        break;
+
+    default:
+        error = commandHandler(rxCommand, rxPayload, rxLength, reply, &replyLen);
+        break;
+    }
+
+    if (error != 0) {
+        reply[0] = rxCommand;
+        reply[1] = error;
+        sendFrame(REMOTE_ERROR, rxSequence, reply, 2);
+    } else {
+        sendFrame(rxCommand | REMOTE_REPLY, rxSequence, reply, replyLen);
+    }
+}
+
+/*****************************************************************************
+** Function name:       takeReply
+**
+** Description:         Handles the reply frame just received: completes
+**                      the pending request if it answers it, drops it
+**                      otherwise (late reply to a request that timed out).
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static void takeReply(void)
+{
+    if (!requestPending || (rxSequence != requestSequence)) {
+        return;
+    }
+    if (rxCommand == REMOTE_ERROR) {
+        if ((rxLength != 2) || (rxPayload[0] != requestCommand)) {
+            return;
+        }
+        requestError = rxPayload[1];
+    } else if (rxCommand == (requestCommand | REMOTE_REPLY)) {
+        for (uint8_t i = 0; i < rxLength; i++) {
+            requestReply[i] = rxPayload[i];
+        }
+        requestReplyLen = rxLength;
+    } else {
+        return;
+    }
+    requestPending = 0;
+}
+
+/*****************************************************************************
+** Function name:       receive
+**
+** Description:         Feeds one received byte to the frame parser and
+**                      handles the frame it completes, if its CRC matches.
+**                      Any valid frame counts as activity for the
+**                      inactivity sleep, replies and PING included.
+**
+** Parameters:          byte - received byte
+** Returned value:      None
+*****************************************************************************/
+static void receive(uint8_t byte)
+{
+    switch (rxState) {
+    case RX_SYNC:
+        if (byte == REMOTE_SYNC) {
+            rxCrc = 0;
+            rxState = RX_LENGTH;
+        }
+        return;
+
+    case RX_LENGTH:
+        rxLength = byte;
+        rxCount = 0;
+        rxState = (byte <= REMOTE_PAYLOAD_MAX) ? RX_COMMAND : RX_SYNC;
+        break;
+
+    case RX_COMMAND:
+        rxCommand = byte;
+        rxState = RX_SEQUENCE;
+        break;
+
+    case RX_SEQUENCE:
+        rxSequence = byte;
+        rxState = (rxLength > 0) ? RX_PAYLOAD : RX_CRC;
+        break;
+
+    case RX_PAYLOAD:
+        rxPayload[rxCount++] = byte;
+        if (rxCount == rxLength) {
+            rxState = RX_CRC;
+        }
+        break;
+
+    case RX_CRC:
+        rxState = RX_SYNC;
+        if (byte != rxCrc) {
+            return;
+        }
+        sleep_touch();
+        if (rxCommand & REMOTE_REPLY) {
+            takeReply();
+        } else {
+            dispatch();
+        }
+        return;
+    }
+    rxCrc = crc8(rxCrc, byte);
+}
+
+/*****************************************************************************
+** Function name:       remote_init
+**
+** Description:         Starts answering frames on the serial link. The
+**                      link must already be open (serial_init).
+**
+** Parameters:          handler - handler of the game commands
+** Returned value:      None
+*****************************************************************************/
+void remote_init(remote_handler_t handler)
+{
+    commandHandler = handler;
+}
+
+/*****************************************************************************
+** Function name:       remote_poll
+**
+** Description:         Parses the bytes received since the last call and
+**                      answers every complete frame. After received bytes
+**                      were lost the frame in progress is abandoned and
+**                      the parser looks for the next sync byte. Does
+**                      nothing before remote_init().
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void remote_poll(void)
+{
+    uint8_t buf[16];
+    uint32_t count;
+
+    if (commandHandler == NULL) {
+        return;
+    }
+    do {
+        count = serial_read(buf, sizeof(buf));
+        if (serial_getLostCount() != rxLostSeen) {
+            rxLostSeen = serial_getLostCount();
+            rxState = RX_SYNC;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            receive(buf[i]);
+        }
+    } while (count > 0);
+}
+
+/*****************************************************************************
+** Function name:       remote_getKeys
+**
+** Description:         Keys the rig holds down, until their hold time
+**                      runs out.
+**
+** Parameters:          None
+** Returned value:      JOYSTICK_* bits
+*****************************************************************************/
+uint8_t remote_getKeys(void)
+{
+    if ((heldKeys != 0) && ((int32_t)(clock_nowMs() - heldUntilMs) >= 0)) {
+        heldKeys = 0;
+    }
+    return heldKeys;
+}
+
+/*****************************************************************************
+** Function name:       remote_request
+**
+** Description:         Sends a command to the other end of the link and
+**                      waits for its reply, answering incoming frames
+**                      meanwhile. Used between two boards.
+**
+** Parameters:          cmd       - REMOTE_CMD_* command
+**                      payload   - command payload
+**                      len       - payload length
+**                      reply     - room for REMOTE_PAYLOAD_MAX bytes of reply
+**                      replyLen  - reply length, may be NULL
+**                      timeoutMs - time to wait for the reply
+** Returned value:      0, the peer's REMOTE_ERR_* code, or
+**                      REMOTE_ERR_TIMEOUT
+*****************************************************************************/
+uint8_t remote_request(uint8_t cmd, const uint8_t *payload, uint8_t len,
+                       uint8_t *reply, uint8_t *replyLen, uint32_t timeoutMs)
+{
+    uint32_t startMs = clock_nowMs();
+
+    requestSequence++;
+    requestCommand = cmd;
+    requestReply = reply;
+    requestReplyLen = 0;
+    requestError = 0;
+    requestPending = 1;
+    sendFrame(cmd, requestSequence, payload, len);
+
+    while (requestPending) {
+        if (clock_nowMs() - startMs >= timeoutMs) {
+            requestPending = 0;
+            return REMOTE_ERR_TIMEOUT;
+        }
+        remote_poll();
+        clock_delayUs(REQUEST_POLL_US);
+    }
+    if (replyLen != NULL) {
+        *replyLen = requestReplyLen;
+    }
+    return requestError;
+}
@@ -0,0 +1,68 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Binary remote-control protocol on the serial link, for
+ *                automated test rigs. Every frame is
+ *
+ *                    0xA5, length, command, sequence, payload..., crc
+ *
+ *                where length counts the payload only and crc is CRC-8
+ *                (polynomial 0x07, initial 0) over length to the end of
+ *                the payload. Replies echo the sequence number with the
+ *                command ORed with 0x80; a failed command is answered by
+ *                REMOTE_ERROR with the command and an error code. Frames
+ *                with a bad CRC are dropped without reply.
+ *
+ *                Multi-byte fields are little-endian. Bytes are collected
+ *                by the UART interrupt and commands run from input_read(),
+ *                so they never delay the capture of a click.
+ *
+ *                Two boards linked by their UARTs use the same frames
+ *                in both directions: remote_request() sends a command to
+ *                the peer and waits for the reply.
+ *
+ ******************************************************************************/
+
+#ifndef __REMOTE_H
+#define __REMOTE_H
+
+#define REMOTE_SYNC             0xA5
+#define REMOTE_PAYLOAD_MAX      48
+#define REMOTE_REPLY            0x80
+#define REMOTE_ERROR            0xFF
+#define REMOTE_VERSION          1
+
+/* Commands handled here */
+#define REMOTE_CMD_PING         0x01    /* -> version */
+#define REMOTE_CMD_KEYS         0x02    /* keys u8, holdMs u16: hold JOYSTICK_* bits */
+#define REMOTE_CMD_COUNTERS     0x03    /* -> performance counters, see remote.c */
+#define REMOTE_CMD_CLOCK        0x04    /* senderUs u64 -> clock_nowUs() u64 */
+
+/* Commands passed to the game's handler */
+#define REMOTE_CMD_STATUS       0x10    /* -> round (0xFF in the menu), player, foreperiod */
+#define REMOTE_CMD_PLAYER       0x11    /* player u8 */
+#define REMOTE_CMD_FOREPERIOD   0x12    /* minMs u16, rangeMs u16 */
+#define REMOTE_CMD_START        0x13    /* start a session from the menu */
+#define REMOTE_CMD_RESULTS      0x14    /* -> player, count, times u16..., average u16 */
+
+/* Error codes */
+#define REMOTE_ERR_UNKNOWN      1
+#define REMOTE_ERR_LENGTH       2
+#define REMOTE_ERR_VALUE        3
+#define REMOTE_ERR_BUSY         4
+#define REMOTE_ERR_TIMEOUT      5       /* local: no reply to remote_request() */
+
+/*
+ * Game command handler: fills reply (at most REMOTE_PAYLOAD_MAX bytes) and
+ * its length, returns 0 or a REMOTE_ERR_* code. Runs inside input_read(),
+ * so it must only record what to do, not do it.
+ */
+typedef uint8_t (*remote_handler_t)(uint8_t cmd, const uint8_t *payload, uint8_t len,
+                                    uint8_t *reply, uint8_t *replyLen);
+
+void remote_init(remote_handler_t handler);
+void remote_poll(void);
+uint8_t remote_getKeys(void);
+uint8_t remote_request(uint8_t cmd, const uint8_t *payload, uint8_t len,
+                       uint8_t *reply, uint8_t *replyLen, uint32_t timeoutMs);
+
+#endif /* end __REMOTE_H */
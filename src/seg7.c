@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: 7-segment display output. The segment pattern is shifted
+ *                into the display latch over the shared SSP bus at urgent
+ *                priority, so it goes out between OLED page transfers;
+ *                the latch is strobed by its chip select line.
+ *
+ ******************************************************************************/
+
+#include "mcu_regs.h"
+#include "type.h"
+
+#include "sspbus.h"
+#include "seg7.h"
+
+/* 7-segment latch chip select on the base board */
+#define SEG7_CS_PORT    1
+#define SEG7_CS_PIN     11
+
+/* Latch runs at the 2.25 MHz the library drives it at: 72 MHz / (2 * 16) */
+static const sspbus_device_t seg7Device = {
+    (15 << 8) | 0x07, 2, SEG7_CS_PORT, SEG7_CS_PIN, SSPBUS_NO_DC, 0
+};
+
+/*
+ * Segment patterns (active low) for '0'-'9' and the blank/dash glyphs. The
+ * library's table is static in led7seg.c, so the digits are repeated here.
+ */
+static const uint8_t digitSegments[10] = {
+    0x24, 0xAF, 0xE0, 0xA2, 0x2B, 0x32, 0x30, 0xA7, 0x20, 0x22
+};
+#define SEG7_DASH   0xFB
+#define SEG7_BLANK  0xFF
+
+/* Pattern currently latched, used to skip redundant updates */
+static uint8_t latched = 0x00;
+
+/* Transfer descriptor and its one-byte payload */
+static sspbus_xfer_t seg7Xfer;
+static uint8_t seg7Pattern;
+
+/*****************************************************************************
+** Function name:       seg7_setChar
+**
+** Description:         Shows a digit, '-' or blank on the 7-segment display.
+**                      Does nothing if that pattern is already shown.
+**
+** Parameters:          ch - '0'-'9', '-' or any other character for blank
+** Returned value:      None
+*****************************************************************************/
+void seg7_setChar(uint8_t ch)
+{
+    uint8_t pattern = SEG7_BLANK;
+
+    if ((ch >= '0') && (ch <= '9')) {
+        pattern = digitSegments[ch - '0'];
+    } else if (ch == '-') {
+        pattern = SEG7_DASH;
+    }
+
+    if (pattern == latched) {
+        return;
+    }
+
+    seg7Pattern = pattern;
+
+    seg7Xfer.device = &seg7Device;
+    seg7Xfer.headLen = 0;
+    seg7Xfer.body = &seg7Pattern;
+    seg7Xfer.bodyLen = 1;
+    seg7Xfer.priority = SSPBUS_PRIO_URGENT;
+    sspbus_submit(&seg7Xfer);
+    sspbus_complete(&seg7Xfer);
+    latched = pattern;
+}
@@ -0,0 +1,13 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: 7-segment display output with single-store chip select.
+ *                The display is brought up by led7seg_init().
+ *
+ ******************************************************************************/
+
+#ifndef __SEG7_H
+#define __SEG7_H
+
+void seg7_setChar(uint8_t ch);
+
+#endif /* end __SEG7_H */
@@ -0,0 +1,349 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Serial link to the host, see serial.h.
+ *
+ ******************************************************************************/
+
+#ifdef CLOCK_VIRTUAL
+#define _GNU_SOURCE     /* posix_openpt(), ptsname(), cfmakeraw() */
+#endif
+
+#include "type.h"
+
+#include "serial.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef CLOCK_VIRTUAL
+
+#include "mcu_regs.h"
+
+#include "stack.h"
+
+/*
+ * Receive ring. The indices run free and are only reduced modulo the
+ * size on access, so head - tail is the number of unread bytes even when
+ * the interrupt handler has lapped the reader; the library driver's ring
+ * (UARTBuffer/UARTCount) wraps its index and cannot tell.
+ */
+#define RX_RING_SIZE        64
+
+/* UART register bits */
+#define LSR_RDR             0x01    /* receive data ready */
+#define LSR_OE              0x02    /* receive FIFO overrun */
+#define LSR_THRE            0x20    /* transmit holding register empty */
+#define LSR_TEMT            0x40    /* transmitter empty */
+#define IER_RBR             0x01    /* receive data interrupt */
+#define IER_RLS             0x04    /* receive line status interrupt */
+#define LCR_8N1             0x03
+#define LCR_DLAB            0x80
+#define FCR_RESET_FIFOS     0x07
+
+/* SYSAHBCLKCTRL bit of the UART */
+#define AHBCLK_UART         (1 << 12)
+
+static uint8_t rxRing[RX_RING_SIZE];
+static volatile uint32_t rxHead;        /* bytes stored since serial_init() */
+static volatile uint32_t rxFifoOverruns;/* overruns of the UART's own FIFO */
+static uint32_t rxTail;                 /* bytes taken or dropped */
+static uint32_t rxLost;                 /* bytes dropped by serial_read() */
+
+/*****************************************************************************
+** Function name:       UART_IRQHandler
+**
+** Description:         Moves received bytes into the ring. An overrun of
+**                      the UART's FIFO is counted as one lost byte; the
+**                      hardware cannot tell how many went missing.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void UART_IRQHandler(void)
+{
+    uint32_t lsr;
+
+    stack_sampleIsr();
+    while ((lsr = LPC_UART->LSR) & (LSR_RDR | LSR_OE)) {
+        if (lsr & LSR_OE) {
+            rxFifoOverruns++;
+        }
+        if (!(lsr & LSR_RDR)) {
+            break;
+        }
+        rxRing[rxHead % RX_RING_SIZE] = (uint8_t)LPC_UART->RBR;
+        rxHead++;
+    }
+}
+
+/*****************************************************************************
+** Function name:       serial_init
+**
+** Description:         Sets up the UART on PIO1_6/PIO1_7, 8N1 at
+**                      SERIAL_BAUDRATE, with received bytes collected by
+**                      UART_IRQHandler(). Same setup as the library's
+**                      UARTInit(), which this driver replaces.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void serial_init(void)
+{
+    uint32_t divisor;
+
+    NVIC_DisableIRQ(UART_IRQn);
+    LPC_IOCON->PIO1_6 = (LPC_IOCON->PIO1_6 & ~0x07) | 0x01;    // RXD
+    LPC_IOCON->PIO1_7 = (LPC_IOCON->PIO1_7 & ~0x07) | 0x01;    // TXD
+    LPC_SYSCON->SYSAHBCLKCTRL |= AHBCLK_UART;
+    LPC_SYSCON->UARTCLKDIV = 1;
+
+    divisor = SystemFrequency / LPC_SYSCON->SYSAHBCLKDIV / 16 / SERIAL_BAUDRATE;
+    LPC_UART->LCR = LCR_DLAB | LCR_8N1;
+    LPC_UART->DLM = divisor / 256;
+    LPC_UART->DLL = divisor % 256;
+    LPC_UART->LCR = LCR_8N1;
+    LPC_UART->FCR = FCR_RESET_FIFOS;
+
+    while ((LPC_UART->LSR & (LSR_THRE | LSR_TEMT)) != (LSR_THRE | LSR_TEMT));
+    while (LPC_UART->LSR & LSR_RDR) {
+        (void)LPC_UART->RBR;
+    }
+
+    rxHead = 0;
+    rxTail = 0;
+    rxLost = 0;
+    rxFifoOverruns = 0;
+    NVIC_EnableIRQ(UART_IRQn);
+    LPC_UART->IER = IER_RBR | IER_RLS;
+}
+
+/*****************************************************************************
+** Function name:       serial_send
+**
+** Description:         Sends raw bytes, waiting for room in the UART.
+**
+** Parameters:          data - bytes to send
+**                      len  - number of bytes
+** Returned value:      None
+*****************************************************************************/
+void serial_send(const uint8_t *data, uint32_t len)
+{
+    while (len-- > 0) {
+        while (!(LPC_UART->LSR & LSR_THRE));
+        LPC_UART->THR = *data++;
+    }
+}
+
+/*****************************************************************************
+** Function name:       serial_read
+**
+** Description:         Takes received bytes without waiting. If the
+**                      interrupt handler lapped the reader (before or
+**                      during the copy), the unread bytes are no longer a
+**                      contiguous stream: they are all dropped and counted
+**                      in serial_getLostCount(), and 0 is returned.
+**
+** Parameters:          buf - destination
+**                      max - room in buf
+** Returned value:      Number of bytes taken, 0 if none arrived
+*****************************************************************************/
+uint32_t serial_read(uint8_t *buf, uint32_t max)
+{
+    uint32_t head = rxHead;
+    uint32_t count = 0;
+
+    if (head - rxTail > RX_RING_SIZE) {
+        rxLost += head - rxTail;
+        rxTail = head;
+        return 0;
+    }
+    while ((rxTail + count != head) && (count < max)) {
+        buf[count] = rxRing[(rxTail + count) % RX_RING_SIZE];
+        count++;
+    }
+
+    // Bytes copied from slots the handler refilled meanwhile are torn
+    head = rxHead;
+    if (head - rxTail > RX_RING_SIZE) {
+        rxLost += head - rxTail;
+        rxTail = head;
+        return 0;
+    }
+    rxTail += count;
+    return count;
+}
+
+/*****************************************************************************
+** Function name:       serial_getLostCount
+**
+** Description:         Received bytes lost since serial_init(): dropped
+**                      after a ring overrun, plus one per overrun of the
+**                      UART's FIFO. A change means the stream has a gap.
+**
+** Parameters:          None
+** Returned value:      Lost byte count
+*****************************************************************************/
+uint32_t serial_getLostCount(void)
+{
+    return rxLost + rxFifoOverruns;
+}
+
+#else /* CLOCK_VIRTUAL */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+/* Master side of the pseudo-terminal (or REFLEX_SERIAL), -1 until serial_init() */
+static int ptyFd = -1;
+
+/* Device the other end opens, or REFLEX_SERIAL; empty until serial_init() */
+static char deviceName[64];
+
+/*****************************************************************************
+** Function name:       serial_init
+**
+** Description:         Opens a raw, non-blocking pseudo-terminal and
+**                      prints the name of its slave side on stderr. With
+**                      REFLEX_SERIAL set in the environment that device is
+**                      opened instead, e.g. the pseudo-terminal of another
+**                      simulated board to link the two. Calling it again
+**                      closes the previous link first.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void serial_init(void)
+{
+    struct termios raw;
+    const char *device = getenv("REFLEX_SERIAL");
+    int fd;
+
+    if (ptyFd >= 0) {
+        close(ptyFd);
+        ptyFd = -1;
+        deviceName[0] = '\0';
+    }
+    if (device != NULL) {
+        fd = open(device, O_RDWR | O_NOCTTY);
+        if (fd < 0) {
+            perror(device);
+            return;
+        }
+    } else {
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if ((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0)) {
+            perror("serial: pty");
+            return;
+        }
+    }
+    tcgetattr(fd, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(fd, TCSANOW, &raw);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    ptyFd = fd;
+    snprintf(deviceName, sizeof(deviceName), "%s", (device != NULL) ? device : ptsname(fd));
+    fprintf(stderr, "serial: %s\n", deviceName);
+}
+
+/*****************************************************************************
+** Function name:       serial_getDevice
+**
+** Description:         Device another simulated board opens (through
+**                      REFLEX_SERIAL) to link to this one.
+**
+** Parameters:          None
+** Returned value:      Device path, empty if the link is not open
+*****************************************************************************/
+const char *serial_getDevice(void)
+{
+    return deviceName;
+}
+
+/*****************************************************************************
+** Function name:       serial_send
+**
+** Description:         Sends raw bytes. Dropped while no client has the
+**                      slave side open.
+**
+** Parameters:          data - bytes to send
+**                      len  - number of bytes
+** Returned value:      None
+*****************************************************************************/
+void serial_send(const uint8_t *data, uint32_t len)
+{
+    if (ptyFd >= 0) {
+        (void)!write(ptyFd, data, len);
+    }
+}
+
+/*****************************************************************************
+** Function name:       serial_read
+**
+** Description:         Takes received bytes without waiting.
+**
+** Parameters:          buf - destination
+**                      max - room in buf
+** Returned value:      Number of bytes taken, 0 if none arrived
+*****************************************************************************/
+uint32_t serial_read(uint8_t *buf, uint32_t max)
+{
+    ssize_t count = (ptyFd >= 0) ? read(ptyFd, buf, max) : -1;
+
+    return (count > 0) ? (uint32_t)count : 0;
+}
+
+/*****************************************************************************
+** Function name:       serial_getLostCount
+**
+** Description:         Received bytes lost since serial_init(). The
+**                      pseudo-terminal buffers in the kernel and loses
+**                      none.
+**
+** Parameters:          None
+** Returned value:      0
+*****************************************************************************/
+uint32_t serial_getLostCount(void)
+{
+    return 0;
+}
+
+#endif /* CLOCK_VIRTUAL */
+
+/*****************************************************************************
+** Function name:       serial_write
+**
+** Description:         Sends a string as is.
+**
+** Parameters:          text - null-terminated string
+** Returned value:      None
+*****************************************************************************/
+void serial_write(const char *text)
+{
+    serial_send((const uint8_t *)text, strlen(text));
+}
+
+/*****************************************************************************
+** Function name:       serial_printf
+**
+** Description:         Sends a formatted line, truncated to
+**                      SERIAL_LINE_MAX - 1 characters.
+**
+** Parameters:          format - printf format string
+**                      ...    - format arguments
+** Returned value:      None
+*****************************************************************************/
+void serial_printf(const char *format, ...)
+{
+    char line[SERIAL_LINE_MAX];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    serial_write(line);
+}
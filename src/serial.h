@@ -0,0 +1,29 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Serial link to the host. On the board this is the UART;
+ *                built with CLOCK_VIRTUAL it is a pseudo-terminal whose
+ *                name is printed at start-up, so host tools can talk to
+ *                the simulated game exactly as to a board.
+ *
+ ******************************************************************************/
+
+#ifndef __SERIAL_H
+#define __SERIAL_H
+
+#define SERIAL_BAUDRATE     115200
+
+/* Longest formatted line, including the terminator */
+#define SERIAL_LINE_MAX     64
+
+void serial_init(void);
+void serial_write(const char *text);
+void serial_send(const uint8_t *data, uint32_t len);
+uint32_t serial_read(uint8_t *buf, uint32_t max);
+uint32_t serial_getLostCount(void);
+void serial_printf(const char *format, ...);
+
+#ifdef CLOCK_VIRTUAL
+const char *serial_getDevice(void);
+#endif
+
+#endif /* end __SERIAL_H */
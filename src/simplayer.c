@@ -0,0 +1,263 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Synthetic player and Monte Carlo load test for simulated
+ *                runs. Host only: built with CLOCK_VIRTUAL, where it is
+ *                installed as the input source of the game.
+ *
+ ******************************************************************************/
+
+#ifdef CLOCK_VIRTUAL
+
+#include "type.h"
+#include "joystick.h"
+
+#include "clock.h"
+#include "input.h"
+#include "nvstore.h"
+#include "simplayer.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* How the player answers the current stimulus */
+#define OUTCOME_RESPONSE    0
+#define OUTCOME_FALSE_START 1
+#define OUTCOME_MISS        2
+
+static simplayer_config_t config;
+static simplayer_report_t *report;
+
+/* Private generator, so the game's own rand() sequence is unaffected */
+static uint32_t rngState;
+
+/* Pending response to a stimulus */
+static uint8_t armed;
+static uint8_t outcome;
+static uint32_t pressAtMs;
+static uint32_t trueMs;
+
+/* Pending confirmation of a prompt */
+static uint8_t prompting;
+static uint32_t promptPressAtMs;
+
+/*****************************************************************************
+** Function name:       nextRandom
+**
+** Description:         xorshift32 step.
+**
+** Parameters:          None
+** Returned value:      Next pseudo-random value
+*****************************************************************************/
+static uint32_t nextRandom(void)
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+/*****************************************************************************
+** Function name:       uniform
+**
+** Description:         Uniform deviate strictly inside (0, 1).
+**
+** Parameters:          None
+** Returned value:      Random value
+*****************************************************************************/
+static double uniform(void)
+{
+    return ((double)nextRandom() + 1.0) / 4294967297.0;
+}
+
+/*****************************************************************************
+** Function name:       sampleResponse
+**
+** Description:         Draws a response time from the configured
+**                      ex-Gaussian: Gaussian (Box-Muller) plus exponential.
+**
+** Parameters:          None
+** Returned value:      Response time in ms, at least 1
+*****************************************************************************/
+static uint32_t sampleResponse(void)
+{
+    double gauss = sqrt(-2.0 * log(uniform())) * cos(6.283185307179586 * uniform());
+    double x = config.mu + config.sigma * gauss - config.tau * log(uniform());
+
+    return (x < 1.0) ? 1 : (uint32_t)(x + 0.5);
+}
+
+/*****************************************************************************
+** Function name:       playerRead
+**
+** Description:         Input source: the center button goes down once the
+**                      pending response or prompt confirmation is due.
+**
+** Parameters:          nowMs - simulated time
+** Returned value:      JOYSTICK_* bits held
+*****************************************************************************/
+static uint8_t playerRead(uint32_t nowMs)
+{
+    if (armed) {
+        if ((int32_t)(nowMs - pressAtMs) >= 0) {
+            armed = 0;
+            return JOYSTICK_CENTER;
+        }
+        return 0;
+    }
+
+    if (!prompting) {
+        prompting = 1;
+        promptPressAtMs = nowMs + config.thinkMs;
+    }
+    if ((int32_t)(nowMs - promptPressAtMs) >= 0) {
+        prompting = 0;
+        return JOYSTICK_CENTER;
+    }
+    return 0;
+}
+
+/*****************************************************************************
+** Function name:       playerStimulus
+**
+** Description:         Input source: decides how the player answers the
+**                      stimulus that just became visible.
+**
+** Parameters:          nowMs - stimulus onset in simulated time
+** Returned value:      None
+*****************************************************************************/
+static void playerStimulus(uint32_t nowMs)
+{
+    uint32_t roll = nextRandom() % 1000;
+
+    prompting = 0;
+    armed = 1;
+
+    if (roll < config.falseStartPermille) {
+        outcome = OUTCOME_FALSE_START;      // Already holding the button
+        trueMs = 0;
+    } else if (roll < (uint32_t)config.falseStartPermille + config.missPermille) {
+        outcome = OUTCOME_MISS;
+        trueMs = config.missDelayMs;
+    } else {
+        outcome = OUTCOME_RESPONSE;
+        trueMs = sampleResponse();
+    }
+    pressAtMs = nowMs + trueMs;
+}
+
+/*****************************************************************************
+** Function name:       playerResult
+**
+** Description:         Input source: compares the measured reaction time
+**                      with the true one. False starts have no true
+**                      response time and are only counted.
+**
+** Parameters:          ms - reaction time measured by the game
+** Returned value:      None
+*****************************************************************************/
+static void playerResult(uint32_t ms)
+{
+    report->rounds++;
+
+    if (outcome == OUTCOME_FALSE_START) {
+        report->falseStarts++;
+        return;
+    }
+    if (outcome == OUTCOME_MISS) {
+        report->misses++;
+    }
+
+    int32_t drift = (int32_t)(ms - trueMs);
+    if (drift < report->driftMin) report->driftMin = drift;
+    if (drift > report->driftMax) report->driftMax = drift;
+    report->driftSum += drift;
+}
+
+static const input_source_t playerSource = {
+    playerRead, playerStimulus, playerResult
+};
+
+/*****************************************************************************
+** Function name:       simplayer_init
+**
+** Description:         Resets the player to the given configuration and
+**                      installs it as the input source.
+**
+** Parameters:          cfg - player configuration
+** Returned value:      None
+*****************************************************************************/
+void simplayer_init(const simplayer_config_t *cfg)
+{
+    config = *cfg;
+    rngState = (config.seed != 0) ? config.seed : 1;
+    armed = 0;
+    prompting = 0;
+    input_setSource(&playerSource);
+}
+
+/*****************************************************************************
+** Function name:       simplayer_runLoadTest
+**
+** Description:         Plays a number of games against the player in
+**                      simulated time and fills in the report.
+**
+** Parameters:          cfg      - player configuration
+**                      games    - number of games to play
+**                      playGame - one game, normally start_game
+**                      out      - receives the report
+** Returned value:      None
+*****************************************************************************/
+void simplayer_runLoadTest(const simplayer_config_t *cfg, uint32_t games,
+                           void (*playGame)(void), simplayer_report_t *out)
+{
+    uint32_t writesBefore = nvstore_getWriteCount();
+    clock_t wallStart = clock();
+
+    *out = (simplayer_report_t){ 0 };
+    out->driftMin = INT32_MAX;
+    out->driftMax = INT32_MIN;
+    report = out;
+
+    clock_init();
+    simplayer_init(cfg);
+
+    for (uint32_t game = 0; game < games; game++) {
+        playGame();
+        out->games++;
+    }
+
+    out->simulatedMs = clock_nowUs() / 1000;
+    out->eepromWrites = nvstore_getWriteCount() - writesBefore;
+    out->wallSeconds = (double)(clock() - wallStart) / CLOCKS_PER_SEC;
+    input_setSource(NULL);
+}
+
+/*****************************************************************************
+** Function name:       simplayer_printReport
+**
+** Description:         Prints a load test report on stdout.
+**
+** Parameters:          r - report to print
+** Returned value:      None
+*****************************************************************************/
+void simplayer_printReport(const simplayer_report_t *r)
+{
+    uint32_t timed = r->rounds - r->falseStarts;
+
+    printf("games %lu, rounds %lu (%lu false starts, %lu misses)\n",
+           (unsigned long)r->games, (unsigned long)r->rounds,
+           (unsigned long)r->falseStarts, (unsigned long)r->misses);
+    printf("simulated %.1f h in %.2f s wall, %.0f rounds/s\n",
+           r->simulatedMs / 3600000.0, r->wallSeconds,
+           (r->wallSeconds > 0.0) ? r->rounds / r->wallSeconds : 0.0);
+    if (timed > 0) {
+        printf("drift measured-true: min %ld, max %ld, mean %.3f ms\n",
+               (long)r->driftMin, (long)r->driftMax, (double)r->driftSum / timed);
+    }
+    printf("EEPROM page writes %lu (%.2f per game)\n", (unsigned long)r->eepromWrites,
+           (r->games > 0) ? (double)r->eepromWrites / r->games : 0.0);
+}
+
+#endif /* CLOCK_VIRTUAL */
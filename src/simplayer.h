@@ -0,0 +1,47 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Synthetic player for simulated runs (CLOCK_VIRTUAL only).
+ *                Responds to each stimulus after an ex-Gaussian delay,
+ *                with configurable false starts and misses, confirms every
+ *                other prompt after a short think time, and checks the
+ *                game's measurement against its own true response time.
+ *
+ ******************************************************************************/
+
+#ifndef __SIMPLAYER_H
+#define __SIMPLAYER_H
+
+#ifdef CLOCK_VIRTUAL
+
+typedef struct {
+    uint16_t mu;                /* ex-Gaussian parameters of responses, ms */
+    uint16_t sigma;
+    uint16_t tau;
+    uint16_t falseStartPermille;/* press held from before the stimulus */
+    uint16_t missPermille;      /* no response until missDelayMs */
+    uint16_t missDelayMs;
+    uint16_t thinkMs;           /* delay before confirming a prompt */
+    uint32_t seed;
+} simplayer_config_t;
+
+typedef struct {
+    uint32_t games;
+    uint32_t rounds;
+    uint32_t falseStarts;
+    uint32_t misses;
+    int32_t  driftMin;          /* measured minus true, ms */
+    int32_t  driftMax;
+    int64_t  driftSum;
+    uint32_t eepromWrites;      /* page writes during the run */
+    uint64_t simulatedMs;
+    double   wallSeconds;
+} simplayer_report_t;
+
+void simplayer_init(const simplayer_config_t *config);
+void simplayer_runLoadTest(const simplayer_config_t *config, uint32_t games,
+                           void (*playGame)(void), simplayer_report_t *report);
+void simplayer_printReport(const simplayer_report_t *report);
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __SIMPLAYER_H */
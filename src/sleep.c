@@ -0,0 +1,142 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Inactivity sleep of the waiting screens, see sleep.h.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "joystick.h"
+
+#include "capture.h"
+#include "clock.h"
+#include "display.h"
+#include "dlog.h"
+#include "input.h"
+#include "latency.h"
+#include "trace.h"
+#include "sleep.h"
+
+#ifndef CLOCK_VIRTUAL
+
+/*
+ * Waits for the next interrupt: SysTick at the latest, after 1 ms, or
+ * earlier for the center button capture edge or serial input.
+ */
+#define SLEEP_IDLE()        __asm volatile ("wfi")
+
+/*
+ * When the waking input came, given the last check that found none: the
+ * center button's edge interrupt stamps it, other keys and serial input
+ * may have come any time after that check.
+ */
+#define SLEEP_INPUT_US(keys, quietUs) \
+    (((keys) & JOYSTICK_CENTER) ? (quietUs) + capture_elapsedUs(quietUs) : (quietUs))
+
+#else /* CLOCK_VIRTUAL */
+
+#define SLEEP_IDLE()        clock_delayMs(1)
+
+/* Host: input changes between the simulated millisecond checks */
+#define SLEEP_INPUT_US(keys, quietUs)   (quietUs)
+
+#endif /* CLOCK_VIRTUAL */
+
+/* Time of the last input or activity */
+static uint32_t lastActivityMs;
+
+/* Set by sleep_touch(), wakes a sleeping screen */
+static volatile uint8_t activity;
+
+/* Wake-to-visible time of the last wake */
+static uint32_t lastWakeUs;
+
+/*****************************************************************************
+** Function name:       sleep_touch
+**
+** Description:         Records activity: restarts the inactivity timer
+**                      and wakes a sleeping screen. Called for input that
+**                      does not come through the joystick bits, such as
+**                      remote-control commands, and when a screen starts
+**                      waiting.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void sleep_touch(void)
+{
+    lastActivityMs = clock_nowMs();
+    activity = 1;
+}
+
+/*****************************************************************************
+** Function name:       sleep_poll
+**
+** Description:         Inactivity check of a waiting screen, called on
+**                      each pass of its input loop. Input restarts the
+**                      timer. Once the timer runs out this switches the
+**                      panel off and idles until input or activity,
+**                      restores the panel and waits for the wake keys to
+**                      be released, so the press that woke the board does
+**                      not also act on the screen. The wake-to-visible
+**                      time runs from the waking input, including the
+**                      time until the idle loop saw it, until the
+**                      display-on command is out on the bus.
+**
+** Parameters:          keys - JOYSTICK_* bits the caller just read
+** Returned value:      1 if the board slept and woke up, else 0
+*****************************************************************************/
+uint8_t sleep_poll(uint8_t keys)
+{
+    uint32_t asleepSince = clock_nowMs();
+
+    if (keys != 0) {
+        lastActivityMs = asleepSince;
+        return 0;
+    }
+    if ((asleepSince - lastActivityMs) < SLEEP_TIMEOUT_MS) {
+        return 0;
+    }
+
+    uint64_t quietUs;
+
+    display_sleep();
+    activity = 0;
+    do {
+        quietUs = clock_nowUs();
+        capture_arm();
+        SLEEP_IDLE();
+        keys = input_read();
+    } while (!activity && (keys == 0));
+
+    uint64_t inputUs = SLEEP_INPUT_US(keys, quietUs);
+
+    trace_begin(TRACE_WAKE, 0);
+    latency_event(LATENCY_WAKE);
+    display_wake();
+    lastWakeUs = (uint32_t)(clock_nowUs() - inputUs);
+    trace_end(TRACE_WAKE, (uint16_t)lastWakeUs);
+    DLOG("woke after %lu ms, visible in %lu us",
+         clock_nowMs() - asleepSince, lastWakeUs);
+
+    while (input_read() != 0) {
+        clock_delayMs(1);
+    }
+    lastActivityMs = clock_nowMs();
+    return 1;
+}
+
+/*****************************************************************************
+** Function name:       sleep_getWakeUs
+**
+** Description:         Wake-to-visible time of the last wake: from the
+**                      input that woke the board until the display-on
+**                      command is out on the bus.
+**
+** Parameters:          None
+** Returned value:      Time in microseconds, 0 before the first wake
+*****************************************************************************/
+uint32_t sleep_getWakeUs(void)
+{
+    return lastWakeUs;
+}
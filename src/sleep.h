@@ -0,0 +1,26 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Inactivity sleep. Screens that wait for the player call
+ *                sleep_poll() with the input they read; after
+ *                SLEEP_TIMEOUT_MS without input the panel is switched off
+ *                and the CPU waits for interrupts instead of polling
+ *                sensors. A joystick press, or any command on the remote
+ *                link, wakes it: the panel is switched back on showing
+ *                what it showed before, and the wake-to-visible time is
+ *                logged.
+ *
+ ******************************************************************************/
+
+#ifndef __SLEEP_H
+#define __SLEEP_H
+
+/* Time without input before the panel goes off */
+#ifndef SLEEP_TIMEOUT_MS
+#define SLEEP_TIMEOUT_MS    60000
+#endif
+
+void sleep_touch(void);
+uint8_t sleep_poll(uint8_t keys);
+uint32_t sleep_getWakeUs(void);
+
+#endif /* end __SLEEP_H */
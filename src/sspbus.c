@@ -0,0 +1,262 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Arbiter for the shared SSP bus. The queue is a singly
+ *                linked list of caller-owned descriptors kept in priority
+ *                order, so no allocation and O(1) dispatch of the head.
+ *
+ ******************************************************************************/
+
+#include "mcu_regs.h"
+#include "type.h"
+#include "ssp.h"
+
+#include "busmon.h"
+#include "fastgpio.h"
+#include "power.h"
+#include "sspbus.h"
+#include "trace.h"
+
+/*
+ * All devices share one SSP_PCLK of 72 MHz; per-device rates come from
+ * CPSR and SCR. No SSP interrupts: RX is drained by the burst loop itself.
+ */
+#define SSPBUS_CLKDIV       1
+#define SSP_FIFO_DEPTH      8
+
+/* Trace argument identifying a device: chip select port and pin */
+#define TRACE_CHIP_SELECT(device)   (((uint16_t)(device)->csPort << 8) | (device)->csPin)
+
+/* Highest priority pending transfer first */
+static sspbus_xfer_t *queueHead;
+
+/* Device whose settings are loaded in the SSP, NULL if unknown */
+static const sspbus_device_t *configured;
+
+#ifndef CLOCK_VIRTUAL
+
+/*****************************************************************************
+** Function name:       sspBurst
+**
+** Description:         Streams a buffer through the SSP. The TX FIFO is
+**                      topped up whenever it has room, while RX is drained
+**                      in bulk; at most SSP_FIFO_DEPTH frames are in flight
+**                      so the RX FIFO can never overrun. Returns after the
+**                      last frame has been shifted out.
+**
+** Parameters:          data - bytes to send
+**                      len  - number of bytes
+** Returned value:      None
+*****************************************************************************/
+static void sspBurst(const uint8_t *data, uint32_t len)
+{
+    uint32_t inFlight = 0;
+
+    while ((len > 0) || (inFlight > 0)) {
+        while ((len > 0) && (inFlight < SSP_FIFO_DEPTH) && (LPC_SSP->SR & SSPSR_TNF)) {
+            LPC_SSP->DR = *data++;
+            len--;
+            inFlight++;
+        }
+        while (LPC_SSP->SR & SSPSR_RNE) {
+            (void)LPC_SSP->DR;
+            inFlight--;
+        }
+    }
+}
+
+/*****************************************************************************
+** Function name:       selectDevice
+**
+** Description:         Loads the SSP settings of a device unless they are
+**                      already active. Only called between transfers, when
+**                      the SSP is idle.
+**
+** Parameters:          device - device to talk to
+** Returned value:      None
+*****************************************************************************/
+static void selectDevice(const sspbus_device_t *device)
+{
+    if (device == configured) {
+        return;
+    }
+
+    LPC_SSP->CR1 = 0;                   // Disable while reconfiguring
+    LPC_SSP->CR0 = device->cr0;
+    LPC_SSP->CPSR = device->cpsr;
+    LPC_SSP->CR1 = SSPCR1_SSE;
+    configured = device;
+}
+
+#else /* CLOCK_VIRTUAL */
+
+/*****************************************************************************
+** Function name:       sspBurst
+**
+** Description:         Host: hands the buffer to the board model through
+**                      the library's SSPSend().
+**
+** Parameters:          data - bytes to send
+**                      len  - number of bytes
+** Returned value:      None
+*****************************************************************************/
+static void sspBurst(const uint8_t *data, uint32_t len)
+{
+    SSPSend((uint8_t *)data, len);
+}
+
+/*****************************************************************************
+** Function name:       selectDevice
+**
+** Description:         Host: remembers the device; the board model has no
+**                      clock or frame settings.
+**
+** Parameters:          device - device to talk to
+** Returned value:      None
+*****************************************************************************/
+static void selectDevice(const sspbus_device_t *device)
+{
+    configured = device;
+}
+
+#endif /* CLOCK_VIRTUAL */
+
+/*****************************************************************************
+** Function name:       runXfer
+**
+** Description:         Performs one transfer inside its own chip-select
+**                      window, with the SSP clock running only for it.
+**
+** Parameters:          xfer - transfer to run
+** Returned value:      None
+*****************************************************************************/
+static void runXfer(sspbus_xfer_t *xfer)
+{
+    const sspbus_device_t *device = xfer->device;
+    uint8_t hasDc = (device->dcPort != SSPBUS_NO_DC);
+    uint32_t start = busmon_now();
+
+    trace_begin(TRACE_SSP, TRACE_CHIP_SELECT(device));
+    power_acquire(POWER_DISPLAYS);
+    selectDevice(device);
+    FASTGPIO_LOW(device->csPort, device->csPin);
+
+    if (xfer->headLen > 0) {
+        if (hasDc) {
+            FASTGPIO_LOW(device->dcPort, device->dcPin);
+        }
+        sspBurst(xfer->head, xfer->headLen);
+    }
+    if (xfer->bodyLen > 0) {
+        if (hasDc) {
+            FASTGPIO_HIGH(device->dcPort, device->dcPin);
+        }
+        sspBurst(xfer->body, xfer->bodyLen);
+    }
+
+    FASTGPIO_HIGH(device->csPort, device->csPin);
+    power_release(POWER_DISPLAYS);
+    trace_end(TRACE_SSP, TRACE_CHIP_SELECT(device));
+    busmon_addSsp(busmon_now() - start);
+}
+
+/*****************************************************************************
+** Function name:       sspbus_init
+**
+** Description:         Takes over the SSP after the library drivers have
+**                      brought their devices up. Interrupts are masked and
+**                      the RX FIFO emptied; device settings are loaded on
+**                      first use.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void sspbus_init(void)
+{
+#ifndef CLOCK_VIRTUAL
+    while (LPC_SSP->SR & SSPSR_BSY);
+
+    LPC_SYSCON->SSPCLKDIV = SSPBUS_CLKDIV;
+    LPC_SSP->IMSC = 0;
+    while (LPC_SSP->SR & SSPSR_RNE) {
+        (void)LPC_SSP->DR;
+    }
+#endif
+
+    queueHead = NULL;
+    configured = NULL;
+}
+
+/*****************************************************************************
+** Function name:       sspbus_submit
+**
+** Description:         Queues a transfer behind all pending transfers of
+**                      the same or higher priority. A descriptor that is
+**                      still queued is completed first.
+**
+** Parameters:          xfer - filled-in transfer descriptor
+** Returned value:      None
+*****************************************************************************/
+void sspbus_submit(sspbus_xfer_t *xfer)
+{
+    sspbus_xfer_t **link = &queueHead;
+
+    sspbus_complete(xfer);
+
+    while ((*link != NULL) && ((*link)->priority >= xfer->priority)) {
+        link = &(*link)->next;
+    }
+    xfer->next = *link;
+    xfer->state = SSPBUS_XFER_QUEUED;
+    *link = xfer;
+}
+
+/*****************************************************************************
+** Function name:       sspbus_service
+**
+** Description:         Runs the highest priority pending transfer.
+**
+** Parameters:          None
+** Returned value:      1 if a transfer was run, 0 if the queue was empty
+*****************************************************************************/
+uint8_t sspbus_service(void)
+{
+    sspbus_xfer_t *xfer = queueHead;
+
+    if (xfer == NULL) {
+        return 0;
+    }
+
+    queueHead = xfer->next;
+    runXfer(xfer);
+    xfer->state = SSPBUS_XFER_DONE;
+    return 1;
+}
+
+/*****************************************************************************
+** Function name:       sspbus_complete
+**
+** Description:         Services the queue until a transfer has been sent.
+**                      Transfers queued ahead of it run first.
+**
+** Parameters:          xfer - transfer to wait for
+** Returned value:      None
+*****************************************************************************/
+void sspbus_complete(sspbus_xfer_t *xfer)
+{
+    while (xfer->state == SSPBUS_XFER_QUEUED) {
+        sspbus_service();
+    }
+}
+
+/*****************************************************************************
+** Function name:       sspbus_drain
+**
+** Description:         Services the queue until it is empty.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void sspbus_drain(void)
+{
+    while (sspbus_service());
+}
@@ -0,0 +1,62 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Arbiter for the shared SSP bus. Each device carries its
+ *                own clock, frame format and chip select; transfers are
+ *                queued by priority and run one at a time, each inside its
+ *                own chip-select window, so a short urgent transfer can
+ *                run between the segments of a long one.
+ *
+ *                Cooperative: transfers run from sspbus_service() or while
+ *                waiting in sspbus_complete(). Thread level only, not from
+ *                interrupt handlers.
+ *
+ ******************************************************************************/
+
+#ifndef __SSPBUS_H
+#define __SSPBUS_H
+
+/* Queue order, higher runs first; equal priorities run in submit order */
+#define SSPBUS_PRIO_BACKGROUND  0
+#define SSPBUS_PRIO_NORMAL      1
+#define SSPBUS_PRIO_URGENT      2
+
+/* dcPort value for devices without a data/command line */
+#define SSPBUS_NO_DC            0xFF
+
+/* Transfer states */
+#define SSPBUS_XFER_DONE        0
+#define SSPBUS_XFER_QUEUED      1
+
+typedef struct {
+    uint16_t cr0;       /* SSP CR0: frame size, SPI mode and SCR */
+    uint8_t  cpsr;      /* SSP clock prescaler, even, >= 2 */
+    uint8_t  csPort;    /* active-low chip select */
+    uint8_t  csPin;
+    uint8_t  dcPort;    /* data/command select or SSPBUS_NO_DC */
+    uint8_t  dcPin;
+} sspbus_device_t;
+
+/*
+ * One chip-select window. The head is sent with DC low (command), the body
+ * with DC high (data); on devices without DC both are plain bytes. Buffers
+ * and the descriptor belong to the caller and must stay untouched until
+ * the state returns to SSPBUS_XFER_DONE.
+ */
+typedef struct sspbus_xfer {
+    const sspbus_device_t *device;
+    const uint8_t *head;
+    const uint8_t *body;
+    uint16_t bodyLen;
+    uint8_t headLen;
+    uint8_t priority;
+    volatile uint8_t state;
+    struct sspbus_xfer *next;
+} sspbus_xfer_t;
+
+void sspbus_init(void);
+void sspbus_submit(sspbus_xfer_t *xfer);
+uint8_t sspbus_service(void);
+void sspbus_complete(sspbus_xfer_t *xfer);
+void sspbus_drain(void);
+
+#endif /* end __SSPBUS_H */
@@ -0,0 +1,244 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Stack high-water-mark instrumentation by stack painting,
+ *                on the board or for a budgeted run on the host.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "stack.h"
+
+#ifndef CLOCK_VIRTUAL
+
+/* Linker script symbols: first free word above .bss, initial stack top */
+extern uint32_t _pvHeapStart;
+extern uint32_t _vStackTop;
+
+/* Bytes left unpainted below the stack pointer inside stack_paint() */
+#define PAINT_MARGIN    32
+
+volatile uint32_t stackIsrMinSp = 0xFFFFFFFF;
+
+/*****************************************************************************
+** Function name:       stack_paint
+**
+** Description:         Fills the unused stack area with the paint pattern.
+**                      Call at the start of main(). Nothing may use the
+**                      heap: it would grow into the painted area and be
+**                      reported as stack.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void stack_paint(void)
+{
+    uint32_t sp;
+    volatile uint32_t *p = &_pvHeapStart;
+
+    __asm volatile ("mov %0, sp" : "=r" (sp));
+    while ((uint32_t)p < sp - PAINT_MARGIN) {
+        *p++ = STACK_PAINT_PATTERN;
+    }
+    stackIsrMinSp = 0xFFFFFFFF;
+}
+
+/*****************************************************************************
+** Function name:       stack_getSize
+**
+** Description:         RAM available to the stack.
+**
+** Parameters:          None
+** Returned value:      Bytes between the end of .bss and the stack top
+*****************************************************************************/
+uint32_t stack_getSize(void)
+{
+    return (uint32_t)&_vStackTop - (uint32_t)&_pvHeapStart;
+}
+
+/*****************************************************************************
+** Function name:       stack_getHighWater
+**
+** Description:         Deepest stack use since stack_paint(), thread code
+**                      and interrupts together.
+**
+** Parameters:          None
+** Returned value:      Bytes used at the deepest point
+*****************************************************************************/
+uint32_t stack_getHighWater(void)
+{
+    const volatile uint32_t *p = &_pvHeapStart;
+
+    while (((uint32_t)p < (uint32_t)&_vStackTop) && (*p == STACK_PAINT_PATTERN)) {
+        p++;
+    }
+    return (uint32_t)&_vStackTop - (uint32_t)p;
+}
+
+/*****************************************************************************
+** Function name:       stack_getIsrDepth
+**
+** Description:         Deepest stack seen on interrupt entry, i.e. thread
+**                      use plus the exception frame at that moment. The
+**                      handler's own use lies below it and is included in
+**                      the high-water mark.
+**
+** Parameters:          None
+** Returned value:      Bytes, 0 if no sampled interrupt ran yet
+*****************************************************************************/
+uint32_t stack_getIsrDepth(void)
+{
+    uint32_t minSp = stackIsrMinSp;
+
+    return (minSp == 0xFFFFFFFF) ? 0 : ((uint32_t)&_vStackTop - minSp);
+}
+
+#else /* CLOCK_VIRTUAL */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Painted region below the budget that the run must not reach */
+#define GUARD_BYTES     16384
+
+static void (*budgetedFn)(void);
+static volatile uint8_t budgetRan;
+
+/* Stack of the budgeted run in progress */
+static const uint32_t *budgetBase;
+static uint32_t budgetWords;
+static uint32_t budgetBytes;
+
+/*****************************************************************************
+** Function name:       stack_getSize
+**
+** Description:         Budget of the current or last budgeted run.
+**
+** Parameters:          None
+** Returned value:      Bytes, 0 if none ran yet
+*****************************************************************************/
+uint32_t stack_getSize(void)
+{
+    return budgetBytes;
+}
+
+/*****************************************************************************
+** Function name:       stack_getHighWater
+**
+** Description:         Deepest use so far of the budgeted run in progress.
+**                      Only valid when called from inside that run.
+**
+** Parameters:          None
+** Returned value:      Bytes used, guard region included
+*****************************************************************************/
+uint32_t stack_getHighWater(void)
+{
+    uint32_t i;
+
+    if (budgetBase == NULL) {
+        return 0;
+    }
+    for (i = 0; (i < budgetWords) && (budgetBase[i] == STACK_PAINT_PATTERN); i++);
+    return (budgetWords - i) * sizeof(uint32_t);
+}
+
+/*****************************************************************************
+** Function name:       budgetThread
+**
+** Description:         Thread body of a budgeted run.
+**
+** Parameters:          arg - unused
+** Returned value:      NULL
+*****************************************************************************/
+static void *budgetThread(void *arg)
+{
+    (void)arg;
+    budgetedFn();
+    budgetRan = 1;
+    return NULL;
+}
+
+/*****************************************************************************
+** Function name:       stack_runWithBudget
+**
+** Description:         Runs a function on a painted stack of the given
+**                      budget with a painted guard region below it, then
+**                      measures how much of the stack was written. The
+**                      budget must be at least PTHREAD_STACK_MIN; the C
+**                      library keeps its thread data at the top of the
+**                      stack, a few KB that count as used. A run whose
+**                      thread cannot be set up, or that does not return
+**                      from fn, is reported on stderr and fails.
+**
+** Parameters:          fn     - function to run
+**                      budget - stack budget in bytes
+**                      result - receives used bytes, guard status and
+**                               whether fn ran to completion
+** Returned value:      1 if fn ran and stayed within budget, else 0
+*****************************************************************************/
+uint8_t stack_runWithBudget(void (*fn)(void), uint32_t budget, stack_budget_t *result)
+{
+    uint32_t words = (budget + GUARD_BYTES) / sizeof(uint32_t);
+    uint32_t *stack;
+    pthread_attr_t attr;
+    pthread_t thread;
+    uint32_t i;
+    int err;
+
+    result->used = 0;
+    result->guardHit = 0;
+    result->ran = 0;
+
+    stack = malloc(words * sizeof(uint32_t));
+    if (stack == NULL) {
+        fprintf(stderr, "stack: no memory for a %lu byte budget\n", (unsigned long)budget);
+        return 0;
+    }
+    for (i = 0; i < words; i++) {
+        stack[i] = STACK_PAINT_PATTERN;
+    }
+
+    budgetedFn = fn;
+    budgetRan = 0;
+    budgetBase = stack;
+    budgetWords = words;
+    budgetBytes = budget;
+
+    err = pthread_attr_init(&attr);
+    if (err == 0) {
+        err = pthread_attr_setstack(&attr, stack, words * sizeof(uint32_t));
+        if (err != 0) {
+            fprintf(stderr, "stack: pthread_attr_setstack: %s\n", strerror(err));
+        } else {
+            err = pthread_create(&thread, &attr, budgetThread, NULL);
+            if (err != 0) {
+                fprintf(stderr, "stack: pthread_create: %s\n", strerror(err));
+            } else {
+                err = pthread_join(thread, NULL);
+                if (err != 0) {
+                    fprintf(stderr, "stack: pthread_join: %s\n", strerror(err));
+                }
+            }
+        }
+        pthread_attr_destroy(&attr);
+    } else {
+        fprintf(stderr, "stack: pthread_attr_init: %s\n", strerror(err));
+    }
+
+    if (err == 0) {
+        result->ran = budgetRan;
+        if (!result->ran) {
+            fprintf(stderr, "stack: budgeted function did not return\n");
+        }
+        result->used = stack_getHighWater();
+        result->guardHit = (result->used > budget);
+    }
+
+    budgetBase = NULL;
+    free(stack);
+    return result->ran && !result->guardHit;
+}
+
+#endif /* CLOCK_VIRTUAL */
@@ -0,0 +1,73 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Stack high-water-mark instrumentation. All free RAM
+ *                between the end of .bss and the live stack is painted
+ *                with a pattern at boot; the deepest overwritten word
+ *                gives the main stack high-water mark. Thread code and
+ *                interrupts share the main stack, so interrupt paths are
+ *                tracked separately by sampling the stack pointer on
+ *                entry to each handler.
+ *
+ *                Built with CLOCK_VIRTUAL (host), a function can instead
+ *                be run on a painted stack of a given budget with a guard
+ *                region below it, to enforce stack budgets in tests. The
+ *                size and high-water getters then describe that run.
+ *
+ ******************************************************************************/
+
+#ifndef __STACK_H
+#define __STACK_H
+
+#define STACK_PAINT_PATTERN     0xC5C5C5C5UL
+
+#ifndef CLOCK_VIRTUAL
+
+/* Deepest stack pointer seen on entry to an interrupt handler */
+extern volatile uint32_t stackIsrMinSp;
+
+/*****************************************************************************
+** Function name:       stack_sampleIsr
+**
+** Description:         Records how deep the stack is on interrupt entry.
+**                      Call first thing in interrupt handlers.
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+static inline void stack_sampleIsr(void)
+{
+    uint32_t sp;
+
+    __asm volatile ("mov %0, sp" : "=r" (sp));
+    if (sp < stackIsrMinSp) {
+        stackIsrMinSp = sp;
+    }
+}
+
+void stack_paint(void);
+uint32_t stack_getSize(void);
+uint32_t stack_getHighWater(void);
+uint32_t stack_getIsrDepth(void);
+
+#else /* CLOCK_VIRTUAL */
+
+#define stack_sampleIsr()
+#define stack_paint()
+#define stack_getIsrDepth()     0
+
+/* Result of a budgeted run */
+typedef struct {
+    uint32_t used;          /* bytes of the budget that were written */
+    uint8_t guardHit;       /* 1 if the guard below the budget was touched */
+    uint8_t ran;            /* 1 if the function ran and returned */
+} stack_budget_t;
+
+uint8_t stack_runWithBudget(void (*fn)(void), uint32_t budget, stack_budget_t *result);
+
+/* Budget and deepest use so far of the budgeted run in progress */
+uint32_t stack_getSize(void);
+uint32_t stack_getHighWater(void);
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __STACK_H */
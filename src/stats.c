@@ -0,0 +1,215 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Reaction-time statistics since power-on. Counters are
+ *                updated as results arrive and drawn with rectangle fills,
+ *                one fill per histogram bar or trend column.
+ *
+ ******************************************************************************/
+
+#include "type.h"
+
+#include "display.h"
+#include "stats.h"
+
+/* Result histogram and its tallest bin, kept for O(1) scaling */
+static uint16_t histBins[STATS_HIST_BINS];
+static uint16_t histPeak;
+static uint16_t resultCount;
+
+/*
+ * Trend of session averages. Column i covers trendSpan sessions, except
+ * the last one which holds trendFill. When every column is in use, pairs
+ * are merged and the span doubles, so each session costs O(1) amortised.
+ */
+static uint16_t trendMin[STATS_TREND_COLUMNS];
+static uint16_t trendMax[STATS_TREND_COLUMNS];
+static uint8_t trendUsed;
+static uint16_t trendSpan = 1;
+static uint16_t trendFill;
+static uint16_t trendLow = 0xFFFF;
+static uint16_t trendHigh;
+static uint16_t sessionCount;
+
+/*****************************************************************************
+** Function name:       stats_addResult
+**
+** Description:         Counts one reaction time in the histogram.
+**
+** Parameters:          ms - reaction time in milliseconds
+** Returned value:      None
+*****************************************************************************/
+void stats_addResult(uint32_t ms)
+{
+    uint32_t bin = 0;
+
+    if (ms >= STATS_HIST_FIRST_MS) {
+        bin = (ms - STATS_HIST_FIRST_MS) / STATS_HIST_BIN_MS;
+    }
+    if (bin >= STATS_HIST_BINS) {
+        bin = STATS_HIST_BINS - 1;
+    }
+
+    if (histBins[bin] < 0xFFFF) {
+        histBins[bin]++;
+        if (histBins[bin] > histPeak) {
+            histPeak = histBins[bin];
+        }
+    }
+    if (resultCount < 0xFFFF) {
+        resultCount++;
+    }
+}
+
+/*****************************************************************************
+** Function name:       stats_addSession
+**
+** Description:         Adds a session average to the trend.
+**
+** Parameters:          avgMs - average reaction time of the session
+** Returned value:      None
+*****************************************************************************/
+void stats_addSession(uint32_t avgMs)
+{
+    uint16_t value = (avgMs > 0xFFFF) ? 0xFFFF : (uint16_t)avgMs;
+
+    if ((trendUsed == 0) || (trendFill == trendSpan)) {
+        if (trendUsed == STATS_TREND_COLUMNS) {
+            for (uint8_t i = 0; i < STATS_TREND_COLUMNS / 2; i++) {
+                uint16_t lo0 = trendMin[2 * i], lo1 = trendMin[2 * i + 1];
+                uint16_t hi0 = trendMax[2 * i], hi1 = trendMax[2 * i + 1];
+                trendMin[i] = (lo0 < lo1) ? lo0 : lo1;
+                trendMax[i] = (hi0 > hi1) ? hi0 : hi1;
+            }
+            trendUsed = STATS_TREND_COLUMNS / 2;
+            trendSpan *= 2;
+        }
+        trendMin[trendUsed] = value;
+        trendMax[trendUsed] = value;
+        trendUsed++;
+        trendFill = 1;
+    } else {
+        uint8_t last = trendUsed - 1;
+        if (value < trendMin[last]) trendMin[last] = value;
+        if (value > trendMax[last]) trendMax[last] = value;
+        trendFill++;
+    }
+
+    if (value < trendLow) trendLow = value;
+    if (value > trendHigh) trendHigh = value;
+    if (sessionCount < 0xFFFF) {
+        sessionCount++;
+    }
+}
+
+/*****************************************************************************
+** Function name:       stats_getResultCount
+**
+** Description:         Number of results in the histogram.
+**
+** Parameters:          None
+** Returned value:      Result count, saturating
+*****************************************************************************/
+uint16_t stats_getResultCount(void)
+{
+    return resultCount;
+}
+
+/*****************************************************************************
+** Function name:       stats_getSessionCount
+**
+** Description:         Number of sessions in the trend.
+**
+** Parameters:          None
+** Returned value:      Session count, saturating
+*****************************************************************************/
+uint16_t stats_getSessionCount(void)
+{
+    return sessionCount;
+}
+
+/*****************************************************************************
+** Function name:       stats_getTrendLow
+**
+** Description:         Lowest session average, the bottom of the trend
+**                      scale.
+**
+** Parameters:          None
+** Returned value:      Milliseconds, 0 if there are no sessions
+*****************************************************************************/
+uint16_t stats_getTrendLow(void)
+{
+    return (sessionCount > 0) ? trendLow : 0;
+}
+
+/*****************************************************************************
+** Function name:       stats_getTrendHigh
+**
+** Description:         Highest session average, the top of the trend
+**                      scale.
+**
+** Parameters:          None
+** Returned value:      Milliseconds, 0 if there are no sessions
+*****************************************************************************/
+uint16_t stats_getTrendHigh(void)
+{
+    return trendHigh;
+}
+
+/*****************************************************************************
+** Function name:       stats_drawHistogram
+**
+** Description:         Draws the histogram as bottom-aligned bars scaled
+**                      to the tallest bin. Each bar is one column fill.
+**
+** Parameters:          x, y          - top left corner of the area
+**                      width, height - area size; bar pitch is
+**                                      width / STATS_HIST_BINS
+**                      fg, bg        - bar and background colors
+** Returned value:      None
+*****************************************************************************/
+void stats_drawHistogram(uint8_t x, uint8_t y, uint8_t width, uint8_t height, oled_color_t fg, oled_color_t bg)
+{
+    uint8_t pitch = width / STATS_HIST_BINS;
+    uint8_t barWidth = (pitch > 1) ? (pitch - 1) : 1;
+
+    display_fillRect(x, y, width, height, bg);
+    if (histPeak == 0) {
+        return;
+    }
+
+    for (uint8_t bin = 0; bin < STATS_HIST_BINS; bin++) {
+        uint8_t bar = (uint8_t)(((uint32_t)histBins[bin] * height + histPeak - 1) / histPeak);
+        display_fillRect(x + bin * pitch, y + height - bar, barWidth, bar, fg);
+    }
+}
+
+/*****************************************************************************
+** Function name:       stats_drawTrend
+**
+** Description:         Draws the trend as a min/max sparkline: each column
+**                      is one vertical fill from its minimum to its maximum
+**                      average, scaled between the overall extremes. Lower
+**                      is faster and drawn higher up.
+**
+** Parameters:          x, y          - top left corner of the area
+**                      width, height - area size; column pitch is
+**                                      width / STATS_TREND_COLUMNS
+**                      fg, bg        - line and background colors
+** Returned value:      None
+*****************************************************************************/
+void stats_drawTrend(uint8_t x, uint8_t y, uint8_t width, uint8_t height, oled_color_t fg, oled_color_t bg)
+{
+    uint8_t pitch = width / STATS_TREND_COLUMNS;
+    uint32_t range = (trendHigh > trendLow) ? (uint32_t)(trendHigh - trendLow) : 1;
+
+    display_fillRect(x, y, width, height, bg);
+    if (pitch == 0) {
+        pitch = 1;
+    }
+
+    for (uint8_t col = 0; col < trendUsed; col++) {
+        uint8_t top = (uint8_t)(((uint32_t)(trendMin[col] - trendLow) * (height - 1)) / range);
+        uint8_t bottom = (uint8_t)(((uint32_t)(trendMax[col] - trendLow) * (height - 1)) / range);
+        display_fillRect(x + col * pitch, y + top, pitch, bottom - top + 1, fg);
+    }
+}
@@ -0,0 +1,32 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Reaction-time statistics since power-on: a fixed-bin
+ *                histogram of single results and a min/max downsampled
+ *                trend of session averages. Every update is O(1)
+ *                (amortised for the trend), no result records are kept.
+ *
+ ******************************************************************************/
+
+#ifndef __STATS_H
+#define __STATS_H
+
+#include "oled.h"
+
+/* Histogram bins: STATS_HIST_FIRST_MS upwards, last bin is open-ended */
+#define STATS_HIST_BINS         16
+#define STATS_HIST_FIRST_MS     100
+#define STATS_HIST_BIN_MS       40
+
+/* Trend columns; each holds the min and max of a run of sessions */
+#define STATS_TREND_COLUMNS     32
+
+void stats_addResult(uint32_t ms);
+void stats_addSession(uint32_t avgMs);
+uint16_t stats_getResultCount(void);
+uint16_t stats_getSessionCount(void);
+uint16_t stats_getTrendLow(void);
+uint16_t stats_getTrendHigh(void);
+void stats_drawHistogram(uint8_t x, uint8_t y, uint8_t width, uint8_t height, oled_color_t fg, oled_color_t bg);
+void stats_drawTrend(uint8_t x, uint8_t y, uint8_t width, uint8_t height, oled_color_t fg, oled_color_t bg);
+
+#endif /* end __STATS_H */
@@ -0,0 +1,90 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Event trace ring, see trace.h.
+ *
+ ******************************************************************************/
+
+#ifndef CLOCK_VIRTUAL
+
+#include "mcu_regs.h"
+#include "type.h"
+
+#include "atomic.h"
+#include "perf.h"
+#include "serial.h"
+#include "trace.h"
+
+typedef struct {
+    uint32_t cycles;
+    uint8_t phase;
+    uint8_t id;
+    uint16_t arg;
+} TraceRecord;
+
+static TraceRecord ring[TRACE_ENTRIES];
+
+/* Records ever reserved; the ring holds the last TRACE_ENTRIES of them */
+static volatile uint32_t head;
+
+/* Set while dumping, so the ring is not overwritten under the reader */
+static volatile uint8_t paused;
+
+/*****************************************************************************
+** Function name:       trace_record
+**
+** Description:         Appends an event, overwriting the oldest one when
+**                      the ring is full. Callable from interrupt handlers.
+**
+** Parameters:          phase - TRACE_BEGIN, TRACE_END or TRACE_INSTANT
+**                      id    - TRACE_* event id
+**                      arg   - event argument
+** Returned value:      None
+*****************************************************************************/
+void trace_record(uint8_t phase, uint8_t id, uint16_t arg)
+{
+    if (paused) {
+        return;
+    }
+    TraceRecord *record = &ring[atomic_fetchAdd(&head, 1) & (TRACE_ENTRIES - 1)];
+
+    record->cycles = PERF_CYCLES();
+    record->phase = phase;
+    record->id = id;
+    record->arg = arg;
+}
+
+/*****************************************************************************
+** Function name:       trace_dump
+**
+** Description:         Sends the ring over the serial link, oldest record
+**                      first, then empties it. Events are not recorded
+**                      meanwhile. Format, read by tools/trace2json.py:
+**
+**                          trace begin hz=72000000 count=N lost=M
+**                          e <cycles hex> <phase> <id> <arg>
+**                          trace end
+**
+** Parameters:          None
+** Returned value:      None
+*****************************************************************************/
+void trace_dump(void)
+{
+    paused = 1;
+
+    uint32_t end = head;
+    uint32_t count = (end < TRACE_ENTRIES) ? end : TRACE_ENTRIES;
+
+    serial_printf("trace begin hz=%lu count=%lu lost=%lu\r\n", (unsigned long)SystemFrequency,
+                  (unsigned long)count, (unsigned long)(end - count));
+    for (uint32_t i = end - count; i != end; i++) {
+        const TraceRecord *record = &ring[i & (TRACE_ENTRIES - 1)];
+        serial_printf("e %08lx %u %u %u\r\n", (unsigned long)record->cycles, record->phase,
+                      record->id, record->arg);
+    }
+    serial_write("trace end\r\n");
+
+    head = 0;
+    paused = 0;
+}
+
+#endif /* CLOCK_VIRTUAL */
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ *   Project: Reflex
+ *   Description: Event trace. Begin, end and instant events go into a RAM
+ *                ring of 8-byte records stamped with the core cycle
+ *                counter; recording is lock-free (LDREX/STREX), never
+ *                masks interrupts and takes well under a microsecond, so
+ *                it stays on in normal builds. The ring is sent over the
+ *                serial link on request and tools/trace2json.py turns it
+ *                into Chrome trace / Perfetto JSON.
+ *
+ *                Built with CLOCK_VIRTUAL, all calls compile away.
+ *
+ ******************************************************************************/
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+/* Ring size in records, a power of two; 8 bytes of RAM each */
+#ifndef TRACE_ENTRIES
+#define TRACE_ENTRIES       128
+#endif
+
+/* Event phases */
+#define TRACE_BEGIN         0
+#define TRACE_END           1
+#define TRACE_INSTANT       2
+
+/* Event ids, names in tools/trace2json.py */
+#define TRACE_SYNC          0   /* clock marker every 16384 ms, arg = ms >> 14 */
+#define TRACE_ROUND         1   /* game round, arg = round */
+#define TRACE_STIMULUS      2   /* stimulus onset */
+#define TRACE_CLICK         3   /* captured center button edge */
+#define TRACE_DRAW          4   /* display flush, arg = bytes on end */
+#define TRACE_SSP           5   /* SSP transfer, arg = chip select port/pin */
+#define TRACE_AUDIO         6   /* note, arg = period in us */
+#define TRACE_EEPROM        7   /* EEPROM write, arg = address */
+#define TRACE_RESULT        8   /* reaction time measured, arg = ms */
+#define TRACE_QR            9   /* QR code encoding, arg = text length */
+#define TRACE_WAKE          10  /* panel restored after sleep, arg = us on end */
+
+#ifndef CLOCK_VIRTUAL
+
+void trace_record(uint8_t phase, uint8_t id, uint16_t arg);
+void trace_dump(void);
+
+#define trace_begin(id, arg)    trace_record(TRACE_BEGIN, (id), (arg))
+#define trace_end(id, arg)      trace_record(TRACE_END, (id), (arg))
+#define trace_instant(id, arg)  trace_record(TRACE_INSTANT, (id), (arg))
+
+#else /* CLOCK_VIRTUAL */
+
+#define trace_begin(id, arg)
+#define trace_end(id, arg)
+#define trace_instant(id, arg)
+#define trace_dump()
+
+#endif /* CLOCK_VIRTUAL */
+
+#endif /* end __TRACE_H */
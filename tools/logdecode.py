@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Text from a Reflex deferred-formatting log dump.
+
+The firmware sends its log ring over the serial link when joystick RIGHT
+is pressed in the main menu:
+
+    log begin count=N lost=M
+    l <format hex> <ms> <argc> <arg hex>...
+    log end
+
+The format field is the offset of the format string in the non-allocated
+.logstr section of the firmware image. Capture the text with any terminal
+and decode it with the ELF image of the same build:
+
+    tools/logdecode.py firmware.axf dump.txt
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|t|j)?([diuxXoc%])")
+
+
+def read_section(path, name):
+    """Contents of a named section of a little-endian ELF file."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[5] != 1:
+        sys.exit("%s: not a little-endian ELF file" % path)
+    if data[4] == 1:
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x2E)
+        header = lambda i: struct.unpack_from("<IIIIII", data, shoff + i * shentsize)
+    else:
+        shoff, = struct.unpack_from("<Q", data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x3A)
+        header = lambda i: struct.unpack_from("<IIQQQQ", data, shoff + i * shentsize)
+
+    names_offset = header(shstrndx)[4]
+    for i in range(shnum):
+        sh_name, _, _, _, offset, size = header(i)
+        end = data.index(b"\0", names_offset + sh_name)
+        if data[names_offset + sh_name:end].decode() == name:
+            return data[offset:offset + size]
+    sys.exit("%s: no %s section" % (path, name))
+
+
+def format_string(strings, offset):
+    if offset >= len(strings):
+        return None
+    end = strings.find(b"\0", offset)
+    return strings[offset:end if end >= 0 else len(strings)].decode(errors="replace")
+
+
+def render(fmt, args):
+    """printf-style formatting of raw 32-bit argument words."""
+    values = iter(args)
+
+    def convert(match):
+        flags, width, precision, _, kind = match.groups()
+        if kind == "%":
+            return "%"
+        raw = next(values, 0)
+        if kind in "di":
+            value = raw - (1 << 32) if raw & 0x80000000 else raw
+            kind = "d"
+        elif kind == "c":
+            value = chr(raw & 0xFF)
+        else:
+            value = raw
+            kind = "d" if kind == "u" else kind
+        spec = "%" + flags + width + ("." + precision if precision else "") + kind
+        return spec % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="ELF image of the logging build")
+    parser.add_argument("dump", help="captured serial text, '-' for stdin")
+    args = parser.parse_args()
+
+    strings = read_section(args.elf, ".logstr")
+    source = sys.stdin if args.dump == "-" else open(args.dump, errors="replace")
+    with source:
+        for line in source:
+            fields = line.split()
+            if fields[:2] == ["log", "begin"]:
+                opts = dict(f.split("=", 1) for f in fields[2:])
+                if int(opts.get("lost", 0)) > 0:
+                    print("[%s earlier records lost]" % opts["lost"])
+            elif len(fields) >= 4 and fields[0] == "l":
+                offset, ms, argc = int(fields[1], 16), int(fields[2]), int(fields[3])
+                values = [int(v, 16) for v in fields[4:4 + argc]]
+                fmt = format_string(strings, offset)
+                if fmt is None:
+                    text = "<unknown format %04x> %s" % (offset, " ".join(fields[4:]))
+                else:
+                    text = render(fmt, values)
+                print("%10.3f  %s" % (ms / 1000.0, text))
+
+
+if __name__ == "__main__":
+    main()
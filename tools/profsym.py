@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Flat profile from a Reflex sampling-profiler dump.
+
+The firmware (built with -DPROFILE) sends its PC histogram over the serial
+link when joystick RIGHT is pressed in the main menu:
+
+    profile begin shift=6 total=N outside=M
+    p 00001a40 123
+    ...
+    profile end
+
+Capture that text with any terminal (e.g. `cat /dev/ttyUSB0 > dump.txt`)
+and map it to functions with the ELF image of the same build:
+
+    tools/profsym.py firmware.axf dump.txt
+
+A bucket covers 2**shift bytes of flash. Samples of a bucket that spans
+several functions are split between them by the number of bytes each
+function has in it, so small neighbouring functions are approximate.
+"""
+
+import argparse
+import subprocess
+import sys
+
+
+def read_symbols(elf, nm):
+    """Function symbols as sorted (start, end, name), Thumb bit cleared."""
+    out = subprocess.run([nm, "-S", "-n", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    raw = []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 4:
+            addr, size, kind, name = fields
+            size = int(size, 16)
+        elif len(fields) == 3:
+            addr, kind, name = fields
+            size = None
+        else:
+            continue
+        if kind not in "tTwW":
+            continue
+        raw.append((int(addr, 16) & ~1, size, name))
+
+    raw.sort()
+    symbols = []
+    for i, (start, size, name) in enumerate(raw):
+        if size is None:
+            size = (raw[i + 1][0] - start) if i + 1 < len(raw) else 0
+        if size > 0:
+            symbols.append((start, start + size, name))
+    return symbols
+
+
+def read_dump(lines):
+    """Bucket shift, totals and {bucket start: samples} of the last dump."""
+    shift, total, outside, buckets = None, 0, 0, {}
+    inside = False
+    for line in lines:
+        fields = line.split()
+        if fields[:2] == ["profile", "begin"]:
+            opts = dict(f.split("=", 1) for f in fields[2:])
+            shift = int(opts["shift"])
+            total = int(opts["total"])
+            outside = int(opts["outside"])
+            buckets = {}
+            inside = True
+        elif fields[:2] == ["profile", "end"]:
+            inside = False
+        elif inside and len(fields) == 3 and fields[0] == "p":
+            buckets[int(fields[1], 16)] = int(fields[2])
+    if shift is None:
+        sys.exit("no 'profile begin' line in dump")
+    return shift, total, outside, buckets
+
+
+def attribute(symbols, shift, buckets):
+    """Samples per function name, split by byte overlap."""
+    size = 1 << shift
+    per_function = {}
+    for start, samples in buckets.items():
+        end = start + size
+        covered = 0
+        for sym_start, sym_end, name in symbols:
+            if sym_end <= start:
+                continue
+            if sym_start >= end:
+                break
+            overlap = min(end, sym_end) - max(start, sym_start)
+            per_function[name] = per_function.get(name, 0.0) + samples * overlap / size
+            covered += overlap
+        if covered < size:
+            key = "?? (no symbol)"
+            per_function[key] = per_function.get(key, 0.0) + samples * (size - covered) / size
+    return per_function
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="ELF image of the profiled build")
+    parser.add_argument("dump", help="captured serial text, '-' for stdin")
+    parser.add_argument("--nm", default="arm-none-eabi-nm", help="nm to read symbols with")
+    parser.add_argument("--top", type=int, default=30, help="functions to list")
+    args = parser.parse_args()
+
+    source = sys.stdin if args.dump == "-" else open(args.dump, errors="replace")
+    with source:
+        shift, total, outside, buckets = read_dump(source)
+
+    per_function = attribute(read_symbols(args.elf, args.nm), shift, buckets)
+    counted = sum(buckets.values())
+
+    print("%d samples, %d outside flash, %d-byte buckets" % (total, outside, 1 << shift))
+    if counted < total - outside:
+        print("note: %d samples lost to saturated buckets" % (total - outside - counted))
+    print("%7s %9s  %s" % ("%", "samples", "function"))
+    ranked = sorted(per_function.items(), key=lambda item: item[1], reverse=True)
+    for name, samples in ranked[:args.top]:
+        print("%6.2f%% %9.1f  %s" % (100.0 * samples / max(counted, 1), samples, name))
+
+
+if __name__ == "__main__":
+    main()
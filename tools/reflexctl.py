@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+"""Remote control of a Reflex board, or of a host build, for test rigs.
+
+Frames on the serial link (115200 8N1), multi-byte fields little-endian:
+
+    0xA5 <length> <command> <sequence> <payload...> <crc>
+
+length counts the payload only; crc is CRC-8 (polynomial 0x07, initial 0)
+over length to the end of the payload. A reply echoes the sequence number
+with command | 0x80; a failed command is answered by command 0xFF with the
+payload <command> <error code>. See src/remote.h.
+
+The host build prints the name of its pseudo-terminal ("serial: /dev/pts/N")
+at start-up; use that as the port.
+
+    tools/reflexctl.py /dev/ttyUSB0 ping
+    tools/reflexctl.py /dev/ttyUSB0 session --player 1 --foreperiod 1000 500
+
+The Reflex class is usable as a library from rig scripts.
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+SYNC = 0xA5
+REPLY = 0x80
+ERROR = 0xFF
+
+PING, KEYS, COUNTERS, CLOCK = 0x01, 0x02, 0x03, 0x04
+STATUS, PLAYER, FOREPERIOD, START, RESULTS = 0x10, 0x11, 0x12, 0x13, 0x14
+
+ERRORS = {1: "unknown command", 2: "bad length", 3: "bad value", 4: "busy"}
+
+# JOYSTICK_* bits of the joystick driver
+KEY_BITS = {"center": 0x01, "up": 0x02, "down": 0x04, "left": 0x08, "right": 0x10}
+
+COUNTER_FIELDS = ("uptime_ms", "monitor_now", "i2c_ticks", "ssp_ticks", "loop_us",
+                  "acc_us", "light_us", "stack_high_water", "stack_isr_depth",
+                  "eeprom_writes", "irq_mask_max_cycles", "serial_lost_bytes")
+
+IDLE = 0xFF
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def frame(command, sequence, payload=b""):
+    body = bytes([len(payload), command, sequence]) + payload
+    return bytes([SYNC]) + body + bytes([crc8(body)])
+
+
+class RemoteError(Exception):
+    pass
+
+
+class Reflex:
+    """One connection to the game's serial link."""
+
+    def __init__(self, port, timeout=1.0):
+        self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+        self.timeout = timeout
+        self.sequence = 0
+        self.pending = b""
+        if os.isatty(self.fd):
+            tty.setraw(self.fd)
+            attrs = termios.tcgetattr(self.fd)
+            attrs[4] = attrs[5] = termios.B115200
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+            termios.tcflush(self.fd, termios.TCIOFLUSH)
+
+    def close(self):
+        os.close(self.fd)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _read_frame(self, deadline):
+        """Next well-formed frame as (command, sequence, payload), or None."""
+        while True:
+            start = self.pending.find(bytes([SYNC]))
+            self.pending = self.pending[start:] if start >= 0 else b""
+            if len(self.pending) >= 2 and len(self.pending) >= self.pending[1] + 5:
+                length = self.pending[1]
+                raw, self.pending = self.pending[:length + 5], self.pending[length + 5:]
+                if crc8(raw[1:-1]) == raw[-1]:
+                    return raw[2], raw[3], raw[4:-1]
+                self.pending = raw[1:] + self.pending
+                continue
+            left = deadline - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                return None
+            self.pending += os.read(self.fd, 256)
+
+    def command(self, command, payload=b"", retries=2):
+        """Sends a command and returns the reply payload."""
+        for _ in range(retries + 1):
+            self.sequence = (self.sequence + 1) & 0xFF
+            os.write(self.fd, frame(command, self.sequence, payload))
+            deadline = time.monotonic() + self.timeout
+            while True:
+                reply = self._read_frame(deadline)
+                if reply is None:
+                    break
+                kind, sequence, data = reply
+                if sequence != self.sequence:
+                    continue
+                if kind == ERROR:
+                    raise RemoteError("command 0x%02x: %s" % (data[0], ERRORS.get(data[1], data[1])))
+                if kind == command | REPLY:
+                    return data
+        raise RemoteError("command 0x%02x: no reply" % command)
+
+    def ping(self):
+        return self.command(PING)[0]
+
+    def keys(self, names, hold_ms=100):
+        bits = 0
+        for name in names:
+            bits |= KEY_BITS[name]
+        self.command(KEYS, struct.pack("<BH", bits, hold_ms))
+
+    def click(self, hold_ms=100):
+        """Holds center for hold_ms and waits until it is released."""
+        self.keys(["center"], hold_ms)
+        time.sleep(hold_ms / 1000.0 + 0.05)
+
+    def counters(self):
+        return dict(zip(COUNTER_FIELDS, struct.unpack("<12I", self.command(COUNTERS))))
+
+    def clock_us(self):
+        """The board's microsecond clock."""
+        return struct.unpack("<Q", self.command(CLOCK, struct.pack("<Q", 0)))[0]
+
+    def status(self):
+        round_, player, minimum, spread = struct.unpack("<BBHH", self.command(STATUS))
+        return {"round": None if round_ == IDLE else round_, "player": player,
+                "foreperiod_min_ms": minimum, "foreperiod_range_ms": spread}
+
+    def set_player(self, player):
+        self.command(PLAYER, bytes([player]))
+
+    def set_foreperiod(self, min_ms, range_ms):
+        self.command(FOREPERIOD, struct.pack("<HH", min_ms, range_ms))
+
+    def start(self):
+        self.command(START)
+
+    def results(self):
+        data = self.command(RESULTS)
+        player, count = data[0], data[1]
+        times = list(struct.unpack_from("<%dH" % count, data, 2))
+        average, = struct.unpack_from("<H", data, 2 + 2 * count)
+        return {"player": player, "times_ms": times, "average_ms": average}
+
+
+def run_session(reflex, poll_s=0.2):
+    """Starts a session from the main menu and clicks center until the game
+    is back in the menu. Each click answers whatever the game waits for, a
+    stimulus or a result screen, so the times measure the rig's polling
+    delay; a rig that watches the display calls click() on the stimulus
+    instead."""
+    reflex.start()
+    while reflex.status()["round"] is None:
+        time.sleep(poll_s)
+    while reflex.status()["round"] is not None:
+        reflex.click()
+        time.sleep(poll_s)
+    return reflex.results()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial device, or the host build's pseudo-terminal")
+    parser.add_argument("--timeout", type=float, default=1.0, help="reply timeout in seconds")
+    sub = parser.add_subparsers(dest="action", required=True)
+    sub.add_parser("ping")
+    sub.add_parser("status")
+    sub.add_parser("counters")
+    sub.add_parser("results")
+    keys = sub.add_parser("keys")
+    keys.add_argument("names", nargs="+", choices=sorted(KEY_BITS))
+    keys.add_argument("--hold", type=int, default=100, help="hold time in ms")
+    session = sub.add_parser("session", help="play one session from the main menu")
+    session.add_argument("--player", type=int, help="player number, from 1")
+    session.add_argument("--foreperiod", type=int, nargs=2, metavar=("MIN_MS", "RANGE_MS"))
+    args = parser.parse_args()
+
+    try:
+        with Reflex(args.port, args.timeout) as reflex:
+            if args.action == "ping":
+                print("protocol version %d" % reflex.ping())
+            elif args.action == "status":
+                print(reflex.status())
+            elif args.action == "counters":
+                for name, value in reflex.counters().items():
+                    print("%-20s %u" % (name, value))
+            elif args.action == "results":
+                print(reflex.results())
+            elif args.action == "keys":
+                reflex.keys(args.names, args.hold)
+            elif args.action == "session":
+                if args.player is not None:
+                    reflex.set_player(args.player - 1)
+                if args.foreperiod:
+                    reflex.set_foreperiod(*args.foreperiod)
+                result = run_session(reflex)
+                print("player %d: %s ms, average %d ms" % (result["player"] + 1,
+                      " ".join(str(t) for t in result["times_ms"]), result["average_ms"]))
+    except RemoteError as error:
+        sys.exit(str(error))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Chrome trace / Perfetto JSON from a Reflex event trace dump.
+
+The firmware sends its trace ring over the serial link when joystick RIGHT
+is pressed in the main menu:
+
+    trace begin hz=72000000 count=N lost=M
+    e <cycles hex> <phase> <id> <arg>
+    ...
+    trace end
+
+Capture that text with any terminal and convert it:
+
+    tools/trace2json.py dump.txt > trace.json
+
+then open trace.json in chrome://tracing or ui.perfetto.dev.
+
+Time stamps are 32-bit core cycle counts. They are unwrapped as signed
+differences between neighbouring records, which is exact as long as no two
+consecutive records are more than 2**31 cycles (~29 s at 72 MHz) apart; the
+firmware writes a sync marker every 16384 ms to guarantee that.
+"""
+
+import argparse
+import json
+import sys
+
+BEGIN, END, INSTANT = 0, 1, 2
+
+# id: (name, track); must match the TRACE_* ids in src/trace.h
+EVENTS = {
+    0: ("sync", "timing"),
+    1: ("round", "game"),
+    2: ("stimulus", "game"),
+    3: ("click", "input"),
+    4: ("draw", "display"),
+    5: ("ssp", "bus"),
+    6: ("note", "audio"),
+    7: ("eeprom", "bus"),
+    8: ("result", "game"),
+    9: ("qr", "display"),
+    10: ("wake", "display"),
+}
+
+TRACKS = ["game", "input", "display", "bus", "audio", "timing"]
+
+# Readable names for the SSP chip select argument (port << 8 | pin)
+CHIP_SELECTS = {0x0002: "oled", 0x010B: "seg7"}
+
+
+def read_dumps(lines):
+    """List of (hz, lost, records) for every complete dump in the text."""
+    dumps, current = [], None
+    for line in lines:
+        fields = line.split()
+        if fields[:2] == ["trace", "begin"]:
+            opts = dict(f.split("=", 1) for f in fields[2:])
+            current = (int(opts["hz"]), int(opts["lost"]), [])
+        elif fields[:2] == ["trace", "end"] and current is not None:
+            dumps.append(current)
+            current = None
+        elif current is not None and len(fields) == 5 and fields[0] == "e":
+            current[2].append((int(fields[1], 16), int(fields[2]), int(fields[3]), int(fields[4])))
+    return dumps
+
+
+def unwrap(records):
+    """Records with 64-bit cycle counts, relative to the first record."""
+    out, total, previous = [], 0, None
+    for cycles, phase, ident, arg in records:
+        if previous is not None:
+            delta = (cycles - previous) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000
+            total += delta
+        previous = cycles
+        out.append((total, phase, ident, arg))
+    return out
+
+
+def to_events(hz, records, pid):
+    """Chrome trace events of one dump."""
+    events = []
+    for tid, track in enumerate(TRACKS, 1):
+        events.append({"ph": "M", "name": "thread_name", "pid": pid, "tid": tid,
+                       "args": {"name": track}})
+
+    records = sorted(unwrap(records), key=lambda r: r[0])
+    for cycles, phase, ident, arg in records:
+        name, track = EVENTS.get(ident, ("id%d" % ident, "timing"))
+        event = {"name": name, "pid": pid, "tid": TRACKS.index(track) + 1,
+                 "ts": cycles * 1e6 / hz, "args": {"arg": arg}}
+        if ident == 5:
+            event["args"]["device"] = CHIP_SELECTS.get(arg, "cs %d.%d" % (arg >> 8, arg & 0xFF))
+        if phase == BEGIN:
+            event["ph"] = "B"
+        elif phase == END:
+            event["ph"] = "E"
+        else:
+            event["ph"] = "i"
+            event["s"] = "t"
+        events.append(event)
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", help="captured serial text, '-' for stdin")
+    args = parser.parse_args()
+
+    source = sys.stdin if args.dump == "-" else open(args.dump, errors="replace")
+    with source:
+        dumps = read_dumps(source)
+    if not dumps:
+        sys.exit("no complete 'trace begin' ... 'trace end' block in dump")
+
+    events = []
+    for pid, (hz, lost, records) in enumerate(dumps, 1):
+        events.append({"ph": "M", "name": "process_name", "pid": pid,
+                       "args": {"name": "dump %d (%d lost)" % (pid, lost)}})
+        events.extend(to_events(hz, records, pid))
+    json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, sys.stdout, indent=1)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()